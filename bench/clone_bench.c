@@ -0,0 +1,110 @@
+/*
+ * clone_bench.c - Замер стоимости клонирования арены
+ * Сравнивает снимок/откат изменяемого состояния с глубокой копией арены вместе с картой
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../core/sim.h"
+
+/* Количество повторов по умолчанию */
+#define BENCH_DEFAULT_ITERATIONS 200000
+
+/* Получение времени в секундах */
+static double get_time_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Глубокая копия арены с картой - то, во что обходится клон без разделения состояния */
+static Arena* clone_arena_deep(const Arena *src) {
+    Arena *copy = (Arena *)malloc(sizeof(Arena));
+    memcpy(copy, src, sizeof(Arena));
+    
+    Map *map = (Map *)malloc(sizeof(Map));
+    void *block = malloc(map_packed_size(src->map));
+    map_pack(src->map, map, block);
+    copy->map = map;
+    return copy;
+}
+
+/* Освобождение глубокой копии (блок упакованной карты начинается с таблицы чанков) */
+static void free_arena_deep(Arena *copy) {
+    Map *map = (Map *)copy->map;
+    free(map->chunks);
+    free(map);
+    free(copy);
+}
+
+/* Замеры для одного размера карты */
+static void bench_map_size(int map_size, int iterations) {
+    /* Живое состояние: боты играют несколько сотен тиков */
+    SimConfig config = sim_config_default();
+    config.map_size = map_size;
+    config.player_count = 4;
+    SimMatch *match = sim_match_create(&config);
+    if (!match) return;
+    sim_match_step(match, 300);
+    Arena *arena = match->game->arena;
+    
+    ArenaState *snapshot = (ArenaState *)malloc(sizeof(ArenaState));
+    volatile int sink = 0;
+    
+    double start = get_time_sec();
+    for (int i = 0; i < iterations; i++) {
+        arena_snapshot(arena, snapshot);
+        sink += snapshot->tick;
+    }
+    double snapshot_ns = (get_time_sec() - start) * 1e9 / iterations;
+    
+    start = get_time_sec();
+    for (int i = 0; i < iterations; i++) {
+        arena_restore(arena, snapshot);
+        sink += arena->state.tick;
+    }
+    double restore_ns = (get_time_sec() - start) * 1e9 / iterations;
+    
+    int deep_iterations = iterations / 10 + 1;
+    start = get_time_sec();
+    for (int i = 0; i < deep_iterations; i++) {
+        Arena *copy = clone_arena_deep(arena);
+        sink += copy->state.tick;
+        free_arena_deep(copy);
+    }
+    double deep_ns = (get_time_sec() - start) * 1e9 / deep_iterations;
+    
+    /* Откат воспроизводим: повтор тех же тиков от снимка даёт то же состояние побайтно */
+    ArenaState *first = (ArenaState *)malloc(sizeof(ArenaState));
+    arena_snapshot(arena, snapshot);
+    for (int t = 0; t < 120; t++) arena_update(arena, SIM_TICK_SECONDS);
+    arena_snapshot(arena, first);
+    arena_restore(arena, snapshot);
+    for (int t = 0; t < 120; t++) arena_update(arena, SIM_TICK_SECONDS);
+    int replay_ok = memcmp(first, &arena->state, sizeof(ArenaState)) == 0;
+    
+    printf("Карта %4d: снимок %7.1f нс, откат %7.1f нс, глубокая копия %10.1f нс (x%.0f), повтор от снимка: %s\n",
+           map_size, snapshot_ns, restore_ns, deep_ns, deep_ns / (snapshot_ns > 0 ? snapshot_ns : 1),
+           replay_ok ? "совпал" : "РАСХОДИТСЯ");
+    (void)sink;
+    
+    free(first);
+    free(snapshot);
+    sim_match_destroy(match);
+}
+
+int main(int argc, char *argv[]) {
+    int iterations = (argc > 1) ? atoi(argv[1]) : BENCH_DEFAULT_ITERATIONS;
+    if (iterations < 1) iterations = 1;
+    
+    printf("Размер снимка (ArenaState): %zu байт, вся арена: %zu байт\n", sizeof(ArenaState), sizeof(Arena));
+    printf("Повторов: %d\n", iterations);
+    
+    const int sizes[] = { 20, 64, 256, 1024 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        bench_map_size(sizes[i], iterations);
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+/*
+ * duel_bench.c - Замер развёрнутого ядра арены на дуэли
+ * Два игрока сходятся на открытой карте и обмениваются заклинаниями.
+ * Один и тот же прогон идёт с общим ядром и с ядром на 2 сущности;
+ * состояния арен после прогона должны совпасть побайтно
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../core/arena.h"
+#include "../common/rng.h"
+
+/* Длительность тика (как у сервера) */
+#define BENCH_TICK_SECONDS (16 / 1000.0f)
+
+/* Размер карты дуэли */
+#define BENCH_MAP_SIZE 20
+
+/* Количество повторов каждого варианта (берётся лучший) */
+#define BENCH_REPEATS 5
+
+/* Получение времени в секундах */
+static double get_time_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Прогон дуэли на арене с заданной ёмкостью. Возвращает время тика в секундах */
+static double run_duel(Arena *arena, const Map *map, int capacity, int ticks, long *hits) {
+    arena_init(arena, map);
+    arena_set_capacity(arena, capacity);
+    int ids[2];
+    ids[0] = arena_add_entity(arena, 'A', vec2_create(3, 3), 1000000, 1000000);
+    ids[1] = arena_add_entity(arena, 'B', vec2_create(BENCH_MAP_SIZE - 4, BENCH_MAP_SIZE - 4), 1000000, 1000000);
+    
+    Rng rng = rng_create(7);
+    *hits = 0;
+    
+    double start = get_time_sec();
+    for (int t = 0; t < ticks; t++) {
+        for (int i = 0; i < 2; i++) {
+            /* Игрок идёт к сопернику по большей разнице координат и стреляет вдоль линии */
+            Vec2 self = arena->state.entities[ENTITY_ID_SLOT(ids[i])].position;
+            Vec2 other = arena->state.entities[ENTITY_ID_SLOT(ids[1 - i])].position;
+            Vec2 offset = vec2_sub(other, self);
+            Direction step_dir = (abs(offset.x) > abs(offset.y)) ?
+                (offset.x > 0 ? DIR_RIGHT : DIR_LEFT) : (offset.y > 0 ? DIR_DOWN : DIR_UP);
+            if (rng_range(&rng, 0, 3) == 0) step_dir = (Direction)rng_range(&rng, DIR_UP, DIR_RIGHT);
+            arena_move_entity(arena, ids[i], step_dir);
+            
+            if (offset.x == 0 || offset.y == 0) {
+                Direction fire_dir = (offset.x == 0) ? (offset.y > 0 ? DIR_DOWN : DIR_UP) :
+                                                       (offset.x > 0 ? DIR_RIGHT : DIR_LEFT);
+                SpellType type = rng_range(&rng, 0, 3) == 0 ? SPELL_TYPE_POWER : SPELL_TYPE_BASIC;
+                arena_cast_spell(arena, ids[i], fire_dir, type);
+            }
+        }
+        arena_update(arena, BENCH_TICK_SECONDS);
+        for (int e = 0; e < arena->event_count; e++) {
+            if (arena->events[e].type == ARENA_EVENT_DAMAGE) (*hits)++;
+        }
+    }
+    return (get_time_sec() - start) / ticks;
+}
+
+int main(int argc, char *argv[]) {
+    int ticks = (argc > 1) ? atoi(argv[1]) : 200000;
+    if (ticks < 1) ticks = 1;
+    
+    /* Открытая карта: стены только по периметру */
+    Region region;
+    Map map;
+    if (region_init(&region, arena_region_size(BENCH_MAP_SIZE) + sizeof(Arena) + REGION_ALIGN) < 0) return 1;
+    Arena *generic = (Arena *)region_alloc(&region, sizeof(Arena));
+    Arena *duel = (Arena *)region_alloc(&region, sizeof(Arena));
+    if (!generic || !duel || map_init(&map, BENCH_MAP_SIZE, &region) < 0 ||
+        map_build_tables(&map, vec2_create(1, 1)) < 0) {
+        return 1;
+    }
+    
+    /* Варианты чередуются, чтобы оба попали в одинаковые условия */
+    double best_generic = 0.0;
+    double best_duel = 0.0;
+    long hits_generic = 0;
+    long hits_duel = 0;
+    for (int r = 0; r < BENCH_REPEATS; r++) {
+        double time_generic = run_duel(generic, &map, MAX_ENTITIES, ticks, &hits_generic);
+        double time_duel = run_duel(duel, &map, 2, ticks, &hits_duel);
+        if (r == 0 || time_generic < best_generic) best_generic = time_generic;
+        if (r == 0 || time_duel < best_duel) best_duel = time_duel;
+    }
+    int same = memcmp(&generic->state, &duel->state, sizeof(ArenaState)) == 0 && hits_generic == hits_duel;
+    
+    printf("Дуэль: карта %d, тиков %d, попаданий %ld, MAX_ENTITIES %d\n",
+           BENCH_MAP_SIZE, ticks, hits_duel, MAX_ENTITIES);
+    printf("Общее ядро (ёмкость %d): %.1f нс на тик\n", arena_capacity(generic), best_generic * 1e9);
+    printf("Ядро дуэли (ёмкость %d): %.1f нс на тик (x%.2f), состояние %s\n", arena_capacity(duel),
+           best_duel * 1e9, best_generic / best_duel, same ? "совпало" : "РАЗОШЛОСЬ");
+    
+    region_destroy(&region);
+    return same ? 0 : 1;
+}
@@ -0,0 +1,75 @@
+/*
+ * entity_bench.c - Замер проходов по сущностям арены
+ * Сущности бродят по открытой карте и стреляют: тик арены, проверки занятости
+ * клеток при движении и поиск попаданий. Собирается под конкретный MAX_ENTITIES
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../core/arena.h"
+#include "../common/rng.h"
+
+/* Длительность тика (как у сервера) */
+#define BENCH_TICK_SECONDS (16 / 1000.0f)
+
+/* Получение времени в секундах */
+static double get_time_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+    int ticks = (argc > 1) ? atoi(argv[1]) : 20000;
+    if (ticks < 1) ticks = 1;
+    
+    /* Сетка сущностей с шагом 4 клетки */
+    int side = 1;
+    while (side * side < MAX_ENTITIES) side++;
+    int map_size = side * 4 + 2;
+    
+    /* Открытая карта: стены только по периметру */
+    Region region;
+    Map map;
+    if (region_init(&region, arena_region_size(map_size)) < 0) return 1;
+    Arena *arena = (Arena *)region_alloc(&region, sizeof(Arena));
+    if (!arena || map_init(&map, map_size, &region) < 0 || map_build_tables(&map, vec2_create(1, 1)) < 0) return 1;
+    arena_init(arena, &map);
+    
+    int ids[MAX_ENTITIES];
+    for (int i = 0; i < MAX_ENTITIES; i++) {
+        Vec2 pos = vec2_create(2 + (i % side) * 4, 2 + (i / side) * 4);
+        ids[i] = arena_add_entity(arena, (char)('A' + i % 26), pos, 1000000, 100);
+    }
+    
+    Rng rng = rng_create(42);
+    long moves = 0;
+    long casts = 0;
+    long occupied = 0;
+    
+    double start = get_time_sec();
+    for (int t = 0; t < ticks; t++) {
+        for (int i = 0; i < MAX_ENTITIES; i++) {
+            Direction dir = (Direction)rng_range(&rng, DIR_UP, DIR_RIGHT);
+            moves += arena_move_entity(arena, ids[i], dir);
+            if (rng_range(&rng, 0, 7) == 0 && arena_cast_spell(arena, ids[i], dir, SPELL_TYPE_BASIC) >= 0) {
+                casts++;
+            }
+            
+            /* Запрос занятости случайной клетки (как у ботов при выборе шага) */
+            Vec2 probe = vec2_create(rng_range(&rng, 1, map_size - 2), rng_range(&rng, 1, map_size - 2));
+            occupied += arena_is_position_occupied(arena, probe);
+        }
+        arena_update(arena, BENCH_TICK_SECONDS);
+    }
+    double elapsed = get_time_sec() - start;
+    
+    printf("Сущностей: %d, карта %d, тиков: %d\n", MAX_ENTITIES, map_size, ticks);
+    printf("Размер сущности: горячая часть %zu байт, холодная %zu байт\n", sizeof(Entity), sizeof(EntityCold));
+    printf("Шагов: %ld, заклинаний: %ld, занятых проб: %ld\n", moves, casts, occupied);
+    printf("Время тика: %.2f мкс (%.0f тиков/с)\n", elapsed * 1e6 / ticks, ticks / elapsed);
+    
+    region_destroy(&region);
+    return 0;
+}
@@ -19,7 +19,6 @@
 
 /* Константы */
 #define FRAME_TIME_MS 16    /* ~60 FPS */
-#define PROTOCOL_VERSION "1.0.0"
 
 /* Создание приложения */
 ClientApp client_app_create(const char *host, int tcp_port) {
@@ -132,6 +131,12 @@ static void sync_arena_state(ClientApp *app) {
         arena_view_set_spell(&app->arena_view, s->id, s->pos_x, s->pos_y, s->direction, s->spell_type, 1);
     }
     
+    /* Взрывы кадра: анимация живёт дольше кадра, поэтому список не очищается */
+    for (int i = 0; i < app->state.explosion_count; i++) {
+        ExplosionData *explosion = &app->state.explosions[i];
+        arena_view_add_explosion(&app->arena_view, explosion->pos_x, explosion->pos_y, explosion->radius);
+    }
+    
     /* Устанавливаем текущего игрока */
     for (int i = 0; i < app->state.entity_count; i++) {
         if (app->state.entities[i].symbol == app->state.player_symbol) {
@@ -199,9 +204,12 @@ static void handle_single_packet(ClientApp *app, uint8_t *buffer, int len) {
             
             menu_set_version_info(&app->menu, server_version, compatible);
             
-            uint8_t buf[64];
-            int n = encode_subscribe_info(buf);
-            socket_send_all(&app->state.tcp_socket, buf, (size_t)n);
+            /* Несовместимый сервер остальные сообщения не примет */
+            if (compatible) {
+                uint8_t buf[64];
+                int n = encode_subscribe_info(buf);
+                socket_send_all(&app->state.tcp_socket, buf, (size_t)n);
+            }
             break;
         }
         
@@ -309,11 +317,32 @@ static void handle_single_packet(ClientApp *app, uint8_t *buffer, int len) {
             break;
         }
         
+        case SERVER_MSG_START_ARENA: {
+            int arena_number, map_size;
+            if (decode_start_arena(data, (size_t)header.data_length, &arena_number, &map_size) > 0) {
+                arena_view_set_arena_number(&app->arena_view, arena_number);
+                arena_view_reset_terrain(&app->arena_view, map_size);
+                app->state.last_tick = 0;  /* Кадры прошлой арены не годятся для отката */
+                app->arena_view.next_arena_countdown = -1;
+            }
+            break;
+        }
+        
+        case SERVER_MSG_MAP_CHUNKS: {
+            /* Чанки приходят постепенно, остальная карта остаётся в тумане */
+            ArenaView *view = &app->arena_view;
+            if (view->terrain && view->terrain_size == view->map_size) {
+                decode_map_chunks(data, (size_t)header.data_length, view->terrain, view->map_size);
+            }
+            break;
+        }
+        
         case SERVER_MSG_GAME_STEP: {
-            decode_game_step(data, (size_t)header.data_length,
+            decode_game_step(data, (size_t)header.data_length, &app->state.last_tick,
                            app->state.entities, &app->state.entity_count,
                            app->state.spells, &app->state.spell_count,
-                           app->state.player_data, &app->state.player_data_count);
+                           app->state.player_data, &app->state.player_data_count,
+                           app->state.explosions, &app->state.explosion_count);
             
             /* Синхронизируем view арены */
             sync_arena_state(app);
@@ -411,13 +440,13 @@ void client_app_run(ClientApp *app) {
                 /* Отрисовка меню */
                 menu_render(&app->menu, screen_width, screen_height);
                 break;
-                
+            
             case CLIENT_STATE_PLAYING:
             case CLIENT_STATE_GAME_OVER:
                 /* Отрисовка арены */
                 arena_view_render(&app->arena_view, screen_width, screen_height);
                 break;
-                
+            
             case CLIENT_STATE_DISCONNECTED:
                 /* Отрисовка меню с сообщением об отключении */
                 menu_set_connection_status(&app->menu, CONNECTION_LOST);
@@ -484,7 +513,7 @@ void client_app_handle_input(ClientApp *app, int key) {
                 client_state_set(&app->state, CLIENT_STATE_MENU);
             }
             break;
-            
+        
         case CLIENT_STATE_PLAYING: {
             if (key == 27 || input_is_quit_key(key)) {  /* Escape или Q */
                 client_app_disconnect(app);
@@ -497,6 +526,9 @@ void client_app_handle_input(ClientApp *app, int key) {
             } else if (input_is_spell_2_key(key)) {
                 /* Переключение на усиленную атаку */
                 app->state.selected_spell_type = 2;
+            } else if (input_is_spell_3_key(key)) {
+                /* Переключение на взрыв */
+                app->state.selected_spell_type = 3;
             } else if (input_is_action_key(key)) {
                 /* Атака в последнем выбранном направлении */
                 Direction dir = (Direction)app->state.last_direction;
@@ -511,7 +543,7 @@ void client_app_handle_input(ClientApp *app, int key) {
             }
             break;
         }
-            
+        
         case CLIENT_STATE_GAME_OVER:
             if (key == '\n' || key == KEY_ENTER) {
                 /* Возврат в меню */
@@ -522,7 +554,7 @@ void client_app_handle_input(ClientApp *app, int key) {
                 app->arena_view.game_finished = 0;
             }
             break;
-            
+        
         case CLIENT_STATE_DISCONNECTED:
             if (key == 27) {  /* Escape */
                 app->running = 0;
@@ -645,12 +677,13 @@ void client_app_send_cast(ClientApp *app, Direction dir) {
     if (!socket_is_valid(&app->state.tcp_socket)) return;
     
     uint8_t buffer[64];
-    int n = encode_cast_skill(buffer, dir, app->state.selected_spell_type);
+    int n = encode_cast_skill(buffer, dir, app->state.selected_spell_type, app->state.last_tick);
     socket_send_all(&app->state.tcp_socket, buffer, (size_t)n);
 }
 
 /* Освобождение ресурсов */
 void client_app_destroy(ClientApp *app) {
     client_state_destroy(&app->state);
+    arena_view_destroy(&app->arena_view);
     renderer_destroy(&app->renderer);
 }
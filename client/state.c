@@ -34,6 +34,8 @@ ClientState client_state_create(void) {
     state.entity_count = 0;
     state.spell_count = 0;
     state.player_data_count = 0;
+    state.explosion_count = 0;
+    state.last_tick = 0;
     
     state.winner = '\0';
     state.selected_spell_type = 1;  /* По умолчанию базовая атака */
@@ -64,6 +66,8 @@ void client_state_reset(ClientState *state) {
     state->entity_count = 0;
     state->spell_count = 0;
     state->player_data_count = 0;
+    state->explosion_count = 0;
+    state->last_tick = 0;
     state->winner = '\0';
     
     /* Очищаем TCP буфер */
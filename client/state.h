@@ -60,6 +60,9 @@ typedef struct {
     int spell_count;
     PlayerData player_data[MAX_PLAYERS];
     int player_data_count;
+    ExplosionData explosions[MAX_STEP_EXPLOSIONS]; /* Взрывы этого кадра */
+    int explosion_count;
+    uint32_t last_tick;         /* Номер последнего кадра (отправляется с заклинаниями) */
     
     /* Результат игры */
     char winner;                /* Победитель */
@@ -0,0 +1,189 @@
+/*
+ * log.c - Реализация асинхронного журналирования
+ */
+
+#include "log.h"
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <pthread.h>
+
+#define LOG_RING_MASK (LOG_RING_SIZE - 1)
+
+/* Пауза фонового потока, когда буфер пуст */
+#define LOG_IDLE_SLEEP_NS 2000000L
+
+/* Запись кольцевого буфера. sequence == позиция записи - слот свободен,
+ * позиция + 1 - запись готова к выводу */
+typedef struct {
+    atomic_size_t sequence;
+    LogLevel level;
+    struct timespec time;
+    char message[LOG_MESSAGE_SIZE];
+} LogRecord;
+
+static LogRecord g_ring[LOG_RING_SIZE];
+static atomic_size_t g_head;            /* Следующая позиция для записи (все потоки) */
+static size_t g_tail;                   /* Следующая позиция для вывода (только фоновый поток) */
+static atomic_int g_level = LOG_LEVEL_INFO;
+static atomic_int g_running;
+static atomic_uint_fast64_t g_dropped;
+static pthread_t g_thread;
+static FILE *g_out;
+static int g_started;
+
+static const char *level_names[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+
+/* Вывод одной записи с префиксом времени и уровня */
+static void write_record(FILE *out, LogLevel level, const struct timespec *time, const char *message) {
+    struct tm tm;
+    time_t seconds = time->tv_sec;
+    localtime_r(&seconds, &tm);
+    fprintf(out, "%02d:%02d:%02d.%03ld %-5s %s\n", tm.tm_hour, tm.tm_min, tm.tm_sec,
+            time->tv_nsec / 1000000, level_names[level], message);
+}
+
+/* Вывод всех готовых записей, возвращает их количество */
+static int drain_ring(void) {
+    int written = 0;
+    for (;;) {
+        LogRecord *record = &g_ring[g_tail & LOG_RING_MASK];
+        size_t sequence = atomic_load_explicit(&record->sequence, memory_order_acquire);
+        if (sequence != g_tail + 1) break;
+        
+        write_record(g_out, record->level, &record->time, record->message);
+        written++;
+        
+        /* Освобождаем слот для следующего круга */
+        atomic_store_explicit(&record->sequence, g_tail + LOG_RING_SIZE, memory_order_release);
+        g_tail++;
+    }
+    return written;
+}
+
+/* Фоновый поток записи */
+static void *writer_thread(void *arg) {
+    (void)arg;
+    struct timespec idle = { 0, LOG_IDLE_SLEEP_NS };
+    
+    while (atomic_load_explicit(&g_running, memory_order_acquire)) {
+        if (drain_ring() > 0) {
+            fflush(g_out);
+        } else {
+            nanosleep(&idle, NULL);
+        }
+    }
+    
+    drain_ring();
+    fflush(g_out);
+    return NULL;
+}
+
+/* Запуск фонового потока записи */
+int log_init(FILE *out, LogLevel level) {
+    if (g_started) return 0;
+    
+    for (size_t i = 0; i < LOG_RING_SIZE; i++) {
+        atomic_init(&g_ring[i].sequence, i);
+    }
+    atomic_store(&g_head, 0);
+    g_tail = 0;
+    atomic_store(&g_dropped, 0);
+    atomic_store(&g_level, level);
+    g_out = out;
+    
+    atomic_store(&g_running, 1);
+    if (pthread_create(&g_thread, NULL, writer_thread, NULL) != 0) {
+        atomic_store(&g_running, 0);
+        return -1;
+    }
+    g_started = 1;
+    return 0;
+}
+
+/* Остановка потока записи */
+void log_shutdown(void) {
+    if (!g_started) return;
+    
+    atomic_store_explicit(&g_running, 0, memory_order_release);
+    pthread_join(g_thread, NULL);
+    g_started = 0;
+    
+    uint64_t dropped = log_dropped();
+    if (dropped > 0) {
+        fprintf(g_out, "Журнал: отброшено записей из-за переполнения: %llu\n", (unsigned long long)dropped);
+        fflush(g_out);
+    }
+}
+
+/* Установка уровня журнала */
+void log_set_level(LogLevel level) {
+    atomic_store_explicit(&g_level, level, memory_order_relaxed);
+}
+
+/* Разбор имени уровня */
+int log_parse_level(const char *name) {
+    if (strcasecmp(name, "none") == 0) return LOG_LEVEL_NONE;
+    for (int i = LOG_LEVEL_DEBUG; i <= LOG_LEVEL_ERROR; i++) {
+        if (strcasecmp(name, level_names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+/* Запись сообщения */
+void log_write(LogLevel level, const char *fmt, ...) {
+    if ((int)level < atomic_load_explicit(&g_level, memory_order_relaxed) || level >= LOG_LEVEL_NONE) {
+        return;
+    }
+    
+    va_list args;
+    va_start(args, fmt);
+    
+    /* Поток записи не запущен: выводим синхронно */
+    if (!g_started) {
+        struct timespec now;
+        char message[LOG_MESSAGE_SIZE];
+        clock_gettime(CLOCK_REALTIME, &now);
+        vsnprintf(message, sizeof(message), fmt, args);
+        write_record(stderr, level, &now, message);
+        va_end(args);
+        return;
+    }
+    
+    /* Захватываем слот: позиция head свободна, если sequence совпадает с ней */
+    size_t pos = atomic_load_explicit(&g_head, memory_order_relaxed);
+    LogRecord *record;
+    for (;;) {
+        record = &g_ring[pos & LOG_RING_MASK];
+        size_t sequence = atomic_load_explicit(&record->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&g_head, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            /* Буфер полон: фоновый поток не успевает */
+            atomic_fetch_add_explicit(&g_dropped, 1, memory_order_relaxed);
+            va_end(args);
+            return;
+        } else {
+            pos = atomic_load_explicit(&g_head, memory_order_relaxed);
+        }
+    }
+    
+    record->level = level;
+    clock_gettime(CLOCK_REALTIME, &record->time);
+    vsnprintf(record->message, sizeof(record->message), fmt, args);
+    va_end(args);
+    
+    /* Публикуем запись для фонового потока */
+    atomic_store_explicit(&record->sequence, pos + 1, memory_order_release);
+}
+
+/* Количество отброшенных записей */
+uint64_t log_dropped(void) {
+    return (uint64_t)atomic_load_explicit(&g_dropped, memory_order_relaxed);
+}
@@ -0,0 +1,75 @@
+/*
+ * log.h - Асинхронное журналирование
+ * Записи складываются в lock-free кольцевой буфер, а фоновый поток
+ * форматирует префикс и пишет их в файл, не задерживая игровой цикл
+ */
+
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* Уровни журнала */
+typedef enum {
+    LOG_LEVEL_DEBUG = 0,
+    LOG_LEVEL_INFO = 1,
+    LOG_LEVEL_WARN = 2,
+    LOG_LEVEL_ERROR = 3,
+    LOG_LEVEL_NONE = 4
+} LogLevel;
+
+/* Уровень, ниже которого вызовы вырезаются при компиляции (-DLOG_COMPILE_LEVEL=...) */
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+/* Ёмкость кольцевого буфера (степень двойки) и максимальная длина сообщения */
+#define LOG_RING_SIZE 1024
+#define LOG_MESSAGE_SIZE 160
+
+/* Запуск фонового потока записи в out. До запуска записи выводятся синхронно в stderr.
+ * Возвращает 0 при успехе, -1 при ошибке */
+int log_init(FILE *out, LogLevel level);
+
+/* Остановка потока записи с выводом оставшихся записей */
+void log_shutdown(void);
+
+/* Установка уровня журнала во время работы */
+void log_set_level(LogLevel level);
+
+/* Разбор имени уровня (debug, info, warn, error, none), -1 если имя неизвестно */
+int log_parse_level(const char *name);
+
+/* Запись сообщения (без системных вызовов; при переполнении запись отбрасывается) */
+void log_write(LogLevel level, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+/* Количество записей, отброшенных из-за переполнения буфера */
+uint64_t log_dropped(void);
+
+/* Макросы уровней: вызовы ниже LOG_COMPILE_LEVEL не попадают в код */
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) log_write(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) log_write(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(...) log_write(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void)0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) log_write(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
+
+#endif /* LOG_H */
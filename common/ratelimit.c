@@ -0,0 +1,36 @@
+/*
+ * ratelimit.c - Реализация ведра токенов
+ */
+
+#include "ratelimit.h"
+
+/* Один токен в тысячных долях */
+#define TOKEN_UNIT 1000
+
+/* Создание полного ведра */
+TokenBucket token_bucket_create(int rate, int burst, int64_t now_ms) {
+    TokenBucket bucket;
+    bucket.rate = rate;
+    bucket.burst = burst;
+    bucket.tokens = (int64_t)burst * TOKEN_UNIT;
+    bucket.last_ms = now_ms;
+    return bucket;
+}
+
+/* Попытка забрать токен */
+int token_bucket_take(TokenBucket *bucket, int64_t now_ms) {
+    /* rate токенов в секунду = rate тысячных долей в миллисекунду */
+    int64_t elapsed = now_ms - bucket->last_ms;
+    if (elapsed > 0) {
+        int64_t capacity = (int64_t)bucket->burst * TOKEN_UNIT;
+        bucket->tokens += elapsed * bucket->rate;
+        if (bucket->tokens > capacity) bucket->tokens = capacity;
+        bucket->last_ms = now_ms;
+    }
+    
+    if (bucket->tokens < TOKEN_UNIT) {
+        return 0;
+    }
+    bucket->tokens -= TOKEN_UNIT;
+    return 1;
+}
@@ -0,0 +1,27 @@
+/*
+ * ratelimit.h - Ограничение частоты (token bucket)
+ * Ведро наполняется со скоростью rate токенов в секунду до burst,
+ * каждое сообщение забирает один токен. Время передаётся вызывающим,
+ * поэтому проверка - несколько целочисленных операций без системных вызовов
+ */
+
+#ifndef RATELIMIT_H
+#define RATELIMIT_H
+
+#include <stdint.h>
+
+/* Ведро токенов */
+typedef struct {
+    int64_t tokens;     /* Запас в тысячных долях токена */
+    int64_t last_ms;    /* Время последнего пополнения, мс */
+    int rate;           /* Пополнение, токенов в секунду */
+    int burst;          /* Ёмкость ведра, токенов */
+} TokenBucket;
+
+/* Создание полного ведра */
+TokenBucket token_bucket_create(int rate, int burst, int64_t now_ms);
+
+/* Попытка забрать токен: 1 - сообщение пропускается, 0 - лимит исчерпан */
+int token_bucket_take(TokenBucket *bucket, int64_t now_ms);
+
+#endif /* RATELIMIT_H */
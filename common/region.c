@@ -0,0 +1,74 @@
+/*
+ * region.c - Реализация региона памяти
+ */
+
+#include "region.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Создание региона */
+int region_init(Region *region, size_t capacity) {
+    region->base = (uint8_t *)malloc(capacity);
+    region->capacity = region->base ? capacity : 0;
+    region->used = 0;
+    region->peak = 0;
+    if (!region->base) return -1;
+
+#ifdef REGION_DEBUG
+    memset(region->base, REGION_POISON_FREED, capacity);
+#endif
+    return 0;
+}
+
+/* Выделение выровненного блока */
+void* region_alloc(Region *region, size_t size) {
+    size_t offset = (region->used + REGION_ALIGN - 1) & ~(size_t)(REGION_ALIGN - 1);
+    if (offset > region->capacity || size > region->capacity - offset) {
+        return NULL;
+    }
+    
+    region->used = offset + size;
+    if (region->used > region->peak) region->peak = region->used;
+
+#ifdef REGION_DEBUG
+    memset(region->base + offset, REGION_POISON_ALLOC, size);
+#endif
+    return region->base + offset;
+}
+
+/* Выделение обнулённого блока */
+void* region_calloc(Region *region, size_t count, size_t size) {
+    if (size != 0 && count > (size_t)-1 / size) return NULL;
+    
+    void *block = region_alloc(region, count * size);
+    if (block) memset(block, 0, count * size);
+    return block;
+}
+
+/* Отметка текущей позиции */
+size_t region_mark(const Region *region) {
+    return region->used;
+}
+
+/* Освобождение всего, что выделено после отметки */
+void region_rewind(Region *region, size_t mark) {
+    if (mark >= region->used) return;
+
+#ifdef REGION_DEBUG
+    memset(region->base + mark, REGION_POISON_FREED, region->used - mark);
+#endif
+    region->used = mark;
+}
+
+/* Освобождение всей памяти региона */
+void region_reset(Region *region) {
+    region_rewind(region, 0);
+}
+
+/* Освобождение блока региона */
+void region_destroy(Region *region) {
+    free(region->base);
+    region->base = NULL;
+    region->capacity = 0;
+    region->used = 0;
+}
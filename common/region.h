@@ -0,0 +1,52 @@
+/*
+ * region.h - Регион памяти (bump-аллокатор)
+ * Один блок выделяется при создании, выдача памяти - сдвиг указателя,
+ * освобождение - сброс целиком или откат к отметке. Используется для памяти
+ * со временем жизни арены: сброс при смене арены вместо malloc/free.
+ * При сборке с -DREGION_DEBUG освобождённая память заполняется REGION_POISON_FREED,
+ * а новая - REGION_POISON_ALLOC, чтобы обращения к ней были заметны
+ */
+
+#ifndef REGION_H
+#define REGION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Выравнивание выдаваемых блоков */
+#define REGION_ALIGN 16
+
+/* Байты-заполнители отладочного режима */
+#define REGION_POISON_FREED 0xDD
+#define REGION_POISON_ALLOC 0xCD
+
+/* Регион */
+typedef struct {
+    uint8_t *base;      /* Блок памяти региона */
+    size_t capacity;    /* Размер блока */
+    size_t used;        /* Занято от начала блока */
+    size_t peak;        /* Наибольшее занятое за время жизни региона */
+} Region;
+
+/* Создание региона заданной ёмкости. Возвращает 0 или -1 при ошибке выделения */
+int region_init(Region *region, size_t capacity);
+
+/* Выделение выровненного блока, NULL если ёмкость исчерпана */
+void* region_alloc(Region *region, size_t size);
+
+/* Выделение обнулённого блока */
+void* region_calloc(Region *region, size_t count, size_t size);
+
+/* Отметка текущей позиции (для временных буферов) */
+size_t region_mark(const Region *region);
+
+/* Освобождение всего, что выделено после отметки */
+void region_rewind(Region *region, size_t mark);
+
+/* Освобождение всей памяти региона (блок остаётся за регионом) */
+void region_reset(Region *region);
+
+/* Освобождение блока региона */
+void region_destroy(Region *region);
+
+#endif /* REGION_H */
@@ -0,0 +1,54 @@
+/*
+ * rng.c - Реализация генератора псевдослучайных чисел
+ */
+
+#include "rng.h"
+
+/* Шаг splitmix64 - раскладывает зерно по состоянию генератора */
+static uint64_t splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/* Циклический сдвиг влево */
+static uint32_t rotl(uint32_t x, int k) {
+    return (x << k) | (x >> (32 - k));
+}
+
+/* Создание генератора из зерна */
+Rng rng_create(uint64_t seed) {
+    Rng rng;
+    uint64_t a = splitmix64(&seed);
+    uint64_t b = splitmix64(&seed);
+    rng.s[0] = (uint32_t)a;
+    rng.s[1] = (uint32_t)(a >> 32);
+    rng.s[2] = (uint32_t)b;
+    rng.s[3] = (uint32_t)(b >> 32);
+    return rng;
+}
+
+/* Следующее 32-битное число */
+uint32_t rng_next(Rng *rng) {
+    uint32_t *s = rng->s;
+    uint32_t result = rotl(s[1] * 5, 7) * 9;
+    uint32_t t = s[1] << 9;
+    
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 11);
+    
+    return result;
+}
+
+/* Случайное число в диапазоне [min, max] */
+int rng_range(Rng *rng, int min_val, int max_val) {
+    if (min_val >= max_val) return min_val;
+    uint32_t span = (uint32_t)(max_val - min_val) + 1;
+    /* Умножение со сдвигом вместо деления по модулю */
+    return min_val + (int)(((uint64_t)rng_next(rng) * span) >> 32);
+}
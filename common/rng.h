@@ -0,0 +1,25 @@
+/*
+ * rng.h - Генератор псевдослучайных чисел
+ * Быстрый воспроизводимый генератор (xoshiro128**) с явным состоянием
+ */
+
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+/* Состояние генератора */
+typedef struct {
+    uint32_t s[4];  /* Внутреннее состояние xoshiro128** */
+} Rng;
+
+/* Создание генератора из зерна (одно зерно - одна последовательность) */
+Rng rng_create(uint64_t seed);
+
+/* Следующее 32-битное число */
+uint32_t rng_next(Rng *rng);
+
+/* Случайное число в диапазоне [min, max] */
+int rng_range(Rng *rng, int min_val, int max_val);
+
+#endif /* RNG_H */
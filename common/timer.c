@@ -0,0 +1,138 @@
+/*
+ * timer.c - Реализация иерархического колеса таймеров
+ */
+
+#include "timer.h"
+#include <string.h>
+
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+
+/* Максимальная задержка, которую колесо размещает без перестановки */
+#define TIMER_WHEEL_RANGE ((uint64_t)1 << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS))
+
+/* Вставка в голову списка слота */
+static void slot_push(Timer **slot, Timer *timer) {
+    timer->next = *slot;
+    if (*slot) (*slot)->pprev = &timer->next;
+    *slot = timer;
+    timer->pprev = slot;
+}
+
+/* Размещение таймера по уровню, соответствующему оставшейся задержке */
+static void wheel_place(TimerWheel *wheel, Timer *timer) {
+    uint64_t expires = timer->expires;
+    
+    /* Просроченный таймер срабатывает на ближайшем тике */
+    if (expires < wheel->next_tick) {
+        slot_push(&wheel->slots[0][wheel->next_tick & TIMER_WHEEL_MASK], timer);
+        return;
+    }
+    
+    /* Слишком дальний таймер ставится на край колеса и переставится при проходе */
+    uint64_t delta = expires - wheel->next_tick;
+    if (delta >= TIMER_WHEEL_RANGE) {
+        expires = wheel->next_tick + TIMER_WHEEL_RANGE - 1;
+        delta = TIMER_WHEEL_RANGE - 1;
+    }
+    
+    int level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >= ((uint64_t)1 << (TIMER_WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    int slot = (int)((expires >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK);
+    slot_push(&wheel->slots[level][slot], timer);
+}
+
+/* Перенос слота верхнего уровня на нижние, возвращает индекс слота */
+static int wheel_cascade(TimerWheel *wheel, int level) {
+    int index = (int)((wheel->next_tick >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK);
+    Timer *list = wheel->slots[level][index];
+    wheel->slots[level][index] = NULL;
+    
+    while (list) {
+        Timer *timer = list;
+        list = timer->next;
+        wheel_place(wheel, timer);
+    }
+    return index;
+}
+
+/* Инициализация пустого колеса */
+void timer_wheel_init(TimerWheel *wheel) {
+    memset(wheel->slots, 0, sizeof(wheel->slots));
+    wheel->next_tick = 0;
+    wheel->pending = 0;
+}
+
+/* Обработка одного тика */
+int timer_wheel_tick(TimerWheel *wheel) {
+    uint64_t tick = wheel->next_tick;
+    int index = (int)(tick & TIMER_WHEEL_MASK);
+    
+    /* Нижний уровень прошёл круг: спускаем по слоту с каждого уровня выше,
+     * пока индекс уровня тоже не оказался в начале круга */
+    if (index == 0) {
+        for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+            if (wheel_cascade(wheel, level) != 0) break;
+        }
+    }
+    wheel->next_tick++;
+    
+    /* Забираем список целиком: обработчики могут ставить таймеры заново */
+    Timer *list = wheel->slots[0][index];
+    wheel->slots[0][index] = NULL;
+    if (list) list->pprev = &list;
+    
+    int fired = 0;
+    while (list) {
+        Timer *timer = list;
+        list = timer->next;
+        if (list) list->pprev = &list;
+        timer->next = NULL;
+        timer->pprev = NULL;
+        
+        /* Таймер дальше диапазона колеса ещё не дошёл до срока */
+        if (timer->expires > tick) {
+            wheel_place(wheel, timer);
+            continue;
+        }
+        
+        wheel->pending--;
+        fired++;
+        timer->callback(timer, timer->user);
+    }
+    return fired;
+}
+
+/* Инициализация таймера */
+void timer_init(Timer *timer, TimerCallback callback, void *user) {
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->expires = 0;
+    timer->callback = callback;
+    timer->user = user;
+}
+
+/* Постановка таймера */
+void timer_schedule(TimerWheel *wheel, Timer *timer, uint64_t delay) {
+    timer_cancel(wheel, timer);
+    timer->expires = wheel->next_tick + delay;
+    wheel_place(wheel, timer);
+    wheel->pending++;
+}
+
+/* Отмена таймера */
+void timer_cancel(TimerWheel *wheel, Timer *timer) {
+    if (!timer->pprev) return;
+    
+    *timer->pprev = timer->next;
+    if (timer->next) timer->next->pprev = timer->pprev;
+    timer->next = NULL;
+    timer->pprev = NULL;
+    wheel->pending--;
+}
+
+/* Проверка, запланирован ли таймер */
+int timer_is_pending(const Timer *timer) {
+    return timer->pprev != NULL;
+}
@@ -0,0 +1,59 @@
+/*
+ * timer.h - Иерархическое колесо таймеров
+ * Отложенные события по тикам игрового цикла: отсчёт до новой арены,
+ * таймауты входа, отключение бездействующих игроков. Таймеры встраиваются
+ * в структуры владельцев, поэтому постановка и отмена - O(1) без выделения памяти
+ */
+
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+
+/* Колесо: TIMER_WHEEL_LEVELS уровней по TIMER_WHEEL_SLOTS слотов.
+ * Уровень L покрывает задержки до 64^(L+1) тиков, всего 2^24 тиков (~3 суток при 62 Гц);
+ * более дальние таймеры досрочно проходят по колесу и переставляются */
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 4
+
+typedef struct Timer Timer;
+
+/* Обработчик срабатывания (может заново поставить этот же таймер) */
+typedef void (*TimerCallback)(Timer *timer, void *user);
+
+/* Таймер (встраивается в структуру владельца) */
+struct Timer {
+    Timer *next;            /* Следующий таймер слота */
+    Timer **pprev;          /* Указатель, ссылающийся на этот таймер (NULL - не запланирован) */
+    uint64_t expires;       /* Тик срабатывания */
+    TimerCallback callback; /* Обработчик */
+    void *user;             /* Данные обработчика */
+};
+
+/* Колесо таймеров. Слоты ссылаются на структуру, поэтому колесо не копируется */
+typedef struct {
+    Timer *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    uint64_t next_tick;     /* Следующий обрабатываемый тик */
+    int pending;            /* Количество запланированных таймеров */
+} TimerWheel;
+
+/* Инициализация пустого колеса на месте, первый тик - 0 */
+void timer_wheel_init(TimerWheel *wheel);
+
+/* Обработка одного тика: срабатывают таймеры этого тика. Возвращает их количество */
+int timer_wheel_tick(TimerWheel *wheel);
+
+/* Инициализация таймера (не запланирован) */
+void timer_init(Timer *timer, TimerCallback callback, void *user);
+
+/* Постановка таймера через delay тиков (0 - на следующем тике). Запланированный таймер переставляется */
+void timer_schedule(TimerWheel *wheel, Timer *timer, uint64_t delay);
+
+/* Отмена таймера (незапланированный таймер не меняется) */
+void timer_cancel(TimerWheel *wheel, Timer *timer);
+
+/* Проверка, запланирован ли таймер */
+int timer_is_pending(const Timer *timer);
+
+#endif /* TIMER_H */
@@ -20,11 +20,5 @@ int util_clamp(int value, int min_val, int max_val);
 /* Безопасное копирование строки */
 void util_strncpy(char *dest, const char *src, size_t n);
 
-/* Генерация случайного числа в диапазоне [min, max] */
-int util_random(int min_val, int max_val);
-
-/* Инициализация генератора случайных чисел */
-void util_random_init(void);
-
 #endif /* UTIL_H */
 
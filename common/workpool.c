@@ -0,0 +1,161 @@
+/*
+ * workpool.c - Реализация пула потоков с кражей работы
+ */
+
+#include "workpool.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* Очередь задач потока: диапазон [begin, end) */
+typedef struct {
+    pthread_mutex_t lock;   /* Защита диапазона */
+    int begin;              /* Следующая своя задача (берётся с начала) */
+    int end;                /* Граница диапазона (кража идёт с конца) */
+} WorkRange;
+
+/* Общее состояние пула */
+typedef struct {
+    WorkRange *ranges;      /* Диапазоны всех потоков */
+    int thread_count;       /* Количество потоков */
+    WorkFn fn;              /* Функция задачи */
+    void *ctx;              /* Контекст задачи */
+} WorkPool;
+
+/* Аргумент рабочего потока */
+typedef struct {
+    WorkPool *pool;         /* Пул */
+    int worker;             /* Номер потока */
+} WorkerArg;
+
+/* Взять свою следующую задачу, -1 если диапазон пуст */
+static int take_own(WorkRange *range) {
+    int index = -1;
+    pthread_mutex_lock(&range->lock);
+    if (range->begin < range->end) {
+        index = range->begin++;
+    }
+    pthread_mutex_unlock(&range->lock);
+    return index;
+}
+
+/* Украсть половину остатка у самого загруженного потока в свой диапазон */
+static int steal(WorkPool *pool, int worker) {
+    int victim = -1;
+    int best_left = 0;
+    
+    /* Выбираем жертву с наибольшим остатком */
+    for (int i = 0; i < pool->thread_count; i++) {
+        if (i == worker) continue;
+        WorkRange *range = &pool->ranges[i];
+        pthread_mutex_lock(&range->lock);
+        int left = range->end - range->begin;
+        pthread_mutex_unlock(&range->lock);
+        if (left > best_left) {
+            best_left = left;
+            victim = i;
+        }
+    }
+    if (victim < 0) return 0;
+    
+    WorkRange *from = &pool->ranges[victim];
+    int begin = 0;
+    int end = 0;
+    pthread_mutex_lock(&from->lock);
+    int left = from->end - from->begin;
+    if (left > 0) {
+        int take = (left + 1) / 2;
+        end = from->end;
+        begin = end - take;
+        from->end = begin;
+    }
+    pthread_mutex_unlock(&from->lock);
+    if (begin == end) return 1;  /* Жертва успела опустеть - пробуем снова */
+    
+    WorkRange *own = &pool->ranges[worker];
+    pthread_mutex_lock(&own->lock);
+    own->begin = begin;
+    own->end = end;
+    pthread_mutex_unlock(&own->lock);
+    return 1;
+}
+
+/* Рабочий поток */
+static void *worker_main(void *arg) {
+    WorkerArg *worker_arg = (WorkerArg *)arg;
+    WorkPool *pool = worker_arg->pool;
+    int worker = worker_arg->worker;
+    
+    for (;;) {
+        int index = take_own(&pool->ranges[worker]);
+        if (index >= 0) {
+            pool->fn(index, worker, pool->ctx);
+            continue;
+        }
+        if (!steal(pool, worker)) break;
+    }
+    return NULL;
+}
+
+/* Выполнение задач на пуле потоков */
+int workpool_run(int thread_count, int task_count, WorkFn fn, void *ctx) {
+    if (task_count <= 0) return 0;
+    if (thread_count < 1) thread_count = 1;
+    if (thread_count > WORKPOOL_MAX_THREADS) thread_count = WORKPOOL_MAX_THREADS;
+    if (thread_count > task_count) thread_count = task_count;
+    
+    WorkPool pool;
+    pool.thread_count = thread_count;
+    pool.fn = fn;
+    pool.ctx = ctx;
+    pool.ranges = (WorkRange *)malloc((size_t)thread_count * sizeof(WorkRange));
+    pthread_t *threads = (pthread_t *)malloc((size_t)thread_count * sizeof(pthread_t));
+    WorkerArg *args = (WorkerArg *)malloc((size_t)thread_count * sizeof(WorkerArg));
+    if (!pool.ranges || !threads || !args) {
+        free(pool.ranges);
+        free(threads);
+        free(args);
+        return -1;
+    }
+    
+    /* Начальное разбиение на равные непрерывные диапазоны */
+    for (int i = 0; i < thread_count; i++) {
+        pthread_mutex_init(&pool.ranges[i].lock, NULL);
+        pool.ranges[i].begin = (int)((long)task_count * i / thread_count);
+        pool.ranges[i].end = (int)((long)task_count * (i + 1) / thread_count);
+    }
+    
+    /* Поток 0 - вызывающий, остальные создаются. Если поток создать не удалось,
+     * его диапазон разберут кражей остальные */
+    int started = 1;
+    for (int i = 1; i < thread_count; i++) {
+        args[i].pool = &pool;
+        args[i].worker = i;
+        if (pthread_create(&threads[i], NULL, worker_main, &args[i]) != 0) {
+            break;
+        }
+        started++;
+    }
+    
+    args[0].pool = &pool;
+    args[0].worker = 0;
+    worker_main(&args[0]);
+    
+    for (int i = 1; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    
+    for (int i = 0; i < thread_count; i++) {
+        pthread_mutex_destroy(&pool.ranges[i].lock);
+    }
+    free(pool.ranges);
+    free(threads);
+    free(args);
+    return 0;
+}
+
+/* Количество доступных процессорных ядер */
+int workpool_cpu_count(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0) ? (int)count : 1;
+}
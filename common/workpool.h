@@ -0,0 +1,24 @@
+/*
+ * workpool.h - Пул потоков с кражей работы
+ * Параллельный прогон независимых задач с индексами [0, task_count)
+ */
+
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+/* Максимальное количество рабочих потоков */
+#define WORKPOOL_MAX_THREADS 256
+
+/* Задача: index - номер задачи, worker - номер рабочего потока */
+typedef void (*WorkFn)(int index, int worker, void *ctx);
+
+/* Выполнение task_count задач на thread_count потоках.
+ * Каждый поток начинает со своего непрерывного диапазона задач, а закончив его,
+ * крадёт половину остатка у самого загруженного соседа.
+ * Возвращает 0 при успехе, -1 при ошибке выделения памяти */
+int workpool_run(int thread_count, int task_count, WorkFn fn, void *ctx);
+
+/* Количество доступных процессорных ядер */
+int workpool_cpu_count(void);
+
+#endif /* WORKPOOL_H */
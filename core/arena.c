@@ -4,7 +4,7 @@
 
 #include "arena.h"
 #include <stdlib.h>
-#include <stdio.h>
+#include <string.h>
 
 /* Константы заклинаний */
 #define SPELL_BASIC_DAMAGE 5       /* Урон базовой атаки */
@@ -15,128 +15,512 @@
 #define SPELL_POWER_SPEED 10.0f    /* Скорость усиленной атаки (уменьшена для видимости) */
 #define SPELL_POWER_ENERGY 10      /* Затрата маны усиленной атаки */
 
-/* Создание арены с картой заданного размера */
-Arena arena_create(int map_size) {
-    Arena arena;
-    arena.map = map_create(map_size);
-    arena.entity_count = 0;
-    arena.spell_count = 0;
-    arena.next_entity_id = 1;
-    arena.next_spell_id = 1;
-    return arena;
+#define SPELL_BLAST_DAMAGE 6       /* Урон взрыва каждой сущности в радиусе */
+#define SPELL_BLAST_SPEED 5.0f     /* Скорость взрывного снаряда */
+#define SPELL_BLAST_ENERGY 20      /* Затрата маны взрыва */
+#define SPELL_BLAST_RADIUS 2       /* Радиус взрыва в клетках */
+
+/* Объём региона под арену */
+size_t arena_region_size(int map_size) {
+    return sizeof(Arena) + REGION_ALIGN + map_region_size(map_size);
+}
+
+/* Создание пустой арены на месте */
+void arena_init(Arena *arena, const Map *map) {
+    arena->map = map;
+    
+    /* Состояние обнуляется целиком: снимки одинаковых состояний совпадают побайтно */
+    memset(&arena->state, 0, sizeof(arena->state));
+    arena_set_capacity(arena, MAX_ENTITIES);
+    arena->event_count = 0;
+    arena->event_pending = 0;
+    arena->events_dropped = 0;
+    arena->death_count = 0;
+    memset(arena->state.history, 0xFF, sizeof(arena->state.history));
+    memset(arena->state.grid_head, 0xFF, sizeof(arena->state.grid_head));
+    
+    /* Все слоты пула свободны, первым выдаётся слот 0 */
+    arena->state.spell_free_count = MAX_SPELLS;
+    for (int i = 0; i < MAX_SPELLS; i++) {
+        arena->state.spell_free[i] = MAX_SPELLS - 1 - i;
+    }
+}
+
+/* Запись события в журнал тика (конец журнала оставлен под смерти) */
+static void arena_emit(Arena *arena, ArenaEventType type, int entity_id, int source_id,
+                       int spell_id, Vec2 position, int value) {
+    int limit = (type == ARENA_EVENT_ENTITY_DIED) ? ARENA_MAX_EVENTS : ARENA_MAX_EVENTS - MAX_ENTITIES;
+    if (arena->event_count >= limit) {
+        arena->events_dropped++;
+        return;
+    }
+    if (type == ARENA_EVENT_ENTITY_DIED && arena->death_count < MAX_ENTITIES) {
+        arena->death_events[arena->death_count++] = arena->event_count;
+    }
+    ArenaEvent *event = &arena->events[arena->event_count++];
+    event->type = type;
+    event->entity_id = entity_id;
+    event->source_id = source_id;
+    event->spell_id = spell_id;
+    event->position = position;
+    event->value = value;
+}
+
+/* Корзина сетки для клетки */
+static int arena_grid_bucket(Vec2 pos) {
+    int gx = (pos.x >> ARENA_GRID_SHIFT) & (ARENA_GRID_SIDE - 1);
+    int gy = (pos.y >> ARENA_GRID_SHIFT) & (ARENA_GRID_SIDE - 1);
+    return gy * ARENA_GRID_SIDE + gx;
+}
+
+/* Добавление слота в корзину его позиции */
+static void arena_grid_insert(Arena *arena, int slot) {
+    ArenaState *state = &arena->state;
+    int bucket = arena_grid_bucket(state->entities[slot].position);
+    int head = state->grid_head[bucket];
+    state->grid_prev[slot] = -1;
+    state->grid_next[slot] = head;
+    if (head >= 0) state->grid_prev[head] = slot;
+    state->grid_head[bucket] = slot;
+}
+
+/* Исключение слота из корзины его позиции (до изменения позиции) */
+static void arena_grid_remove(Arena *arena, int slot) {
+    ArenaState *state = &arena->state;
+    int prev = state->grid_prev[slot];
+    int next = state->grid_next[slot];
+    if (prev >= 0) state->grid_next[prev] = next;
+    else state->grid_head[arena_grid_bucket(state->entities[slot].position)] = next;
+    if (next >= 0) state->grid_prev[next] = prev;
 }
 
 /* Добавление сущности на арену */
 int arena_add_entity(Arena *arena, char symbol, Vec2 pos, int max_health, int max_energy) {
-    if (arena->entity_count >= MAX_ENTITIES) {
-        return -1;
+    /* Развёрнутое ядро не видит слоты от его ёмкости и выше: сущность в таком слоте
+     * не получала бы попаданий и не попадала бы в историю */
+    int slot;
+    if (arena->state.free_slot_count > 0 &&
+        arena->state.free_slots[arena->state.free_slot_count - 1] < arena_capacity(arena)) {
+        /* Повторно используем освобождённый слот со следующим поколением */
+        slot = arena->state.free_slots[--arena->state.free_slot_count];
+    } else if (arena->state.entity_count < arena_capacity(arena)) {
+        slot = arena->state.entity_count++;
+        arena->state.entity_generation[slot] = 1;
+    } else {
+        return ENTITY_ID_NONE;
     }
     
-    int id = arena->next_entity_id++;
-    arena->entities[arena->entity_count] = entity_create(id, symbol, pos, max_health, max_energy);
-    arena->entity_count++;
+    int id = ENTITY_ID_MAKE(slot, arena->state.entity_generation[slot]);
+    entity_create(&arena->state.entities[slot], &arena->state.entity_cold[slot], id, symbol, pos,
+                  max_health, max_energy);
+    arena->state.alive_count++;
+    arena_grid_insert(arena, slot);
     return id;
 }
 
+/* Удаление сущности с арены */
+void arena_remove_entity(Arena *arena, int id) {
+    Entity *entity = arena_get_entity(arena, id);
+    if (!entity) return;
+    
+    int slot = ENTITY_ID_SLOT(id);
+    if (entity->alive) {
+        arena->state.alive_count--;
+        arena_grid_remove(arena, slot);
+    }
+    entity->id = ENTITY_ID_NONE;
+    entity->alive = 0;
+    
+    /* История слота не должна достаться следующей сущности */
+    for (int t = 0; t < ARENA_HISTORY_TICKS; t++) {
+        arena->state.history[t][slot].x = -1;
+    }
+    
+    /* Слот может достаться новой сущности: снимаем его отметки в живых заклинаниях */
+    for (int i = 0; i < arena->state.spell_count; i++) {
+        spell_clear_affected(arena_get_spell(arena, i), id);
+    }
+    
+    /* Новое поколение делает все выданные хэндлы слота невалидными */
+    int generation = arena->state.entity_generation[slot] + 1;
+    arena->state.entity_generation[slot] = (generation > ENTITY_GENERATION_MAX) ? 1 : generation;
+    arena->state.free_slots[arena->state.free_slot_count++] = slot;
+}
+
 /* Добавление заклинания на арену */
 int arena_add_spell(Arena *arena, int caster_id, Vec2 pos, Direction dir, int damage, float speed, int spell_type) {
-    if (arena->spell_count >= MAX_SPELLS) {
+    if (arena->state.spell_free_count == 0) {
         return -1;
     }
     
-    int id = arena->next_spell_id++;
-    arena->spells[arena->spell_count] = spell_create(id, caster_id, pos, dir, damage, speed, spell_type);
-    arena->spell_count++;
-    printf("DEBUG: Spell created id=%d pos=(%d,%d) dir=%d type=%d speed=%.1f\n", 
-           id, (int)pos.x, (int)pos.y, dir, spell_type, speed);
+    int id = arena->state.spell_free[--arena->state.spell_free_count];
+    spell_create(&arena->state.spells[id], id, caster_id, pos, dir, damage, speed, spell_type);
+    arena->state.spell_alive[arena->state.spell_count++] = id;
+    arena_emit(arena, ARENA_EVENT_SPELL_SPAWNED, caster_id, ENTITY_ID_NONE, id, pos, 0);
     return id;
 }
 
 /* Время между перемещениями заклинания */
 #define SPELL_MOVE_INTERVAL 0.066f
 
-/* Проверка коллизии заклинания с сущностями на текущей позиции */
-static int check_spell_collision(Arena *arena, Spell *spell) {
-    for (int j = 0; j < arena->entity_count; j++) {
-        Entity *entity = &arena->entities[j];
-        if (!entity->alive) continue;
-        if (entity->id == spell->caster_id) continue;  /* Не бьём себя */
-        if (spell_has_affected(spell, entity->id)) continue;
-        
-        if (vec2_equals(spell->position, entity->position)) {
-            entity_take_damage(entity, spell->damage);
-            spell_mark_affected(spell, entity->id);
-            spell_destroy(spell);
-            return 1;  /* Коллизия произошла */
-        }
+/* Нанесение урона сущности с учётом счётчика живых и журнала событий.
+ * Вызывается внутри arena_update, урон относится к обновляемому тику */
+static void arena_damage_entity(Arena *arena, Entity *entity, int attacker_id, int damage) {
+    EntityCold *cold = &arena->state.entity_cold[ENTITY_ID_SLOT(entity->id)];
+    int lethal = entity_take_damage(entity, cold, damage, arena->state.tick + 1);
+    arena_emit(arena, ARENA_EVENT_DAMAGE, entity->id, attacker_id, -1, entity->position, damage);
+    if (lethal) {
+        arena->state.alive_count--;
+        arena_grid_remove(arena, ENTITY_ID_SLOT(entity->id));
+        arena_emit(arena, ARENA_EVENT_ENTITY_DIED, entity->id, attacker_id, -1, entity->position, 0);
     }
-    return 0;  /* Нет коллизии */
 }
 
-/* Обновление арены */
-void arena_update(Arena *arena, float delta_time) {
-    /* Обновляем кулдауны сущностей */
-    for (int i = 0; i < arena->entity_count; i++) {
-        entity_update_cooldowns(&arena->entities[i], delta_time);
+/* Запись позиции слота в строку истории. Слоты за entity_count обнулены
+ * при создании арены (alive = 0) и записываются как пустые */
+static inline void arena_record_slot(Arena *arena, ArenaHistoryPos *row, int slot) {
+    Entity *entity = &arena->state.entities[slot];
+    if (entity->alive) {
+        row[slot].x = (int16_t)entity->position.x;
+        row[slot].y = (int16_t)entity->position.y;
+    } else {
+        row[slot].x = -1;
+        row[slot].y = -1;
+    }
+}
+
+/* Запись позиций сущностей после обновления в историю (любое число сущностей) */
+static void arena_record_history_generic(Arena *arena) {
+    ArenaHistoryPos *row = arena->state.history[arena->state.tick & (ARENA_HISTORY_TICKS - 1)];
+    for (int i = 0; i < MAX_ENTITIES; i++) {
+        arena_record_slot(arena, row, i);
+    }
+}
+
+/* Позиция сущности rewind тиков назад */
+Vec2 arena_entity_position_at(Arena *arena, Entity *entity, int rewind) {
+    if (rewind <= 0 || rewind >= ARENA_HISTORY_TICKS || (uint32_t)rewind > arena->state.tick) {
+        return entity->position;
+    }
+    
+    uint32_t tick = arena->state.tick - (uint32_t)rewind;
+    ArenaHistoryPos pos = arena->state.history[tick & (ARENA_HISTORY_TICKS - 1)][ENTITY_ID_SLOT(entity->id)];
+    if (pos.x < 0) return entity->position;  /* Сущности тогда не было */
+    return vec2_create(pos.x, pos.y);
+}
+
+/* Проверка попадания заклинания в сущность слота slot на отрезке длиной steps:
+ * ближайшая из найденных целей остаётся в best_step и hit. Бит маски затронутых
+ * берётся по номеру слота: у развёрнутых ядер это константа */
+static inline void arena_check_hit(Arena *arena, Spell *spell, Vec2 delta, int steps, int slot,
+                                   int *best_step, Entity **hit) {
+    Entity *entity = &arena->state.entities[slot];
+    if (!entity->alive) return;
+    if (entity->id == spell->caster_id) return;  /* Не бьём себя */
+    if ((spell->affected[slot / SPELL_AFFECTED_WORD_BITS] >> (slot % SPELL_AFFECTED_WORD_BITS)) & 1) return;
+    
+    /* Сущность должна лежать на линии полёта впереди заклинания */
+    Vec2 target = arena_entity_position_at(arena, entity, spell->rewind);
+    Vec2 offset = vec2_sub(target, spell->position);
+    int step;
+    if (delta.x != 0) {
+        if (offset.y != 0) return;
+        step = offset.x * delta.x;
+    } else {
+        if (offset.x != 0) return;
+        step = offset.y * delta.y;
+    }
+    
+    if (step >= 1 && step <= steps && (*best_step == 0 || step < *best_step)) {
+        *best_step = step;
+        *hit = entity;
+    }
+}
+
+/* Поиск ближайшей сущности на отрезке полёта заклинания длиной steps клеток.
+ * Цели берутся в позициях, которые видел заклинатель (spell->rewind тиков назад).
+ * Возвращает номер шага попадания (1..steps) или 0, если попаданий нет */
+static int find_spell_hit_generic(Arena *arena, Spell *spell, Vec2 delta, int steps, Entity **hit) {
+    int best_step = 0;
+    *hit = NULL;
+    
+    for (int j = 0; j < arena->state.entity_count; j++) {
+        arena_check_hit(arena, spell, delta, steps, j, &best_step, hit);
     }
+    return best_step;
+}
+
+/* Взрыв заклинания в его текущей позиции: урон всем живым в радиусе, кроме
+ * заклинателя и уже задетых (цель прямого попадания получила урон раньше).
+ * Радиус проверяется по текущим позициям, без отката на задержку заклинателя */
+static void arena_spell_explode(Arena *arena, Spell *spell) {
+    arena_emit(arena, ARENA_EVENT_SPELL_EXPLODED, spell->caster_id, ENTITY_ID_NONE, spell->id,
+               spell->position, SPELL_BLAST_RADIUS);
     
-    /* Обновляем заклинания с проверкой коллизий на каждом шаге */
-    for (int i = 0; i < arena->spell_count; i++) {
-        Spell *spell = &arena->spells[i];
+    int slots[MAX_ENTITIES];
+    int count = arena_query_radius(arena, spell->position, SPELL_BLAST_RADIUS, slots, MAX_ENTITIES);
+    for (int i = 0; i < count; i++) {
+        Entity *entity = &arena->state.entities[slots[i]];
+        if (entity->id == spell->caster_id || spell_has_affected(spell, entity->id)) continue;
+        arena_damage_entity(arena, entity, spell->caster_id, spell->damage);
+        spell_mark_affected(spell, entity->id);
+    }
+}
+
+/* Поиск попадания и запись истории - части обновления, зависящие от числа сущностей */
+typedef int (*ArenaFindHitFn)(Arena *arena, Spell *spell, Vec2 delta, int steps, Entity **hit);
+typedef void (*ArenaRecordFn)(Arena *arena);
+
+/* Тело обновления арены. Ядра вызывают его с постоянными функциями,
+ * которые после встраивания вызываются напрямую */
+static inline void arena_update_with(Arena *arena, float delta_time, ArenaFindHitFn find_hit,
+                                     ArenaRecordFn record_history) {
+    /* Журнал начинается заново; события, добавленные между тиками, относятся к этому тику */
+    int pending = arena->event_count - arena->event_pending;
+    if (arena->event_pending > 0 && pending > 0) {
+        memmove(arena->events, arena->events + arena->event_pending, (size_t)pending * sizeof(ArenaEvent));
+    }
+    arena->event_count = pending;
+    
+    /* Из списка смертей остаются только перенесённые события */
+    int deaths = 0;
+    for (int d = 0; d < arena->death_count; d++) {
+        if (arena->death_events[d] >= arena->event_pending) {
+            arena->death_events[deaths++] = arena->death_events[d] - arena->event_pending;
+        }
+    }
+    arena->death_count = deaths;
+    
+    /* Обновляем заклинания: весь путь за тик проверяется одним отрезком */
+    for (int i = 0; i < arena->state.spell_count; i++) {
+        Spell *spell = &arena->state.spells[arena->state.spell_alive[i]];
         if (spell->destroyed) continue;
         
-        /* Обновляем таймер движения */
+        /* Обновляем таймер движения и считаем число шагов за тик */
         spell->move_timer += delta_time * spell->speed;
-        
-        /* Перемещаем заклинание пошагово, проверяя коллизии на каждом шаге */
-        while (spell->move_timer >= SPELL_MOVE_INTERVAL && !spell->destroyed) {
+        int steps = 0;
+        while (spell->move_timer >= SPELL_MOVE_INTERVAL) {
             spell->move_timer -= SPELL_MOVE_INTERVAL;
-            
-            /* Вычисляем новую позицию */
-            Vec2 delta = direction_to_vec2(spell->direction);
+            steps++;
+        }
+        if (steps == 0) continue;
+        
+        /* Ограничиваем отрезок ближайшей стеной одним обращением к таблице */
+        Vec2 delta = direction_to_vec2(spell->direction);
+        int free_steps = map_distance_to_wall(arena->map, spell->position, spell->direction);
+        int travel = (steps < free_steps) ? steps : free_steps;
+        
+        /* Проверяем коллизию с сущностями на отрезке */
+        Entity *hit;
+        int hit_step = find_hit(arena, spell, delta, travel, &hit);
+        if (hit_step > 0) {
+            spell->position = vec2_add(spell->position, vec2_create(delta.x * hit_step, delta.y * hit_step));
+            arena_damage_entity(arena, hit, spell->caster_id, spell->damage);
+            spell_mark_affected(spell, hit->id);
+            spell_destroy(spell);
+            if (spell->spell_type == SPELL_TYPE_BLAST_VAL) arena_spell_explode(arena, spell);
+            continue;
+        }
+        
+        spell->position = vec2_add(spell->position, vec2_create(delta.x * travel, delta.y * travel));
+        
+        /* Путь упёрся в стену: заклинание входит в неё и уничтожается */
+        if (steps > free_steps) {
             spell->position = vec2_add(spell->position, delta);
-            
-            /* Проверяем коллизию со стеной */
-            if (!map_is_walkable(&arena->map, spell->position)) {
-                spell_destroy(spell);
-                break;
-            }
-            
-            /* Проверяем коллизию с сущностями */
-            if (check_spell_collision(arena, spell)) {
-                break;  /* Заклинание уничтожено при коллизии */
-            }
+            spell_destroy(spell);
+            arena_emit(arena, ARENA_EVENT_SPELL_HIT_WALL, spell->caster_id, ENTITY_ID_NONE,
+                       spell->id, spell->position, 0);
+            if (spell->spell_type == SPELL_TYPE_BLAST_VAL) arena_spell_explode(arena, spell);
         }
     }
     
     /* Удаляем уничтоженные заклинания */
     arena_cleanup_spells(arena);
+    arena->event_pending = arena->event_count;
+    
+    arena->state.tick++;
+    record_history(arena);
 }
 
-/* Получение сущности по ID */
-Entity* arena_get_entity(Arena *arena, int id) {
-    for (int i = 0; i < arena->entity_count; i++) {
-        if (arena->entities[i].id == id) {
-            return &arena->entities[i];
+/* Ядра обновления под фиксированное число сущностей N. Шаблон разворачивает
+ * проверки слотов 0..N-1 в прямой код без цикла по entity_count: слоты за ним
+ * обнулены (alive = 0), а номер слота - константа. Арена с таким ядром
+ * принимает не больше N сущностей */
+#define ARENA_UNROLL_2(F) F(0) F(1)
+#define ARENA_UNROLL_4(F) ARENA_UNROLL_2(F) F(2) F(3)
+#define ARENA_UNROLL_8(F) ARENA_UNROLL_4(F) F(4) F(5) F(6) F(7)
+
+#define ARENA_HIT_CHECK(slot) arena_check_hit(arena, spell, delta, steps, slot, &best_step, hit);
+#define ARENA_RECORD_SLOT(slot) arena_record_slot(arena, row, slot);
+
+#define ARENA_DEFINE_KERNEL(N) \
+    static int find_spell_hit_##N(Arena *arena, Spell *spell, Vec2 delta, int steps, Entity **hit) { \
+        int best_step = 0; \
+        *hit = NULL; \
+        ARENA_UNROLL_##N(ARENA_HIT_CHECK) \
+        return best_step; \
+    } \
+    static void arena_record_history_##N(Arena *arena) { \
+        ArenaHistoryPos *row = arena->state.history[arena->state.tick & (ARENA_HISTORY_TICKS - 1)]; \
+        ARENA_UNROLL_##N(ARENA_RECORD_SLOT) \
+    } \
+    static void arena_update_##N(Arena *arena, float delta_time) { \
+        arena_update_with(arena, delta_time, find_spell_hit_##N, arena_record_history_##N); \
+    }
+
+ARENA_DEFINE_KERNEL(2)
+#if MAX_ENTITIES >= 4
+ARENA_DEFINE_KERNEL(4)
+#endif
+#if MAX_ENTITIES >= 8
+ARENA_DEFINE_KERNEL(8)
+#endif
+
+/* Общее ядро: цикл по занятым слотам */
+static void arena_update_generic(Arena *arena, float delta_time) {
+    arena_update_with(arena, delta_time, find_spell_hit_generic, arena_record_history_generic);
+}
+
+/* Ядро обновления арены */
+struct ArenaKernel {
+    int capacity;                   /* Наибольшее число сущностей */
+    void (*update)(Arena *arena, float delta_time);
+};
+
+/* Развёрнутые ядра по возрастанию ёмкости */
+static const ArenaKernel arena_kernels[] = {
+    {2, arena_update_2},
+#if MAX_ENTITIES >= 4
+    {4, arena_update_4},
+#endif
+#if MAX_ENTITIES >= 8
+    {8, arena_update_8},
+#endif
+};
+
+static const ArenaKernel arena_kernel_generic = {MAX_ENTITIES, arena_update_generic};
+
+/* Выбор ядра обновления под наибольшее число сущностей. Ёмкость не опускается
+ * ниже числа занятых слотов: иначе ядро пропускало бы живые сущности */
+void arena_set_capacity(Arena *arena, int max_entities) {
+    if (max_entities < arena->state.entity_count) max_entities = arena->state.entity_count;
+    arena->kernel = &arena_kernel_generic;
+    for (size_t i = 0; i < sizeof(arena_kernels) / sizeof(arena_kernels[0]); i++) {
+        if (max_entities <= arena_kernels[i].capacity) {
+            arena->kernel = &arena_kernels[i];
+            break;
         }
     }
-    return NULL;
 }
 
-/* Получение сущности по позиции */
+/* Ёмкость арены */
+int arena_capacity(const Arena *arena) {
+    return arena->kernel->capacity;
+}
+
+/* Обновление арены */
+void arena_update(Arena *arena, float delta_time) {
+    arena->kernel->update(arena, delta_time);
+}
+
+/* Получение сущности по хэндлу */
+Entity* arena_get_entity(Arena *arena, int id) {
+    if (id < 0) return NULL;
+    
+    int slot = ENTITY_ID_SLOT(id);
+    if (slot >= arena->state.entity_count) return NULL;
+    
+    /* Хэндл валиден, только если поколение совпадает с текущим */
+    Entity *entity = &arena->state.entities[slot];
+    return (entity->id == id) ? entity : NULL;
+}
+
+/* Холодная часть сущности по хэндлу */
+EntityCold* arena_get_entity_cold(Arena *arena, int id) {
+    return arena_get_entity(arena, id) ? &arena->state.entity_cold[ENTITY_ID_SLOT(id)] : NULL;
+}
+
+/* Проверка, занят ли слот сущностью */
+int arena_entity_slot_used(Arena *arena, int slot) {
+    return slot >= 0 && slot < arena->state.entity_count &&
+           arena->state.entities[slot].id != ENTITY_ID_NONE;
+}
+
+/* Получение сущности по позиции: просматривается одна корзина сетки */
 Entity* arena_get_entity_at(Arena *arena, Vec2 pos) {
-    for (int i = 0; i < arena->entity_count; i++) {
-        if (arena->entities[i].alive && vec2_equals(arena->entities[i].position, pos)) {
-            return &arena->entities[i];
+    /* Из нескольких сущностей на клетке выбирается меньший слот, как при полном проходе */
+    int found = -1;
+    for (int slot = arena->state.grid_head[arena_grid_bucket(pos)]; slot >= 0; slot = arena->state.grid_next[slot]) {
+        if (vec2_equals(arena->state.entities[slot].position, pos) && (found < 0 || slot < found)) {
+            found = slot;
         }
     }
-    return NULL;
+    return (found >= 0) ? &arena->state.entities[found] : NULL;
+}
+
+/* Слова битовой маски найденных слотов */
+#define ARENA_QUERY_WORDS ((MAX_ENTITIES + 63) / 64)
+
+/* Общий обход сетки для запросов: прямоугольник [min, max], а при radius >= 0
+ * ещё и круг вокруг center. Найденные слоты собираются в маску, чтобы выдать
+ * их по возрастанию независимо от порядка в корзинах */
+static int arena_query(Arena *arena, Vec2 min, Vec2 max, Vec2 center, int radius, int *slots, int capacity) {
+    if (min.x < 0) min.x = 0;
+    if (min.y < 0) min.y = 0;
+    if (min.x > max.x || min.y > max.y) return 0;
+    
+    /* Область шире таблицы корзин обходит каждую корзину один раз */
+    int gx0 = min.x >> ARENA_GRID_SHIFT;
+    int gy0 = min.y >> ARENA_GRID_SHIFT;
+    int gx1 = max.x >> ARENA_GRID_SHIFT;
+    int gy1 = max.y >> ARENA_GRID_SHIFT;
+    if (gx1 - gx0 >= ARENA_GRID_SIDE) gx1 = gx0 + ARENA_GRID_SIDE - 1;
+    if (gy1 - gy0 >= ARENA_GRID_SIDE) gy1 = gy0 + ARENA_GRID_SIDE - 1;
+    
+    uint64_t found[ARENA_QUERY_WORDS] = {0};
+    int radius_sq = radius * radius;
+    for (int gy = gy0; gy <= gy1; gy++) {
+        for (int gx = gx0; gx <= gx1; gx++) {
+            int bucket = (gy & (ARENA_GRID_SIDE - 1)) * ARENA_GRID_SIDE + (gx & (ARENA_GRID_SIDE - 1));
+            for (int slot = arena->state.grid_head[bucket]; slot >= 0; slot = arena->state.grid_next[slot]) {
+                Vec2 pos = arena->state.entities[slot].position;
+                if (pos.x < min.x || pos.x > max.x || pos.y < min.y || pos.y > max.y) continue;
+                if (radius >= 0) {
+                    Vec2 offset = vec2_sub(pos, center);
+                    if (offset.x * offset.x + offset.y * offset.y > radius_sq) continue;
+                }
+                found[slot / 64] |= (uint64_t)1 << (slot % 64);
+            }
+        }
+    }
+    
+    int count = 0;
+    for (int w = 0; w < ARENA_QUERY_WORDS; w++) {
+        for (uint64_t bits = found[w]; bits != 0; bits &= bits - 1) {
+            if (count < capacity) slots[count] = w * 64 + __builtin_ctzll(bits);
+            count++;
+        }
+    }
+    return count;
+}
+
+/* Слоты живых сущностей в прямоугольнике */
+int arena_query_rect(Arena *arena, Vec2 min, Vec2 max, int *slots, int capacity) {
+    return arena_query(arena, min, max, min, -1, slots, capacity);
+}
+
+/* Слоты живых сущностей в круге */
+int arena_query_radius(Arena *arena, Vec2 center, int radius, int *slots, int capacity) {
+    if (radius < 0) return 0;
+    Vec2 min = vec2_create(center.x - radius, center.y - radius);
+    Vec2 max = vec2_create(center.x + radius, center.y + radius);
+    return arena_query(arena, min, max, center, radius, slots, capacity);
 }
 
 /* Перемещение сущности в направлении */
 int arena_move_entity(Arena *arena, int entity_id, Direction dir) {
     Entity *entity = arena_get_entity(arena, entity_id);
-    if (!entity || !entity_can_move(entity)) {
+    if (!entity || !entity_can_move(entity, arena->state.tick)) {
         return 0;
     }
     
@@ -144,7 +528,7 @@ int arena_move_entity(Arena *arena, int entity_id, Direction dir) {
     Vec2 new_pos = vec2_add(entity->position, delta);
     
     /* Проверяем, можно ли пройти */
-    if (!map_is_walkable(&arena->map, new_pos)) {
+    if (!map_is_walkable(arena->map, new_pos)) {
         return 0;
     }
     
@@ -153,17 +537,29 @@ int arena_move_entity(Arena *arena, int entity_id, Direction dir) {
         return 0;
     }
     
-    entity->direction = dir;
-    entity_move(entity, new_pos);
+    /* Сущность переходит в другую корзину сетки, только пересекая границу квадрата */
+    int slot = ENTITY_ID_SLOT(entity_id);
+    int regrid = arena_grid_bucket(new_pos) != arena_grid_bucket(entity->position);
+    if (regrid) arena_grid_remove(arena, slot);
+    arena->state.entity_cold[slot].direction = dir;
+    entity_move(entity, new_pos, arena->state.tick);
+    if (regrid) arena_grid_insert(arena, slot);
+    arena_emit(arena, ARENA_EVENT_ENTITY_MOVED, entity_id, ENTITY_ID_NONE, -1, new_pos, 0);
     return 1;
 }
 
 /* Создание заклинания от сущности */
 int arena_cast_spell(Arena *arena, int entity_id, Direction dir, SpellType spell_type) {
+    return arena_cast_spell_rewind(arena, entity_id, dir, spell_type, 0);
+}
+
+/* Создание заклинания с проверкой попаданий по прошлым позициям целей */
+int arena_cast_spell_rewind(Arena *arena, int entity_id, Direction dir, SpellType spell_type, int rewind) {
     Entity *entity = arena_get_entity(arena, entity_id);
-    if (!entity || !entity->alive || entity->skill_cooldown > 0) {
+    if (!entity || !entity->alive || arena->state.tick < entity->skill_ready_tick) {
         return -1;
     }
+    EntityCold *cold = &arena->state.entity_cold[ENTITY_ID_SLOT(entity_id)];
     
     /* Определяем параметры заклинания в зависимости от типа */
     int damage;
@@ -174,6 +570,10 @@ int arena_cast_spell(Arena *arena, int entity_id, Direction dir, SpellType spell
         damage = SPELL_POWER_DAMAGE;
         speed = SPELL_POWER_SPEED;
         energy_cost = SPELL_POWER_ENERGY;
+    } else if (spell_type == SPELL_TYPE_BLAST) {
+        damage = SPELL_BLAST_DAMAGE;
+        speed = SPELL_BLAST_SPEED;
+        energy_cost = SPELL_BLAST_ENERGY;
     } else {
         /* По умолчанию базовая атака */
         damage = SPELL_BASIC_DAMAGE;
@@ -182,22 +582,36 @@ int arena_cast_spell(Arena *arena, int entity_id, Direction dir, SpellType spell
     }
     
     /* Проверяем и тратим энергию */
-    if (entity->energy < energy_cost) {
+    if (cold->energy < energy_cost) {
         return -1;
     }
     
     if (energy_cost > 0) {
-        entity->energy -= energy_cost;
+        cold->energy -= energy_cost;
     }
-    entity->skill_cooldown = 0.5f;  /* Кулдаун способности */
+    entity->skill_ready_tick = arena->state.tick + ENTITY_SKILL_COOLDOWN_TICKS;
     
     /* Создаём заклинание перед сущностью */
     Vec2 spell_pos = vec2_add(entity->position, direction_to_vec2(dir));
-    entity->direction = dir;
+    cold->direction = dir;
+    
+    /* Передаём тип заклинания (1 = базовая, 2 = усиленная, 3 = взрыв) */
+    int spell_type_val = SPELL_TYPE_BASIC_VAL;
+    if (spell_type == SPELL_TYPE_POWER) spell_type_val = SPELL_TYPE_POWER_VAL;
+    else if (spell_type == SPELL_TYPE_BLAST) spell_type_val = SPELL_TYPE_BLAST_VAL;
+    int id = arena_add_spell(arena, entity_id, spell_pos, dir, damage, speed, spell_type_val);
+    if (id < 0) return id;
+    Spell *spell = &arena->state.spells[id];
+    spell->rewind = (rewind < ARENA_HISTORY_TICKS) ? rewind : ARENA_HISTORY_TICKS - 1;
     
-    /* Передаём тип заклинания (1 = базовая, 2 = усиленная) */
-    int spell_type_val = (spell_type == SPELL_TYPE_POWER) ? SPELL_TYPE_POWER_VAL : SPELL_TYPE_BASIC_VAL;
-    return arena_add_spell(arena, entity_id, spell_pos, dir, damage, speed, spell_type_val);
+    /* Заклинание в упор в стену гаснет сразу: дистанция до стены из клетки стены
+     * считала бы пол за ней, и заклинание пролетело бы сквозь стену */
+    if (!map_is_walkable(arena->map, spell_pos)) {
+        spell_destroy(spell);
+        arena_emit(arena, ARENA_EVENT_SPELL_HIT_WALL, entity_id, ENTITY_ID_NONE, id, spell_pos, 0);
+        if (spell->spell_type == SPELL_TYPE_BLAST_VAL) arena_spell_explode(arena, spell);
+    }
+    return id;
 }
 
 /* Проверка, занята ли позиция сущностью */
@@ -207,33 +621,45 @@ int arena_is_position_occupied(Arena *arena, Vec2 pos) {
 
 /* Подсчёт живых сущностей */
 int arena_count_alive(Arena *arena) {
-    int count = 0;
-    for (int i = 0; i < arena->entity_count; i++) {
-        if (arena->entities[i].alive) {
-            count++;
-        }
-    }
-    return count;
+    return arena->state.alive_count;
+}
+
+/* Получение заклинания по индексу в списке живых */
+Spell* arena_get_spell(Arena *arena, int index) {
+    return &arena->state.spells[arena->state.spell_alive[index]];
 }
 
-/* Удаление уничтоженных заклинаний */
+/* Возврат уничтоженных заклинаний в пул */
 void arena_cleanup_spells(Arena *arena) {
+    /* Сжимаем только список индексов, сами заклинания остаются в своих слотах */
     int write_idx = 0;
-    for (int i = 0; i < arena->spell_count; i++) {
-        if (!arena->spells[i].destroyed) {
-            if (write_idx != i) {
-                arena->spells[write_idx] = arena->spells[i];
-            }
-            write_idx++;
+    for (int i = 0; i < arena->state.spell_count; i++) {
+        int slot = arena->state.spell_alive[i];
+        if (arena->state.spells[slot].destroyed) {
+            arena->state.spell_free[arena->state.spell_free_count++] = slot;
+        } else {
+            arena->state.spell_alive[write_idx++] = slot;
         }
     }
-    arena->spell_count = write_idx;
+    arena->state.spell_count = write_idx;
 }
 
-/* Освобождение памяти арены */
-void arena_destroy(Arena *arena) {
-    map_destroy(&arena->map);
-    arena->entity_count = 0;
-    arena->spell_count = 0;
+/* Снимок изменяемого состояния арены */
+void arena_snapshot(const Arena *arena, ArenaState *snapshot) {
+    memcpy(snapshot, &arena->state, sizeof(ArenaState));
 }
 
+/* Откат арены к снимку */
+void arena_restore(Arena *arena, const ArenaState *snapshot) {
+    memcpy(&arena->state, snapshot, sizeof(ArenaState));
+    
+    /* Снимок арены большей ёмкости расширяет ядро */
+    if (arena->state.entity_count > arena_capacity(arena)) {
+        arena_set_capacity(arena, arena->state.entity_count);
+    }
+    
+    /* События журнала относятся к отменённому будущему */
+    arena->event_count = 0;
+    arena->event_pending = 0;
+    arena->death_count = 0;
+}
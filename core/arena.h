@@ -10,52 +10,178 @@
 #include "entity.h"
 #include "spell.h"
 
+/* Тип события симуляции */
+typedef enum {
+    ARENA_EVENT_SPELL_SPAWNED = 0,  /* entity_id - заклинатель, spell_id, position - точка появления */
+    ARENA_EVENT_SPELL_HIT_WALL = 1, /* entity_id - заклинатель, spell_id, position - клетка стены */
+    ARENA_EVENT_DAMAGE = 2,         /* entity_id - цель, source_id - атакующий, value - урон */
+    ARENA_EVENT_ENTITY_DIED = 3,    /* entity_id - погибший, source_id - убийца */
+    ARENA_EVENT_ENTITY_MOVED = 4,   /* entity_id, position - новая позиция */
+    ARENA_EVENT_SPELL_EXPLODED = 5  /* entity_id - заклинатель, spell_id, position - центр, value - радиус */
+} ArenaEventType;
+
+/* Событие симуляции */
+typedef struct {
+    ArenaEventType type;
+    int entity_id;          /* Хэндл сущности, к которой относится событие */
+    int source_id;          /* Хэндл виновника (атакующий/убийца) или ENTITY_ID_NONE */
+    int spell_id;           /* Слот заклинания или -1 */
+    Vec2 position;          /* Позиция события */
+    int value;              /* Величина (урон) */
+} ArenaEvent;
+
+/* Ёмкость журнала событий за тик: на заклинание - появление, стена или взрыв,
+ * урон и смерть цели; на сущность - до двух шагов между тиками и урон от взрыва.
+ * Последние MAX_ENTITIES записей достаются только смертям: за тик сущность
+ * умирает не больше раза, поэтому очки по смертям не теряются */
+#define ARENA_MAX_EVENTS (MAX_SPELLS * 4 + MAX_ENTITIES * 4)
+
+/* Сетка сущностей для запросов по области: карта делится на квадраты
+ * 2^ARENA_GRID_SHIFT клеток, квадраты сворачиваются по модулю в таблицу
+ * ARENA_GRID_SIDE x ARENA_GRID_SIDE корзин. Размер сетки не зависит от карты,
+ * а область обходит каждую корзину не больше одного раза */
+#define ARENA_GRID_SHIFT 3
+#define ARENA_GRID_SIDE 8
+#define ARENA_GRID_BUCKETS (ARENA_GRID_SIDE * ARENA_GRID_SIDE)
+
+/* Глубина истории позиций сущностей в тиках (степень двойки).
+ * Откат при компенсации лага не может быть больше ARENA_HISTORY_TICKS - 1 */
+#define ARENA_HISTORY_TICKS 32
+
+/* Позиция сущности в истории (x < 0 - слот в этом тике пуст) */
+typedef struct {
+    int16_t x;
+    int16_t y;
+} ArenaHistoryPos;
+
+/* Изменяемое состояние арены: один непрерывный блок без указателей,
+ * поэтому снимок и откат - одно копирование памяти */
+typedef struct {
+    Entity entities[MAX_ENTITIES];  /* Горячие части сущностей (индекс = слот хэндла) */
+    EntityCold entity_cold[MAX_ENTITIES]; /* Холодные части сущностей под теми же слотами */
+    int entity_count;               /* Количество использованных слотов */
+    int entity_generation[MAX_ENTITIES]; /* Текущее поколение каждого слота */
+    int free_slots[MAX_ENTITIES];   /* Стек освобождённых слотов */
+    int free_slot_count;            /* Количество освобождённых слотов */
+    int alive_count;                /* Количество живых сущностей */
+    Spell spells[MAX_SPELLS];       /* Пул заклинаний (индекс слота = ID заклинания) */
+    int spell_alive[MAX_SPELLS];    /* Плотный список слотов живых заклинаний */
+    int spell_count;                /* Количество живых заклинаний */
+    int spell_free[MAX_SPELLS];     /* Стек свободных слотов пула */
+    int spell_free_count;           /* Количество свободных слотов */
+    
+    /* Живые сущности в корзинах сетки: двусвязные списки слотов (-1 - конец) */
+    int grid_head[ARENA_GRID_BUCKETS]; /* Первый слот корзины */
+    int grid_next[MAX_ENTITIES];    /* Следующий слот в корзине */
+    int grid_prev[MAX_ENTITIES];    /* Предыдущий слот в корзине */
+    
+    /* История позиций для компенсации лага: строка tick % ARENA_HISTORY_TICKS
+     * хранит позиции сущностей после обновления с этим номером */
+    uint32_t tick;                  /* Номер последнего обновления арены */
+    ArenaHistoryPos history[ARENA_HISTORY_TICKS][MAX_ENTITIES];
+} ArenaState;
+
+/* Ядро обновления арены под число сущностей (определено в arena.c) */
+typedef struct ArenaKernel ArenaKernel;
+
 /* Арена */
 typedef struct {
-    Map map;                        /* Карта арены */
-    Entity entities[MAX_ENTITIES];  /* Массив сущностей */
-    int entity_count;               /* Количество сущностей */
-    Spell spells[MAX_SPELLS];       /* Массив заклинаний */
-    int spell_count;                /* Количество заклинаний */
-    int next_entity_id;             /* Следующий ID для сущности */
-    int next_spell_id;              /* Следующий ID для заклинания */
+    const Map *map;                 /* Карта арены из кэша карт (неизменна, в снимки не входит) */
+    const ArenaKernel *kernel;      /* Ядро обновления под ёмкость арены (arena_set_capacity) */
+    ArenaState state;               /* Изменяемое состояние симуляции */
+    
+    /* Журнал событий тика: после arena_update содержит всё, что произошло
+     * с предыдущего обновления (включая шаги и заклинания между тиками) */
+    ArenaEvent events[ARENA_MAX_EVENTS];
+    int event_count;                /* Количество событий в журнале */
+    int event_pending;              /* Начало событий, добавленных после последнего обновления */
+    int events_dropped;             /* Событий потеряно из-за переполнения журнала */
+    
+    /* Индексы событий ENTITY_DIED в журнале: обработчики смертей не просматривают
+     * весь журнал (сущность умирает не больше одного раза) */
+    int death_events[MAX_ENTITIES];
+    int death_count;
 } Arena;
 
-/* Создание арены с картой заданного размера */
-Arena arena_create(int map_size);
+/* Объём региона, которого хватает на арену вместе с временной памятью генерации её карты */
+size_t arena_region_size(int map_size);
 
-/* Добавление сущности на арену, возвращает ID сущности или -1 при ошибке */
+/* Создание пустой арены на месте. Карта не копируется: ссылкой на неё
+ * по-прежнему владеет вызывающий (арена может жить не дольше неё) */
+void arena_init(Arena *arena, const Map *map);
+
+/* Выбор ядра обновления под наибольшее число сущностей: для 2, 4 и 8 есть
+ * развёрнутые ядра, для большего числа - общее. Вызывается до добавления сущностей,
+ * сущности сверх ёмкости ядра не добавляются, а ёмкость не опускается ниже числа
+ * уже занятых слотов. arena_init выбирает общее ядро */
+void arena_set_capacity(Arena *arena, int max_entities);
+
+/* Наибольшее число сущностей на арене при выбранном ядре */
+int arena_capacity(const Arena *arena);
+
+/* Добавление сущности на арену, возвращает хэндл сущности или ENTITY_ID_NONE при ошибке */
 int arena_add_entity(Arena *arena, char symbol, Vec2 pos, int max_health, int max_energy);
 
-/* Добавление заклинания на арену, возвращает ID заклинания или -1 при ошибке */
+/* Удаление сущности с арены (слот освобождается, старые хэндлы становятся невалидными) */
+void arena_remove_entity(Arena *arena, int id);
+
+/* Добавление заклинания на арену за O(1), возвращает слот заклинания или -1 при ошибке */
 int arena_add_spell(Arena *arena, int caster_id, Vec2 pos, Direction dir, int damage, float speed, int spell_type);
 
-/* Обновление арены (движение, коллизии, урон) */
+/* Обновление арены (движение, коллизии, урон). Журнал событий начинается заново */
 void arena_update(Arena *arena, float delta_time);
 
-/* Получение сущности по ID */
+/* Получение сущности по хэндлу за O(1), NULL если хэндл устарел */
 Entity* arena_get_entity(Arena *arena, int id);
 
+/* Холодная часть сущности по хэндлу за O(1), NULL если хэндл устарел */
+EntityCold* arena_get_entity_cold(Arena *arena, int id);
+
+/* Проверка, занят ли слот сущностью */
+int arena_entity_slot_used(Arena *arena, int slot);
+
 /* Получение сущности по позиции */
 Entity* arena_get_entity_at(Arena *arena, Vec2 pos);
 
+/* Слоты живых сущностей в прямоугольнике [min, max] (границы включаются) по возрастанию.
+ * В slots пишется не больше capacity слотов, возвращается число найденных.
+ * Стоимость зависит от сущностей в корзинах области, а не от населения арены */
+int arena_query_rect(Arena *arena, Vec2 min, Vec2 max, int *slots, int capacity);
+
+/* Слоты живых сущностей в круге радиуса radius вокруг center, как arena_query_rect */
+int arena_query_radius(Arena *arena, Vec2 center, int radius, int *slots, int capacity);
+
 /* Перемещение сущности в направлении */
 int arena_move_entity(Arena *arena, int entity_id, Direction dir);
 
-/* Создание заклинания от сущности (spell_type: SPELL_TYPE_BASIC или SPELL_TYPE_POWER) */
+/* Создание заклинания от сущности (spell_type: SPELL_TYPE_BASIC, SPELL_TYPE_POWER или SPELL_TYPE_BLAST).
+ * Заклинание в упор в стену сразу уничтожается (SPELL_HIT_WALL, у взрыва - и взрыв) */
 int arena_cast_spell(Arena *arena, int entity_id, Direction dir, SpellType spell_type);
 
+/* Создание заклинания, попадания которого проверяются по позициям сущностей
+ * rewind тиков назад (то, что видел заклинатель с задержкой) */
+int arena_cast_spell_rewind(Arena *arena, int entity_id, Direction dir, SpellType spell_type, int rewind);
+
+/* Позиция сущности rewind тиков назад (текущая, если истории нет) */
+Vec2 arena_entity_position_at(Arena *arena, Entity *entity, int rewind);
+
 /* Проверка, занята ли позиция сущностью */
 int arena_is_position_occupied(Arena *arena, Vec2 pos);
 
-/* Подсчёт живых сущностей */
+/* Количество живых сущностей (O(1), поддерживается инкрементально) */
 int arena_count_alive(Arena *arena);
 
-/* Удаление уничтоженных заклинаний */
+/* Получение заклинания по индексу в списке живых (0..spell_count-1) */
+Spell* arena_get_spell(Arena *arena, int index);
+
+/* Возврат уничтоженных заклинаний в пул (без копирования структур) */
 void arena_cleanup_spells(Arena *arena);
 
-/* Освобождение памяти арены */
-void arena_destroy(Arena *arena);
+/* Снимок изменяемого состояния арены (одно копирование, карта не копируется) */
+void arena_snapshot(const Arena *arena, ArenaState *snapshot);
+
+/* Откат арены к снимку, сделанному на этой же арене. Журнал событий очищается */
+void arena_restore(Arena *arena, const ArenaState *snapshot);
 
 #endif /* ARENA_H */
 
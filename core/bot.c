@@ -0,0 +1,288 @@
+/*
+ * bot.c - Реализация ботов на полях расстояний
+ */
+
+#include "bot.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Стоимость усиленной атаки по энергии */
+#define BOT_POWER_ENERGY 10
+
+/* Бот пропускает возможный шаг с вероятностью 1 / BOT_HOLD_ODDS */
+#define BOT_HOLD_ODDS 4
+
+/* Сколько полей может перестроиться за один тик арены (на все боты игры) */
+#define BOT_REBUILDS_PER_TICK 2
+
+/* Создание общих полей ботов */
+BotNav* bot_nav_create(void) {
+    BotNav *nav = (BotNav *)malloc(sizeof(BotNav));
+    if (!nav) return NULL;
+    memset(nav, 0, sizeof(BotNav));
+    
+    for (int i = 0; i < MAX_ENTITIES; i++) {
+        nav->fields[i].entity_id = ENTITY_ID_NONE;
+    }
+    return nav;
+}
+
+/* Сброс полей при смене арены; память полей от размера карты не зависит */
+static void bot_nav_sync(BotNav *nav, Game *game) {
+    if (nav->arena_number == game->arena_number) return;
+    
+    for (int i = 0; i < MAX_ENTITIES; i++) {
+        nav->fields[i].entity_id = ENTITY_ID_NONE;
+    }
+    nav->arena_number = game->arena_number;
+    nav->budget_tick = UINT32_MAX;
+}
+
+/* Расстояние по полю */
+int bot_field_distance(const BotField *field, Vec2 pos) {
+    int x = pos.x - field->corner.x;
+    int y = pos.y - field->corner.y;
+    if (x < 0 || y < 0 || x >= field->width || y >= field->height) return BOT_UNREACHABLE;
+    return field->dist[y * field->width + x];
+}
+
+/* Построение поля: многоисточниковый BFS от всех огневых позиций по цели внутри окна */
+static void bot_build_field(BotNav *nav, const Map *map, BotField *field, Vec2 target) {
+    int min_x = (target.x > BOT_FIELD_RADIUS) ? target.x - BOT_FIELD_RADIUS : 0;
+    int min_y = (target.y > BOT_FIELD_RADIUS) ? target.y - BOT_FIELD_RADIUS : 0;
+    int max_x = (target.x + BOT_FIELD_RADIUS < map->size - 1) ? target.x + BOT_FIELD_RADIUS : map->size - 1;
+    int max_y = (target.y + BOT_FIELD_RADIUS < map->size - 1) ? target.y + BOT_FIELD_RADIUS : map->size - 1;
+    field->corner = vec2_create(min_x, min_y);
+    field->width = max_x - min_x + 1;
+    field->height = max_y - min_y + 1;
+    
+    int width = field->width;
+    int cells = width * field->height;
+    for (int i = 0; i < cells; i++) {
+        field->dist[i] = BOT_UNREACHABLE;
+    }
+    
+    /* Огневые позиции - клетки на линиях цели в пределах прямой видимости и окна.
+     * Соседняя клетка не подходит: заклинание появляется прямо на цели и не попадает */
+    int head = 0;
+    int tail = 0;
+    for (int d = DIR_UP; d <= DIR_RIGHT; d++) {
+        Vec2 delta = direction_to_vec2((Direction)d);
+        int reach = map_distance_to_wall(map, target, (Direction)d);
+        if (reach > BOT_FIELD_RADIUS) reach = BOT_FIELD_RADIUS;
+        for (int k = 2; k <= reach; k++) {
+            int index = (target.y + delta.y * k - min_y) * width + (target.x + delta.x * k - min_x);
+            field->dist[index] = 0;
+            nav->queue[tail++] = index;
+        }
+    }
+    
+    /* Индексы - в окне; сосед за краем окна не рассматривается */
+    const int offsets[4] = { -width, width, -1, 1 };
+    while (head < tail) {
+        int index = nav->queue[head++];
+        uint16_t next_dist = (uint16_t)(field->dist[index] + 1);
+        Vec2 local = vec2_create(index % width, index / width);
+        for (int d = DIR_UP; d <= DIR_RIGHT; d++) {
+            Vec2 next = vec2_add(local, direction_to_vec2((Direction)d));
+            if (next.x < 0 || next.y < 0 || next.x >= width || next.y >= field->height) continue;
+            if (!map_is_walkable(map, vec2_create(next.x + min_x, next.y + min_y))) continue;
+            int next_index = index + offsets[d];
+            if (field->dist[next_index] != BOT_UNREACHABLE) continue;
+            field->dist[next_index] = next_dist;
+            nav->queue[tail++] = next_index;
+        }
+    }
+    nav->cells_visited += (uint64_t)cells;
+}
+
+/* Поле цели. Поле, отставшее от цели, перестраивается, пока не исчерпан бюджет тика;
+ * иначе до следующего тика отдаётся как есть */
+const BotField* bot_nav_field(BotNav *nav, Game *game, Entity *target) {
+    if (!game->arena || !target) return NULL;
+    bot_nav_sync(nav, game);
+    
+    BotField *field = &nav->fields[ENTITY_ID_SLOT(target->id)];
+    int built = (field->entity_id == target->id);
+    if (built && vec2_equals(field->origin, target->position)) {
+        return field;
+    }
+    
+    uint32_t tick = game->arena->state.tick;
+    if (nav->budget_tick != tick) {
+        nav->budget_tick = tick;
+        nav->budget = BOT_REBUILDS_PER_TICK;
+    }
+    if (nav->budget == 0) {
+        return built ? field : NULL;
+    }
+    
+    if (!field->dist) field->dist = (uint16_t *)malloc(BOT_FIELD_CELLS * sizeof(uint16_t));
+    if (!nav->queue) nav->queue = (int *)malloc(BOT_FIELD_CELLS * sizeof(int));
+    if (!field->dist || !nav->queue) return NULL;
+    
+    bot_build_field(nav, game->arena->map, field, target->position);
+    field->entity_id = target->id;
+    field->origin = target->position;
+    nav->budget--;
+    nav->rebuilds++;
+    return field;
+}
+
+/* Ранг цели при равных расстояниях: псевдослучайный по зерну матча, номеру арены
+ * и хэндлам бота и цели. В пределах арены он постоянен (бот не мечется между
+ * равноудалёнными целями), а от арены к арене меняется, поэтому ни одно место
+ * не становится общей целью */
+static uint32_t bot_tie_rank(const Game *game, int self_id, int other_id) {
+    uint64_t x = game->seed ^ ((uint64_t)(uint32_t)game->arena_number << 32);
+    x ^= (uint64_t)(uint32_t)self_id * 0x9E3779B97F4A7C15ULL;
+    x ^= (uint64_t)(uint32_t)other_id * 0xC2B2AE3D27D4EB4FULL;
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ULL;
+    x ^= x >> 33;
+    return (uint32_t)x;
+}
+
+/* Случайный шаг (цель недостижима или путь занят) */
+static Direction bot_random_direction(Rng *rng) {
+    return (Direction)rng_range(rng, DIR_UP, DIR_RIGHT);
+}
+
+/* Шаг к далёкой цели: по оси, вдоль которой разница координат сокращается;
+ * из подходящих свободных направлений выбираем случайно */
+static Direction bot_approach_direction(Arena *arena, Entity *self, Vec2 goal, Rng *rng) {
+    Vec2 diff = vec2_sub(goal, self->position);
+    Direction move = DIR_NONE;
+    int options = 0;
+    for (int d = DIR_UP; d <= DIR_RIGHT; d++) {
+        Vec2 delta = direction_to_vec2((Direction)d);
+        if (delta.x * diff.x <= 0 && delta.y * diff.y <= 0) continue;
+        Vec2 next = vec2_add(self->position, delta);
+        if (!map_is_walkable(arena->map, next) || arena_is_position_occupied(arena, next)) continue;
+        if (rng_range(rng, 0, options++) == 0) move = (Direction)d;
+    }
+    return (move != DIR_NONE) ? move : bot_random_direction(rng);
+}
+
+/* Решение бота на текущий тик */
+BotInput bot_think(BotNav *nav, Game *game, int player_index, Rng *rng) {
+    BotInput input;
+    input.move = DIR_NONE;
+    input.cast = DIR_NONE;
+    input.spell_type = SPELL_TYPE_BASIC;
+    
+    Arena *arena = game->arena;
+    if (!arena) return input;
+    Entity *self = arena_get_entity(arena, game->players[player_index].entity_id);
+    if (!self || !self->alive) return input;
+    
+    const Map *map = arena->map;
+    
+    /* Ближайший враг - тот, до чьей огневой позиции меньше шагов;
+     * из равноудалённых - с наименьшим рангом пары */
+    const BotField *field = NULL;
+    Entity *target = NULL;
+    int best_dist = BOT_UNREACHABLE;
+    uint32_t best_rank = 0;
+    
+    /* Враг, из окна поля которого бот вышел: ближайший по сумме разниц координат */
+    Entity *distant = NULL;
+    int distant_span = 0;
+    uint32_t distant_rank = 0;
+    for (int i = 0; i < game->player_count; i++) {
+        if (i == player_index) continue;
+        Entity *other = arena_get_entity(arena, game->players[i].entity_id);
+        if (!other || !other->alive) continue;
+        
+        const BotField *other_field = bot_nav_field(nav, game, other);
+        if (!other_field) continue;
+        uint32_t rank = bot_tie_rank(game, self->id, other->id);
+        int dist = bot_field_distance(other_field, self->position);
+        if (dist == BOT_UNREACHABLE) {
+            Vec2 diff = vec2_sub(other->position, self->position);
+            int span = abs(diff.x) + abs(diff.y);
+            if (abs(diff.x) > BOT_FIELD_RADIUS || abs(diff.y) > BOT_FIELD_RADIUS) {
+                if (!distant || span < distant_span || (span == distant_span && rank < distant_rank)) {
+                    distant = other;
+                    distant_span = span;
+                    distant_rank = rank;
+                }
+            }
+            continue;
+        }
+        if (dist > best_dist) continue;
+        if (dist == best_dist && target && rank >= best_rank) continue;
+        field = other_field;
+        target = other;
+        best_dist = dist;
+        best_rank = rank;
+    }
+    
+    if (!target) {
+        if (!entity_can_move(self, arena->state.tick)) return input;
+        input.move = distant ? bot_approach_direction(arena, self, distant->position, rng)
+                             : bot_random_direction(rng);
+        return input;
+    }
+    
+    /* Поле отстало от цели (бюджет перестроений исчерпан): огневая позиция
+     * по нему может уже не быть на линии, ждём свежего поля */
+    if (best_dist == 0 && !vec2_equals(field->origin, target->position)) return input;
+    
+    /* На огневой позиции: стреляем вдоль линии на цель */
+    if (best_dist == 0) {
+        Vec2 diff = vec2_sub(target->position, self->position);
+        EntityCold *self_cold = arena_get_entity_cold(arena, self->id);
+        if (entity_can_cast(self, self_cold, arena->state.tick)) {
+            if (diff.x == 0) {
+                input.cast = (diff.y < 0) ? DIR_UP : DIR_DOWN;
+            } else {
+                input.cast = (diff.x < 0) ? DIR_LEFT : DIR_RIGHT;
+            }
+            input.spell_type = (self_cold->energy >= BOT_POWER_ENERGY && rng_range(rng, 0, 2) == 0)
+                               ? SPELL_TYPE_POWER : SPELL_TYPE_BASIC;
+        }
+        return input;
+    }
+    
+    if (!entity_can_move(self, arena->state.tick)) return input;
+    
+    /* Все боты решают по одному состоянию до тика, поэтому два бота, преследующие
+     * друг друга, могут бесконечно зеркально повторять ходы друг друга. Изредка
+     * пропущенный ход ломает симметрию: цель успевает сама выйти на линию огня */
+    if (rng_range(rng, 1, BOT_HOLD_ODDS) == 1) return input;
+    
+    /* Шаг вниз по полю; среди равноценных соседей выбираем случайно */
+    int choice_dist = best_dist;
+    int options = 0;
+    for (int d = DIR_UP; d <= DIR_RIGHT; d++) {
+        Vec2 next = vec2_add(self->position, direction_to_vec2((Direction)d));
+        if (!map_is_walkable(map, next) || arena_is_position_occupied(arena, next)) continue;
+        
+        int next_dist = bot_field_distance(field, next);
+        if (next_dist < choice_dist) {
+            choice_dist = next_dist;
+            input.move = (Direction)d;
+            options = 1;
+        } else if (next_dist == choice_dist && options > 0 && rng_range(rng, 0, options++) == 0) {
+            input.move = (Direction)d;
+        }
+    }
+    
+    if (input.move == DIR_NONE) {
+        input.move = bot_random_direction(rng);
+    }
+    return input;
+}
+
+/* Освобождение полей ботов */
+void bot_nav_destroy(BotNav *nav) {
+    if (!nav) return;
+    for (int i = 0; i < MAX_ENTITIES; i++) {
+        free(nav->fields[i].dist);
+    }
+    free(nav->queue);
+    free(nav);
+}
@@ -0,0 +1,78 @@
+/*
+ * bot.h - Боты на полях расстояний
+ * Для каждого врага строится BFS-поле до ближайшей огневой позиции
+ * (клетки на его строке или столбце с открытой линией огня). Поля общие
+ * для всех ботов, поэтому решение одного бота - несколько обращений к таблицам.
+ * Поле покрывает только окно BOT_FIELD_SIDE x BOT_FIELD_SIDE вокруг цели, так что
+ * перестроение стоит не больше BOT_FIELD_CELLS клеток при любом размере карты;
+ * бот за пределами окна сначала просто сближается с целью по координатам.
+ * Поле перестраивается, только когда цель сдвинулась, и не больше
+ * BOT_REBUILDS_PER_TICK раз за тик на всю игру. Цель сдвигается не чаще раза
+ * в ENTITY_MOVE_COOLDOWN_TICKS, так что при всплеске поле отстаёт от цели
+ * на несколько тиков
+ */
+
+#ifndef BOT_H
+#define BOT_H
+
+#include <stdint.h>
+#include "game.h"
+#include "../common/rng.h"
+
+/* Соль зерна ботов: генератор решений ботов выводится из зерна матча,
+ * но не совпадает с генератором игры */
+#define BOT_SEED_SALT 0xB07B07B07ULL
+
+/* Клетка не достигает ни одной огневой позиции */
+#define BOT_UNREACHABLE 0xFFFF
+
+/* Окно поля: клетки не дальше BOT_FIELD_RADIUS от цели по каждой оси */
+#define BOT_FIELD_RADIUS 32
+#define BOT_FIELD_SIDE (2 * BOT_FIELD_RADIUS + 1)
+#define BOT_FIELD_CELLS (BOT_FIELD_SIDE * BOT_FIELD_SIDE)
+
+/* Действия бота на тик (DIR_NONE = действия нет) */
+typedef struct {
+    Direction move;         /* Направление движения */
+    Direction cast;         /* Направление заклинания */
+    SpellType spell_type;   /* Тип заклинания */
+} BotInput;
+
+/* Поле расстояний до огневых позиций по одной цели (окно карты вокруг цели) */
+typedef struct {
+    int entity_id;          /* Хэндл цели (ENTITY_ID_NONE - поле не построено) */
+    Vec2 origin;            /* Позиция цели, для которой построено поле */
+    Vec2 corner;            /* Левый верхний угол окна на карте */
+    int width;              /* Размер окна (обрезан краями карты) */
+    int height;
+    uint16_t *dist;         /* Шагов до огневой позиции [BOT_FIELD_CELLS], строки по width */
+} BotField;
+
+/* Общие поля ботов одной игры */
+typedef struct {
+    int arena_number;               /* Арена, для которой действительны поля */
+    BotField fields[MAX_ENTITIES];  /* Поля по слотам сущностей-целей */
+    int *queue;                     /* Очередь BFS [BOT_FIELD_CELLS] */
+    uint32_t budget_tick;           /* Тик арены, к которому относится бюджет */
+    int budget;                     /* Оставшиеся перестроения в этом тике */
+    int rebuilds;                   /* Количество перестроений полей (для замеров) */
+    uint64_t cells_visited;         /* Клеток, пройденных BFS за всё время (для замеров) */
+} BotNav;
+
+/* Создание общих полей ботов */
+BotNav* bot_nav_create(void);
+
+/* Поле цели: перестраивается, если цель сдвинулась и бюджет тика не исчерпан,
+ * иначе отдаётся поле для её прошлой позиции (field->origin). NULL - поля ещё нет */
+const BotField* bot_nav_field(BotNav *nav, Game *game, Entity *target);
+
+/* Расстояние от клетки до огневой позиции по полю (BOT_UNREACHABLE - вне окна или недостижима) */
+int bot_field_distance(const BotField *field, Vec2 pos);
+
+/* Решение бота игрока player_index на текущий тик */
+BotInput bot_think(BotNav *nav, Game *game, int player_index, Rng *rng);
+
+/* Освобождение полей ботов */
+void bot_nav_destroy(BotNav *nav);
+
+#endif /* BOT_H */
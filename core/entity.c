@@ -4,78 +4,72 @@
 
 #include "entity.h"
 
-/* Константы кулдаунов */
-#define MOVE_COOLDOWN 0.15f    /* Кулдаун движения в секундах */
-#define SKILL_COOLDOWN 0.5f   /* Кулдаун способности в секундах */
-
-/* Время анимации урона в секундах (66ms) */
-#define DAMAGE_ANIMATION_TIME 0.066f
-
 /* Создание сущности */
-Entity entity_create(int id, char symbol, Vec2 pos, int max_health, int max_energy) {
-    Entity e;
-    e.id = id;
-    e.symbol = symbol;
-    e.position = pos;
-    e.health = max_health;
-    e.max_health = max_health;
-    e.energy = max_energy;
-    e.max_energy = max_energy;
-    e.direction = DIR_DOWN;
-    e.spell_type = SPELL_TYPE_BASIC;  /* По умолчанию базовая атака */
-    e.alive = 1;
-    e.move_cooldown = 0.0f;
-    e.skill_cooldown = 0.0f;
-    e.damage_timer = 0.0f;
-    return e;
+void entity_create(Entity *entity, EntityCold *cold, int id, char symbol, Vec2 pos, int max_health, int max_energy) {
+    entity->id = id;
+    entity->position = pos;
+    entity->alive = 1;
+    entity->move_ready_tick = 0;
+    entity->skill_ready_tick = 0;
+    entity->damage_until_tick = 0;
+    
+    cold->symbol = symbol;
+    cold->direction = DIR_DOWN;
+    cold->spell_type = SPELL_TYPE_BASIC;  /* По умолчанию базовая атака */
+    cold->health = max_health;
+    cold->max_health = max_health;
+    cold->energy = max_energy;
+    cold->max_energy = max_energy;
 }
 
 /* Перемещение сущности */
-void entity_move(Entity *entity, Vec2 new_pos) {
+void entity_move(Entity *entity, Vec2 new_pos, uint32_t now) {
     if (entity->alive) {
         entity->position = new_pos;
-        entity->move_cooldown = MOVE_COOLDOWN;
+        entity->move_ready_tick = now + ENTITY_MOVE_COOLDOWN_TICKS;
     }
 }
 
 /* Получение урона */
-void entity_take_damage(Entity *entity, int damage) {
-    if (!entity->alive) return;
+int entity_take_damage(Entity *entity, EntityCold *cold, int damage, uint32_t now) {
+    if (!entity->alive) return 0;
     
-    entity->health -= damage;
-    entity->damage_timer = DAMAGE_ANIMATION_TIME;  /* Запускаем анимацию урона */
+    cold->health -= damage;
+    entity->damage_until_tick = now + ENTITY_DAMAGE_FLASH_TICKS;  /* Запускаем анимацию урона */
     
-    if (entity->health <= 0) {
-        entity->health = 0;
+    if (cold->health <= 0) {
+        cold->health = 0;
         entity->alive = 0;
+        return 1;
     }
+    return 0;
 }
 
 /* Восстановление здоровья */
-void entity_heal(Entity *entity, int amount) {
+void entity_heal(Entity *entity, EntityCold *cold, int amount) {
     if (!entity->alive) return;
     
-    entity->health += amount;
-    if (entity->health > entity->max_health) {
-        entity->health = entity->max_health;
+    cold->health += amount;
+    if (cold->health > cold->max_health) {
+        cold->health = cold->max_health;
     }
 }
 
 /* Использование энергии - возвращает 1 если успешно, 0 если не хватает */
-int entity_use_energy(Entity *entity, int amount) {
-    if (entity->energy >= amount) {
-        entity->energy -= amount;
-        entity->skill_cooldown = SKILL_COOLDOWN;
+int entity_use_energy(Entity *entity, EntityCold *cold, int amount, uint32_t now) {
+    if (cold->energy >= amount) {
+        cold->energy -= amount;
+        entity->skill_ready_tick = now + ENTITY_SKILL_COOLDOWN_TICKS;
         return 1;
     }
     return 0;
 }
 
 /* Восстановление энергии */
-void entity_restore_energy(Entity *entity, int amount) {
-    entity->energy += amount;
-    if (entity->energy > entity->max_energy) {
-        entity->energy = entity->max_energy;
+void entity_restore_energy(EntityCold *cold, int amount) {
+    cold->energy += amount;
+    if (cold->energy > cold->max_energy) {
+        cold->energy = cold->max_energy;
     }
 }
 
@@ -84,36 +78,27 @@ int entity_is_alive(Entity *entity) {
     return entity->alive;
 }
 
-/* Обновление кулдаунов */
-void entity_update_cooldowns(Entity *entity, float delta_time) {
-    if (entity->move_cooldown > 0) {
-        entity->move_cooldown -= delta_time;
-        if (entity->move_cooldown < 0) entity->move_cooldown = 0;
-    }
-    if (entity->skill_cooldown > 0) {
-        entity->skill_cooldown -= delta_time;
-        if (entity->skill_cooldown < 0) entity->skill_cooldown = 0;
-    }
-    if (entity->damage_timer > 0) {
-        entity->damage_timer -= delta_time;
-        if (entity->damage_timer < 0) entity->damage_timer = 0;
-    }
-}
-
 /* Проверка, может ли сущность двигаться */
-int entity_can_move(Entity *entity) {
-    return entity->alive && entity->move_cooldown <= 0;
+int entity_can_move(Entity *entity, uint32_t now) {
+    return entity->alive && now >= entity->move_ready_tick;
 }
 
 /* Проверка, может ли сущность использовать способность */
-int entity_can_cast(Entity *entity) {
-    if (!entity->alive || entity->skill_cooldown > 0) {
+int entity_can_cast(Entity *entity, EntityCold *cold, uint32_t now) {
+    if (!entity->alive || now < entity->skill_ready_tick) {
         return 0;
     }
-    /* Базовая атака не требует маны, усиленная требует 10 */
-    if (entity->spell_type == SPELL_TYPE_POWER && entity->energy < 10) {
+    /* Базовая атака не требует маны, усиленная требует 10, взрыв - 20 */
+    if (cold->spell_type == SPELL_TYPE_POWER && cold->energy < 10) {
+        return 0;
+    }
+    if (cold->spell_type == SPELL_TYPE_BLAST && cold->energy < 20) {
         return 0;
     }
     return 1;
 }
 
+/* Проверка, показывать ли подсветку урона */
+int entity_is_damaged(Entity *entity, uint32_t now) {
+    return now < entity->damage_until_tick;
+}
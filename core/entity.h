@@ -6,64 +6,99 @@
 #ifndef ENTITY_H
 #define ENTITY_H
 
+#include <stdint.h>
 #include "vec2.h"
 #include "direction.h"
 
-/* Максимальное количество сущностей на арене */
+/* Максимальное количество сущностей на арене (можно задать при сборке) */
+#ifndef MAX_ENTITIES
 #define MAX_ENTITIES 16
+#endif
+
+/* Кулдауны в тиках арены (тик 16 мс): движение 0.15 с, способность 0.5 с,
+ * подсветка урона 0.066 с, округлено вверх до целого тика */
+#define ENTITY_MOVE_COOLDOWN_TICKS 10
+#define ENTITY_SKILL_COOLDOWN_TICKS 32
+#define ENTITY_DAMAGE_FLASH_TICKS 5
+
+/* Хэндл сущности: индекс слота в младших битах, поколение слота в старших.
+ * Поколение начинается с 1, поэтому валидный хэндл всегда > 0 */
+#define ENTITY_SLOT_BITS 16
+#define ENTITY_SLOT_MASK ((1 << ENTITY_SLOT_BITS) - 1)
+#define ENTITY_GENERATION_MAX 0x7FFF
+
+/* Нет сущности */
+#define ENTITY_ID_NONE (-1)
+
+/* Сборка хэндла из слота и поколения */
+#define ENTITY_ID_MAKE(slot, generation) (((generation) << ENTITY_SLOT_BITS) | (slot))
+
+/* Индекс слота хэндла */
+#define ENTITY_ID_SLOT(id) ((id) & ENTITY_SLOT_MASK)
+
+/* Поколение хэндла */
+#define ENTITY_ID_GENERATION(id) ((id) >> ENTITY_SLOT_BITS)
 
 /* Типы заклинаний */
 typedef enum {
     SPELL_TYPE_BASIC = 1,   /* Базовая атака: урон 5, без затрат маны */
-    SPELL_TYPE_POWER = 2    /* Усиленная атака: урон 10, затрата маны 10, скорость x2 */
+    SPELL_TYPE_POWER = 2,   /* Усиленная атака: урон 10, затрата маны 10, скорость x2 */
+    SPELL_TYPE_BLAST = 3    /* Взрыв: урон 6 всем в радиусе 2 от точки попадания, затрата маны 20 */
 } SpellType;
 
-/* Игровая сущность (игрок на арене) */
+/* Игровая сущность (игрок на арене), горячая часть: поля, которые проходы
+ * по всем сущностям читают каждый тик (коллизии, движение, кулдауны).
+ * Кулдауны хранятся абсолютными тиками окончания и не требуют прохода каждый тик */
+typedef struct {
+    int id;                     /* Хэндл сущности (слот + поколение) */
+    Vec2 position;              /* Позиция на карте */
+    int alive;                  /* Флаг жизни (1 = жив, 0 = мёртв) */
+    uint32_t move_ready_tick;   /* Тик, с которого можно двигаться */
+    uint32_t skill_ready_tick;  /* Тик, с которого можно применять способность */
+    uint32_t damage_until_tick; /* Подсветка урона видна до этого тика (не включая) */
+} Entity;
+
+/* Холодная часть сущности: нужна при уроне, заклинании и отрисовке.
+ * Хранится в отдельном массиве арены под тем же слотом */
 typedef struct {
-    int id;                 /* Уникальный ID сущности */
     char symbol;            /* Символ персонажа */
-    Vec2 position;          /* Позиция на карте */
+    Direction direction;    /* Текущее направление */
+    SpellType spell_type;   /* Выбранный тип заклинания */
     int health;             /* Текущее здоровье */
     int max_health;         /* Максимальное здоровье */
     int energy;             /* Текущая энергия */
     int max_energy;         /* Максимальная энергия */
-    Direction direction;    /* Текущее направление */
-    SpellType spell_type;   /* Выбранный тип заклинания */
-    int alive;              /* Флаг жизни (1 = жив, 0 = мёртв) */
-    float move_cooldown;    /* Кулдаун движения */
-    float skill_cooldown;   /* Кулдаун способности */
-    float damage_timer;     /* Таймер анимации урона (>0 = показывать красным) */
-} Entity;
+} EntityCold;
 
-/* Создание сущности */
-Entity entity_create(int id, char symbol, Vec2 pos, int max_health, int max_energy);
+/* Создание сущности (заполняет обе части) */
+void entity_create(Entity *entity, EntityCold *cold, int id, char symbol, Vec2 pos, int max_health, int max_energy);
 
-/* Перемещение сущности */
-void entity_move(Entity *entity, Vec2 new_pos);
+/* Перемещение сущности на тике now (запускает кулдаун движения) */
+void entity_move(Entity *entity, Vec2 new_pos, uint32_t now);
 
-/* Получение урона */
-void entity_take_damage(Entity *entity, int damage);
+/* Получение урона на тике now, возвращает 1 если этот урон убил сущность */
+int entity_take_damage(Entity *entity, EntityCold *cold, int damage, uint32_t now);
 
 /* Восстановление здоровья */
-void entity_heal(Entity *entity, int amount);
+void entity_heal(Entity *entity, EntityCold *cold, int amount);
 
-/* Использование энергии */
-int entity_use_energy(Entity *entity, int amount);
+/* Использование энергии на тике now (запускает кулдаун способности) */
+int entity_use_energy(Entity *entity, EntityCold *cold, int amount, uint32_t now);
 
 /* Восстановление энергии */
-void entity_restore_energy(Entity *entity, int amount);
+void entity_restore_energy(EntityCold *cold, int amount);
 
 /* Проверка, жива ли сущность */
 int entity_is_alive(Entity *entity);
 
-/* Обновление кулдаунов */
-void entity_update_cooldowns(Entity *entity, float delta_time);
+/* Проверка, может ли сущность двигаться на тике now */
+int entity_can_move(Entity *entity, uint32_t now);
 
-/* Проверка, может ли сущность двигаться */
-int entity_can_move(Entity *entity);
+/* Проверка, может ли сущность использовать способность на тике now */
+int entity_can_cast(Entity *entity, EntityCold *cold, uint32_t now);
 
-/* Проверка, может ли сущность использовать способность */
-int entity_can_cast(Entity *entity);
+/* Проверка, показывать ли подсветку урона на тике now */
+int entity_is_damaged(Entity *entity, uint32_t now);
 
 #endif /* ENTITY_H */
 
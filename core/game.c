@@ -3,24 +3,42 @@
  */
 
 #include "game.h"
+#include "mapcache.h"
 #include <stdlib.h>
 #include <string.h>
 
-/* Константы для размещения игроков */
-#define SPAWN_OFFSET 2
+/* Объём региона комнаты: арена и заголовок карты из библиотеки. Сама карта живёт
+ * в кэше (генерируется в его временной памяти) или в файле библиотеки */
+#define GAME_REGION_SIZE (sizeof(Arena) + sizeof(Map) + 2 * REGION_ALIGN)
 
 /* Создание игры */
 Game* game_create(int map_size, int winner_points, int max_players) {
     Game *game = (Game *)malloc(sizeof(Game));
     if (!game) return NULL;
     
+    /* Регион комнаты: смена арены обходится без malloc/free */
+    if (region_init(&game->arena_region, GAME_REGION_SIZE) < 0) {
+        free(game);
+        return NULL;
+    }
+    
     game->map_size = map_size;
     game->winner_points = winner_points;
     game->max_players = max_players;
     game->arena_number = 0;
     game->state = GAME_STATE_WAITING;
     game->arena = NULL;
+    game->cached_map = NULL;
+    game->next_prepared = 0;
+    game->next_map_seed = 0;
+    game->next_map = NULL;
+    game->map_library = NULL;
+    game->library_map = -1;
     game->player_count = 0;
+    game->hold_between_arenas = 0;
+    game->input_source = NULL;
+    game->input_user = NULL;
+    game_set_seed(game, GAME_DEFAULT_SEED);
     
     /* Инициализируем массив игроков */
     for (int i = 0; i < MAX_PLAYERS; i++) {
@@ -30,6 +48,23 @@ Game* game_create(int map_size, int winner_points, int max_players) {
     return game;
 }
 
+/* Установка зерна матча */
+void game_set_seed(Game *game, uint64_t seed) {
+    game->seed = seed;
+    game->rng = rng_create(seed);
+    
+    /* Подготовленная арена выведена из прошлого зерна */
+    map_cache_release(game->next_map);
+    game->next_map = NULL;
+    game->next_prepared = 0;
+}
+
+/* Установка библиотеки карт */
+void game_set_map_library(Game *game, const MapLibrary *library, int map_index) {
+    game->map_library = library;
+    game->library_map = map_index;
+}
+
 /* Добавление игрока в игру */
 int game_add_player(Game *game, char symbol) {
     if (game->player_count >= game->max_players) {
@@ -55,6 +90,11 @@ void game_remove_player(Game *game, int player_index) {
         return;
     }
     
+    /* Убираем сущность игрока с арены: её хэндл становится невалидным */
+    if (game->arena) {
+        arena_remove_entity(game->arena, game->players[player_index].entity_id);
+    }
+    
     /* Сдвигаем остальных игроков */
     for (int i = player_index; i < game->player_count - 1; i++) {
         game->players[i] = game->players[i + 1];
@@ -82,151 +122,288 @@ int game_get_player_index(Game *game, char symbol) {
     return -1;
 }
 
-/* Генерация случайной позиции спавна на полу карты */
-static Vec2 get_random_floor_position(Map *map, Vec2 *occupied, int occupied_count) {
-    int attempts = 100;  /* Максимум попыток */
-    
-    while (attempts-- > 0) {
-        /* Случайная позиция внутри карты (не на стенах) */
-        int x = 1 + rand() % (map->size - 2);
-        int y = 1 + rand() % (map->size - 2);
-        Vec2 pos = vec2_create(x, y);
-        
-        /* Проверяем, что это пол */
-        if (map_get_terrain(map, pos) != TERRAIN_FLOOR) {
-            continue;
-        }
-        
-        /* Проверяем, что позиция не занята */
-        int is_occupied = 0;
-        for (int i = 0; i < occupied_count; i++) {
-            if (vec2_equals(pos, occupied[i])) {
-                is_occupied = 1;
-                break;
-            }
-        }
-        
-        if (!is_occupied) {
-            return pos;
-        }
+/* Подготовка следующей арены заранее */
+int game_prepare_arena(Game *game) {
+    if (!game->next_prepared) {
+        game->next_map_seed = rng_next(&game->rng);
+        game->next_map = game->map_library ? NULL : map_cache_acquire(game->map_size, game->next_map_seed);
+        game->next_prepared = 1;
+    }
+    return (game->map_library || game->next_map) ? 0 : -1;
+}
+
+/* Карта новой арены: из библиотеки (структура Map в регионе поверх файла)
+ * или из общего кэша (подготовленная заранее или полученная сейчас).
+ * Карта библиотеки больше размера комнаты отвергается: клиентам объявлен
+ * map_size как наибольший размер карты */
+static const Map* game_acquire_map(Game *game, uint32_t map_seed, const Map *prepared) {
+    if (game->map_library) {
+        int index = game->library_map;
+        if (index < 0) index = (int)(map_seed % (uint32_t)map_library_count(game->map_library));
+        if (map_library_map_size(game->map_library, index) > game->map_size) return NULL;
+        Map *map = (Map *)region_alloc(&game->arena_region, sizeof(Map));
+        if (!map) return NULL;
+        map_library_load(game->map_library, index, map);
+        return map;
     }
     
-    /* Fallback: возвращаем центр */
-    return vec2_create(map->size / 2, map->size / 2);
+    game->cached_map = prepared ? prepared : map_cache_acquire(game->map_size, map_seed);
+    return game->cached_map;
 }
 
 /* Создание новой арены */
-void game_create_arena(Game *game) {
-    /* Освобождаем старую арену */
-    if (game->arena) {
-        arena_destroy(game->arena);
-        free(game->arena);
-    }
+int game_create_arena(Game *game) {
+    /* Подготовленные зерно и карта забираются; без подготовки они получаются сейчас */
+    game_prepare_arena(game);
+    uint32_t map_seed = game->next_map_seed;
+    const Map *prepared = game->next_map;
+    game->next_map = NULL;
+    game->next_prepared = 0;
     
-    /* Создаём новую арену */
-    game->arena = (Arena *)malloc(sizeof(Arena));
-    *game->arena = arena_create(game->map_size);
+    /* Старая арена освобождается сбросом региона, новая создаётся в нём на месте */
+    map_cache_release(game->cached_map);
+    game->cached_map = NULL;
+    game->arena = NULL;
+    region_reset(&game->arena_region);
+    Arena *arena = (Arena *)region_alloc(&game->arena_region, sizeof(Arena));
+    if (!arena) {
+        map_cache_release(prepared);
+        return -1;
+    }
+    const Map *map = game_acquire_map(game, map_seed, prepared);
+    if (!map) {
+        return -1;
+    }
+    arena_init(arena, map);
+    arena_set_capacity(arena, game->max_players);
+    game->arena = arena;
     game->arena_number++;
     
-    /* Массив занятых позиций для спавна */
-    Vec2 occupied[MAX_PLAYERS];
-    int occupied_count = 0;
+    /* Ввод, поставленный под прошлую арену, к новой не относится */
+    for (int i = 0; i < game->player_count; i++) {
+        player_clear_inputs(&game->players[i]);
+    }
     
-    /* Добавляем сущности для всех игроков на случайных позициях */
+    /* Точки спавна заранее упорядочены по взаимной удалённости:
+     * первые N точек - честная расстановка для N игроков. Внутри неё точки
+     * сдвигаются по кругу с каждой ареной, чтобы место игрока не закрепляло
+     * за ним одну и ту же позицию */
+    int connected = 0;
+    for (int i = 0; i < game->player_count; i++) {
+        if (game->players[i].connected) connected++;
+    }
+    int fair_count = connected < map->spawn_count ? connected : map->spawn_count;
+    int spawn_index = 0;
     for (int i = 0; i < game->player_count; i++) {
         Player *player = &game->players[i];
         if (!player->connected) continue;
         
-        Vec2 spawn = get_random_floor_position(&game->arena->map, occupied, occupied_count);
-        occupied[occupied_count++] = spawn;
+        if (spawn_index >= map->spawn_count) {
+            player->entity_id = ENTITY_ID_NONE;
+            continue;
+        }
+        int slot = spawn_index < fair_count ? (spawn_index + game->arena_number) % fair_count : spawn_index;
+        spawn_index++;
+        Vec2 spawn = map->spawns[slot];
         
         int entity_id = arena_add_entity(game->arena, player->symbol, spawn, 100, 100);
         player->entity_id = entity_id;
     }
+    return 0;
 }
 
-/* Подсчёт живых игроков на арене */
-static int game_count_living_players(Game *game) {
-    int count = 0;
-    for (int i = 0; i < game->player_count; i++) {
-        if (game->players[i].entity_id >= 0) {
-            Entity *e = arena_get_entity(game->arena, game->players[i].entity_id);
-            if (e && e->alive) {
-                count++;
-            }
-        }
+/* Переход к новой арене. Если арену создать не удалось, комната не остаётся
+ * в игре без арены: под паузой владельца попытка повторится на следующем
+ * game_next_arena, без паузы матч заканчивается */
+static void game_begin_arena(Game *game) {
+    if (game_create_arena(game) == 0) {
+        game->state = GAME_STATE_PLAYING;
+        return;
     }
-    return count;
+    game->state = game->hold_between_arenas ? GAME_STATE_ARENA_OVER : GAME_STATE_FINISHED;
 }
 
-/* Шаг игры */
-void game_step(Game *game, float delta_time) {
-    if (game->state != GAME_STATE_PLAYING || !game->arena) {
+/* Постановка ввода игрока в очередь */
+int game_queue_input(Game *game, int player_index, const PlayerInput *input) {
+    if (player_index < 0 || player_index >= game->player_count) {
+        return -1;
+    }
+    return player_queue_input(&game->players[player_index], input);
+}
+
+/* Установка источника ввода */
+void game_set_input_source(Game *game, GameInputSource source, void *user) {
+    game->input_source = source;
+    game->input_user = user;
+}
+
+/* Тик арены, в начале которого будет применён ввод */
+uint32_t game_next_input_tick(Game *game) {
+    return game->arena ? game->arena->state.tick + 1 : 0;
+}
+
+/* Движение игрока: разовое во время перезарядки откладывается до её конца */
+static void game_apply_move(Game *game, Player *player, Direction dir, int buffered, int *applied) {
+    Arena *arena = game->arena;
+    Entity *entity = arena_get_entity(arena, player->entity_id);
+    if (!entity) return;
+    
+    if (*applied || !entity_can_move(entity, arena->state.tick)) {
+        if (buffered) player->next.move = dir;
         return;
     }
+    arena_move_entity(arena, player->entity_id, dir);
+    player->next.move = DIR_NONE;
+    *applied = 1;
+}
+
+/* Заклинание игрока: разовое во время перезарядки откладывается до её конца */
+static void game_apply_cast(Game *game, Player *player, const PlayerInput *input, int *applied) {
+    Arena *arena = game->arena;
+    Entity *entity = arena_get_entity(arena, player->entity_id);
+    if (!entity) return;
     
-    /* Подсчитываем живых до обновления */
-    int living_before = game_count_living_players(game);
+    if (*applied || arena->state.tick < entity->skill_ready_tick) {
+        if (!input->buffered) return;
+        player->next.cast = input->cast;
+        player->next.spell_type = input->spell_type;
+        player->next.rewind = input->rewind;
+        return;
+    }
     
-    /* Обновляем арену */
-    arena_update(game->arena, delta_time);
+    /* Выбранный тип заклинания запоминается у сущности, даже если на него не хватило энергии */
+    EntityCold *cold = arena_get_entity_cold(arena, player->entity_id);
+    cold->spell_type = input->spell_type;
+    if (arena_cast_spell_rewind(arena, player->entity_id, input->cast, input->spell_type, input->rewind) >= 0) {
+        player->spells_cast++;
+    }
+    player->next.cast = DIR_NONE;
+    *applied = 1;
+}
+
+/* Применение ввода, пришедшего к началу тика. Сначала опрашиваются источники ввода
+ * всех игроков, поэтому все решения принимаются по одному и тому же состоянию до тика.
+ * Ввод одного игрока применяется по порядку прихода, свежий важнее отложенного.
+ * Порядок игроков сдвигается каждый тик: при споре за клетку ни одно место
+ * не получает постоянного преимущества */
+static void game_apply_inputs(Game *game) {
+    uint32_t now = game_next_input_tick(game);
     
-    /* Обновляем entity_id для мёртвых игроков */
-    for (int i = 0; i < game->player_count; i++) {
-        if (game->players[i].entity_id >= 0) {
-            Entity *e = arena_get_entity(game->arena, game->players[i].entity_id);
-            if (e && !e->alive) {
-                game->players[i].entity_id = -1;
-            }
+    if (game->input_source) {
+        for (int i = 0; i < game->player_count; i++) {
+            game->input_source(game, i, game->input_user);
         }
     }
     
-    /* Подсчитываем живых после обновления */
-    int living_after = game_count_living_players(game);
-    int deleted = living_before - living_after;
-    
-    /* Выжившие получают очки за каждого убитого */
-    if (deleted > 0) {
-        for (int i = 0; i < game->player_count; i++) {
-            if (game->players[i].entity_id >= 0) {
-                Entity *e = arena_get_entity(game->arena, game->players[i].entity_id);
-                if (e && e->alive) {
-                    player_add_points(&game->players[i], deleted);
-                }
+    int first = game->player_count > 0 ? (int)(now % (uint32_t)game->player_count) : 0;
+    for (int k = 0; k < game->player_count; k++) {
+        int i = (first + k) % game->player_count;
+        Player *player = &game->players[i];
+        int moved = 0;
+        int cast = 0;
+        
+        while (player->input_count > 0) {
+            PlayerInput *input = &player->inputs[player->input_head];
+            if (input->tick > now) break;
+            player->input_head = (player->input_head + 1) % PLAYER_INPUT_QUEUE_SIZE;
+            player->input_count--;
+            if (player->entity_id < 0) continue;
+            
+            if (input->move != DIR_NONE) game_apply_move(game, player, input->move, input->buffered, &moved);
+            if (input->cast != DIR_NONE) game_apply_cast(game, player, input, &cast);
+        }
+        
+        /* Отложенное действие выполняется, как только закончилась перезарядка */
+        if (player->entity_id < 0) {
+            player->next = player_input_none(0);
+            continue;
+        }
+        if (!moved && player->next.move != DIR_NONE) {
+            Entity *entity = arena_get_entity(game->arena, player->entity_id);
+            if (entity && entity_can_move(entity, game->arena->state.tick)) {
+                game_apply_move(game, player, player->next.move, 0, &moved);
             }
         }
+        if (!cast && player->next.cast != DIR_NONE) {
+            Entity *entity = arena_get_entity(game->arena, player->entity_id);
+            if (entity && game->arena->state.tick >= entity->skill_ready_tick) {
+                PlayerInput next = player->next;
+                next.buffered = 0;
+                game_apply_cast(game, player, &next, &cast);
+            }
+        }
+    }
+}
+
+/* Шаг игры */
+void game_step(Game *game, float delta_time) {
+    if (game->state != GAME_STATE_PLAYING || !game->arena) {
+        return;
+    }
+    
+    /* Ввод игроков применяется до обновления арены в детерминированном порядке */
+    game_apply_inputs(game);
+    
+    /* Обновляем арену (заполняет журнал событий тика) */
+    Arena *arena = game->arena;
+    arena_update(arena, delta_time);
+    
+    /* Очки начисляются по событиям смерти: убийца получает очко. Смерти берутся
+     * из списка индексов, поэтому тик без смертей журнал не просматривает */
+    for (int d = 0; d < arena->death_count; d++) {
+        ArenaEvent *event = &arena->events[arena->death_events[d]];
+        game_handle_entity_death(game, event->entity_id, event->source_id);
     }
     
     /* Проверяем окончание арены (остался 1 или 0 живых) */
-    if (living_after <= 1 && game->player_count > 1) {
+    if (arena_count_alive(arena) <= 1 && game->player_count > 1) {
         /* Проверяем победителя игры */
         if (game_has_winner(game)) {
             game->state = GAME_STATE_FINISHED;
+        } else if (game->hold_between_arenas) {
+            /* Новую арену создаст владелец игры по окончании паузы */
+            game->state = GAME_STATE_ARENA_OVER;
         } else {
             /* Создаём новую арену */
-            game_create_arena(game);
+            game_begin_arena(game);
         }
     }
 }
 
-/* Проверка наличия победителя */
-int game_has_winner(Game *game) {
+/* Переход к следующей арене после паузы */
+void game_next_arena(Game *game) {
+    if (game->state != GAME_STATE_ARENA_OVER) return;
+    game_begin_arena(game);
+}
+
+/* Индекс победителя: единственный лидер, набравший очки для победы.
+ * Если лидеров несколько (добили друг друга в одном тике), матч продолжается,
+ * иначе победа доставалась бы игроку с меньшим индексом. -1 - победителя нет */
+static int game_winner_index(const Game *game) {
+    int best = -1;
+    int tied = 0;
     for (int i = 0; i < game->player_count; i++) {
-        if (game->players[i].points >= game->winner_points) {
-            return 1;
+        int points = game->players[i].points;
+        if (best < 0 || points > game->players[best].points) {
+            best = i;
+            tied = 0;
+        } else if (points == game->players[best].points) {
+            tied = 1;
         }
     }
-    return 0;
+    if (best < 0 || tied || game->players[best].points < game->winner_points) return -1;
+    return best;
+}
+
+/* Проверка наличия победителя */
+int game_has_winner(Game *game) {
+    return game_winner_index(game) >= 0;
 }
 
 /* Получение символа победителя */
 char game_get_winner(Game *game) {
-    for (int i = 0; i < game->player_count; i++) {
-        if (game->players[i].points >= game->winner_points) {
-            return game->players[i].symbol;
-        }
-    }
-    return '\0';
+    int index = game_winner_index(game);
+    return index >= 0 ? game->players[index].symbol : '\0';
 }
 
 /* Проверка, готова ли игра к началу */
@@ -240,24 +417,31 @@ void game_start(Game *game) {
         return;
     }
     
-    game->state = GAME_STATE_PLAYING;
-    game_create_arena(game);
+    /* Новая игра начинается с нуля очков (комната может перезапускать игры подряд) */
+    for (int i = 0; i < game->player_count; i++) {
+        game->players[i].points = 0;
+        game->players[i].spells_cast = 0;
+    }
+    
+    game_begin_arena(game);
 }
 
 /* Обработка смерти сущности */
 void game_handle_entity_death(Game *game, int entity_id, int killer_entity_id) {
-    /* Находим игрока-убийцу и начисляем очко */
-    for (int i = 0; i < game->player_count; i++) {
-        if (game->players[i].entity_id == killer_entity_id) {
-            player_add_points(&game->players[i], 1);
-            break;
+    /* Убийца ищется по символу своей сущности: он мог погибнуть в том же тике
+     * и уже быть отвязан от игрока */
+    EntityCold *killer = game->arena ? arena_get_entity_cold(game->arena, killer_entity_id) : NULL;
+    if (killer && killer_entity_id != entity_id) {
+        Player *player = game_get_player_by_symbol(game, killer->symbol);
+        if (player) {
+            player_add_points(player, 1);
         }
     }
     
     /* Помечаем игрока как мёртвого */
     for (int i = 0; i < game->player_count; i++) {
         if (game->players[i].entity_id == entity_id) {
-            game->players[i].entity_id = -1;
+            game->players[i].entity_id = ENTITY_ID_NONE;
             break;
         }
     }
@@ -265,11 +449,10 @@ void game_handle_entity_death(Game *game, int entity_id, int killer_entity_id) {
 
 /* Освобождение памяти игры */
 void game_destroy(Game *game) {
-    if (game->arena) {
-        arena_destroy(game->arena);
-        free(game->arena);
-        game->arena = NULL;
-    }
+    map_cache_release(game->cached_map);
+    map_cache_release(game->next_map);
+    game->arena = NULL;
+    region_destroy(&game->arena_region);
     free(game);
 }
 
@@ -6,32 +6,67 @@
 #ifndef GAME_H
 #define GAME_H
 
+#include <stdint.h>
 #include "arena.h"
 #include "player.h"
 #include "character.h"
+#include "maplib.h"
+#include "../common/rng.h"
+#include "../common/region.h"
+
+/* Зерно матча по умолчанию (до вызова game_set_seed) */
+#define GAME_DEFAULT_SEED 1
 
 /* Состояние игры */
 typedef enum {
     GAME_STATE_WAITING,     /* Ожидание игроков */
     GAME_STATE_PLAYING,     /* Игра идёт */
+    GAME_STATE_ARENA_OVER,  /* Арена окончена, следующая - по game_next_arena */
     GAME_STATE_FINISHED     /* Игра завершена */
 } GameState;
 
+typedef struct Game Game;
+
+/* Источник ввода игрока: опрашивается в начале тика для всех игроков до применения
+ * чьего-либо ввода и ставит ввод в очередь через game_queue_input. Все боты видят
+ * одно и то же состояние до тика */
+typedef void (*GameInputSource)(Game *game, int player_index, void *user);
+
 /* Игра */
-typedef struct {
-    int map_size;               /* Размер карты */
+struct Game {
+    int map_size;               /* Размер карты (для библиотеки - наибольший допустимый) */
     int winner_points;          /* Очки для победы */
     int arena_number;           /* Номер текущей арены */
     GameState state;            /* Состояние игры */
-    Arena *arena;               /* Текущая арена (NULL если нет) */
+    Arena *arena;               /* Текущая арена (NULL если нет), размещена в arena_region */
+    Region arena_region;        /* Память текущей арены, сбрасывается при смене арены */
+    const Map *cached_map;      /* Ссылка текущей арены на карту в кэше (NULL для карты из библиотеки) */
+    int next_prepared;          /* 1 - зерно (и карта) следующей арены получены заранее */
+    uint32_t next_map_seed;     /* Зерно карты следующей арены */
+    const Map *next_map;        /* Подготовленная карта следующей арены в кэше (NULL - нет) */
+    const MapLibrary *map_library; /* Библиотека карт (NULL - карты генерируются по зерну) */
+    int library_map;            /* Индекс карты библиотеки или -1 - выбор по зерну арены */
     Player players[MAX_PLAYERS]; /* Массив игроков */
     int player_count;           /* Количество игроков */
     int max_players;            /* Максимальное количество игроков */
-} Game;
-
-/* Создание игры */
+    uint64_t seed;              /* Зерно матча */
+    Rng rng;                    /* Генератор матча (карты арен) */
+    int hold_between_arenas;    /* 1 - после арены ждать game_next_arena (отсчёт сервера), 0 - сразу новая */
+    GameInputSource input_source; /* Источник ввода ботов (NULL - только очередь) */
+    void *input_user;           /* Данные источника ввода */
+};
+
+/* Создание игры (память под арены заданного размера выделяется сразу, NULL при ошибке) */
 Game* game_create(int map_size, int winner_points, int max_players);
 
+/* Установка зерна матча: одинаковое зерно даёт одинаковую последовательность арен */
+void game_set_seed(Game *game, uint64_t seed);
+
+/* Арены на картах из библиотеки: map_index - одна карта для всех арен, -1 - карта
+ * выбирается по зерну арены. Карта больше map_size игры не загружается (арена не
+ * создаётся). Библиотека должна быть открыта, пока жива игра */
+void game_set_map_library(Game *game, const MapLibrary *library, int map_index);
+
 /* Добавление игрока в игру, возвращает индекс игрока или -1 */
 int game_add_player(Game *game, char symbol);
 
@@ -44,10 +79,34 @@ Player* game_get_player_by_symbol(Game *game, char symbol);
 /* Получение индекса игрока по символу */
 int game_get_player_index(Game *game, char symbol);
 
-/* Создание новой арены */
-void game_create_arena(Game *game);
+/* Создание новой арены на подготовленной карте (без подготовки карта получается здесь же,
+ * состояние игры не меняется). Возвращает 0 или -1, если
+ * не удалось получить карту или память арены; game->arena тогда NULL */
+int game_create_arena(Game *game);
+
+/* Подготовка следующей арены заранее: зерно карты берётся из генератора матча,
+ * карта генерируется (или берётся из кэша). Генерация большой карты занимает заметное
+ * время, поэтому вызов допускается из другого потока, пока игра в GAME_STATE_ARENA_OVER
+ * и до game_next_arena: затрагиваются только генератор матча и поля next_*.
+ * Повторный вызов ничего не делает. Возвращает 0 или -1 (карту получить не удалось,
+ * game_create_arena попробует ещё раз) */
+int game_prepare_arena(Game *game);
+
+/* Переход к следующей арене после паузы (GAME_STATE_ARENA_OVER -> GAME_STATE_PLAYING).
+ * Если арену создать не удалось, игра остаётся в GAME_STATE_ARENA_OVER */
+void game_next_arena(Game *game);
+
+/* Постановка ввода игрока в очередь. Ввод с тиком 0 или уже прошедшим тиком применяется
+ * в начале ближайшего game_step. Возвращает 0 или -1 (нет игрока или очередь заполнена) */
+int game_queue_input(Game *game, int player_index, const PlayerInput *input);
+
+/* Установка источника ввода, опрашиваемого в начале каждого тика */
+void game_set_input_source(Game *game, GameInputSource source, void *user);
+
+/* Тик арены, в начале которого будет применён ввод, поставленный сейчас */
+uint32_t game_next_input_tick(Game *game);
 
-/* Шаг игры (обновление арены, подсчёт очков) */
+/* Шаг игры (ввод игроков в порядке индексов, обновление арены, подсчёт очков) */
 void game_step(Game *game, float delta_time);
 
 /* Проверка наличия победителя */
@@ -59,10 +118,11 @@ char game_get_winner(Game *game);
 /* Проверка, готова ли игра к началу */
 int game_is_ready(Game *game);
 
-/* Начало игры */
+/* Начало игры. Если первую арену создать не удалось, игра переходит
+ * в GAME_STATE_ARENA_OVER (при hold_between_arenas) или GAME_STATE_FINISHED без победителя */
 void game_start(Game *game);
 
-/* Обработка смерти сущности */
+/* Обработка смерти сущности: очко убийце, погибший игрок отвязывается от сущности */
 void game_handle_entity_death(Game *game, int entity_id, int killer_entity_id);
 
 /* Освобождение памяти игры */
@@ -4,70 +4,460 @@
 
 #include "map.h"
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 
-/* Создание карты заданного размера (стены по периметру, пол внутри) */
-Map map_create(int size) {
-    Map map;
-    map.size = size;
-    map.ground = (Terrain *)malloc(size * size * sizeof(Terrain));
+/* Выходы чанка chunk_index в направлении dir [MAP_CHUNK_SIZE] */
+static uint16_t *chunk_edges(const Map *map, int chunk_index, Direction dir) {
+    return &map->edges[((size_t)chunk_index * 4 + (size_t)dir) * MAP_CHUNK_SIZE];
+}
+
+/* Террейн клетки внутри карты (координаты не проверяются) */
+static Terrain terrain_at(const Map *map, int x, int y) {
+    const MapChunk *chunk = &map->chunks[(y >> MAP_CHUNK_SHIFT) * map->chunks_per_side + (x >> MAP_CHUNK_SHIFT)];
+    if (chunk->cells == MAP_CHUNK_UNIFORM) return (Terrain)chunk->fill;
+    return (Terrain)map->cells[chunk->cells + (y & (MAP_CHUNK_SIZE - 1)) * MAP_CHUNK_SIZE + (x & (MAP_CHUNK_SIZE - 1))];
+}
+
+/* Выходы вверх/вниз чанков столбца x. run - буфер [size] */
+static void map_build_edges_column(Map *map, int x, uint16_t *run) {
+    int size = map->size;
+    int lane = x & (MAP_CHUNK_SIZE - 1);
+    int column = x >> MAP_CHUNK_SHIFT;
+    
+    /* run[y] - клеток пола подряд вниз, начиная с y */
+    for (int y = size - 1; y >= 0; y--) {
+        run[y] = (terrain_at(map, x, y) == TERRAIN_FLOOR) ? (uint16_t)((y < size - 1 ? run[y + 1] : 0) + 1) : 0;
+    }
+    for (int cy = 0; cy < map->chunks_per_side; cy++) {
+        int next = (cy + 1) * MAP_CHUNK_SIZE;
+        chunk_edges(map, cy * map->chunks_per_side + column, DIR_DOWN)[lane] = (next < size) ? run[next] : 0;
+    }
+    
+    /* run[y] - клеток пола подряд вверх, начиная с y */
+    for (int y = 0; y < size; y++) {
+        run[y] = (terrain_at(map, x, y) == TERRAIN_FLOOR) ? (uint16_t)((y > 0 ? run[y - 1] : 0) + 1) : 0;
+    }
+    for (int cy = 0; cy < map->chunks_per_side; cy++) {
+        int prev = cy * MAP_CHUNK_SIZE - 1;
+        chunk_edges(map, cy * map->chunks_per_side + column, DIR_UP)[lane] = (prev >= 0) ? run[prev] : 0;
+    }
+}
+
+/* Выходы влево/вправо чанков строки y. run - буфер [size] */
+static void map_build_edges_row(Map *map, int y, uint16_t *run) {
+    int size = map->size;
+    int lane = y & (MAP_CHUNK_SIZE - 1);
+    int row = (y >> MAP_CHUNK_SHIFT) * map->chunks_per_side;
+    
+    /* run[x] - клеток пола подряд вправо, начиная с x */
+    for (int x = size - 1; x >= 0; x--) {
+        run[x] = (terrain_at(map, x, y) == TERRAIN_FLOOR) ? (uint16_t)((x < size - 1 ? run[x + 1] : 0) + 1) : 0;
+    }
+    for (int cx = 0; cx < map->chunks_per_side; cx++) {
+        int next = (cx + 1) * MAP_CHUNK_SIZE;
+        chunk_edges(map, row + cx, DIR_RIGHT)[lane] = (next < size) ? run[next] : 0;
+    }
+    
+    /* run[x] - клеток пола подряд влево, начиная с x */
+    for (int x = 0; x < size; x++) {
+        run[x] = (terrain_at(map, x, y) == TERRAIN_FLOOR) ? (uint16_t)((x > 0 ? run[x - 1] : 0) + 1) : 0;
+    }
+    for (int cx = 0; cx < map->chunks_per_side; cx++) {
+        int prev = cx * MAP_CHUNK_SIZE - 1;
+        chunk_edges(map, row + cx, DIR_LEFT)[lane] = (prev >= 0) ? run[prev] : 0;
+    }
+}
+
+/* Объём региона под карту */
+size_t map_region_size(int size) {
+    size_t cells = (size_t)size * (size_t)size;
+    size_t chunks = (size_t)((size + MAP_CHUNK_SIZE - 1) / MAP_CHUNK_SIZE);
+    chunks *= chunks;
+    
+    /* Пул клеток вмещает все чанки: после генерации карта неизменна */
+    size_t total = chunks * sizeof(MapChunk) + REGION_ALIGN;
+    total += chunks * 4 * MAP_CHUNK_SIZE * sizeof(uint16_t) + REGION_ALIGN;
+    total += chunks * MAP_CHUNK_CELLS + REGION_ALIGN;
+    
+    /* Временные буферы: два массива int на клетку (генератор), откатываются после использования */
+    total += 2 * (cells * sizeof(int) + REGION_ALIGN);
+    return total;
+}
+
+/* Создание карты заданного размера на месте (стены по периметру, пол внутри) */
+int map_init(Map *map, int size, Region *region) {
+    map->region = region;
+    map->size = size;
+    map->chunks_per_side = (size + MAP_CHUNK_SIZE - 1) / MAP_CHUNK_SIZE;
+    int chunk_count = map->chunks_per_side * map->chunks_per_side;
+    map->chunks = (MapChunk *)region_calloc(region, (size_t)chunk_count, sizeof(MapChunk));
+    map->cells = (uint8_t *)region_alloc(region, (size_t)chunk_count * MAP_CHUNK_CELLS);
+    map->cells_used = 0;
+    map->edges = NULL;
+    map->spawn_count = 0;
+    if (!map->chunks || !map->cells) {
+        return -1;
+    }
     
-    /* Заполняем карту: стены по периметру, пол внутри */
+    /* Все чанки изначально однородный пол, клетки из пула получает только периметр */
+    for (int i = 0; i < chunk_count; i++) {
+        map->chunks[i].cells = MAP_CHUNK_UNIFORM;
+    }
+    for (int i = 0; i < size; i++) {
+        if (map_write_terrain(map, vec2_create(i, 0), TERRAIN_WALL) < 0 ||
+            map_write_terrain(map, vec2_create(i, size - 1), TERRAIN_WALL) < 0 ||
+            map_write_terrain(map, vec2_create(0, i), TERRAIN_WALL) < 0 ||
+            map_write_terrain(map, vec2_create(size - 1, i), TERRAIN_WALL) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Построение списка точек спавна: жадный выбор самой удалённой клетки пола
+ * от уже выбранных (farthest-point), чтобы первые N точек были честными для N игроков */
+static void map_build_spawns(Map *map, Vec2 first_spawn) {
+    int cells = map->size * map->size;
+    map->spawn_count = 0;
+    
+    /* Минимальная дистанция каждой клетки пола до выбранных точек (-1 для стен).
+     * Временный буфер в конце региона */
+    size_t mark = region_mark(map->region);
+    int *min_dist = (int *)region_alloc(map->region, (size_t)cells * sizeof(int));
+    if (!min_dist) return;
+    
+    int size = map->size;
+    int floor_count = 0;
+    int first = -1;
     for (int y = 0; y < size; y++) {
         for (int x = 0; x < size; x++) {
-            int index = y * size + x;
-            if (x == 0 || x == size - 1 || y == 0 || y == size - 1) {
-                map.ground[index] = TERRAIN_WALL;
+            int i = y * size + x;
+            if (terrain_at(map, x, y) == TERRAIN_FLOOR) {
+                min_dist[i] = INT_MAX;
+                floor_count++;
+                if (first < 0) first = i;
             } else {
-                map.ground[index] = TERRAIN_FLOOR;
+                min_dist[i] = -1;
+            }
+        }
+    }
+    
+    /* Начинаем с клетки, самой удалённой от first_spawn */
+    if (map_is_walkable(map, first_spawn)) {
+        first = map_pos_to_index(map, first_spawn);
+    }
+    if (first >= 0) {
+        Vec2 origin = map_index_to_pos(map, first);
+        int best = first;
+        int best_dist = -1;
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                int i = y * size + x;
+                if (min_dist[i] < 0) continue;
+                int d = (x - origin.x) * (x - origin.x) + (y - origin.y) * (y - origin.y);
+                if (d > best_dist) {
+                    best_dist = d;
+                    best = i;
+                }
+            }
+        }
+        first = best;
+    }
+    
+    int next = first;
+    while (next >= 0 && map->spawn_count < MAP_MAX_SPAWNS && map->spawn_count < floor_count) {
+        Vec2 chosen = map_index_to_pos(map, next);
+        map->spawns[map->spawn_count++] = chosen;
+        
+        /* Обновляем дистанции и ищем следующую самую удалённую клетку */
+        next = -1;
+        int best_dist = 0;
+        for (int y = 0; y < size; y++) {
+            int dy2 = (y - chosen.y) * (y - chosen.y);
+            for (int x = 0; x < size; x++) {
+                int i = y * size + x;
+                if (min_dist[i] < 0) continue;
+                int d = (x - chosen.x) * (x - chosen.x) + dy2;
+                if (d < min_dist[i]) min_dist[i] = d;
+                if (min_dist[i] > best_dist) {
+                    best_dist = min_dist[i];
+                    next = i;
+                }
             }
         }
     }
     
-    return map;
+    region_rewind(map->region, mark);
 }
 
-/* Получение террейна в позиции */
-Terrain map_get_terrain(Map *map, Vec2 pos) {
-    if (!map_is_valid_pos(map, pos)) {
-        return TERRAIN_WALL;  /* За пределами карты - стена */
+/* Сворачивание чанков, оставшихся однородными (их клетки остаются в пуле до сброса региона) */
+static void map_compact_chunks(Map *map) {
+    for (int cy = 0; cy < map->chunks_per_side; cy++) {
+        for (int cx = 0; cx < map->chunks_per_side; cx++) {
+            MapChunk *chunk = &map->chunks[cy * map->chunks_per_side + cx];
+            if (chunk->cells == MAP_CHUNK_UNIFORM) continue;
+            const uint8_t *cells = map->cells + chunk->cells;
+            
+            /* Клетки за краем карты в крайних чанках не учитываются */
+            int width = map->size - cx * MAP_CHUNK_SIZE;
+            int height = map->size - cy * MAP_CHUNK_SIZE;
+            if (width > MAP_CHUNK_SIZE) width = MAP_CHUNK_SIZE;
+            if (height > MAP_CHUNK_SIZE) height = MAP_CHUNK_SIZE;
+            
+            uint8_t fill = cells[0];
+            int uniform = 1;
+            for (int y = 0; y < height && uniform; y++) {
+                for (int x = 0; x < width; x++) {
+                    if (cells[y * MAP_CHUNK_SIZE + x] != fill) {
+                        uniform = 0;
+                        break;
+                    }
+                }
+            }
+            
+            if (uniform) {
+                chunk->cells = MAP_CHUNK_UNIFORM;
+                chunk->fill = fill;
+            }
+        }
+    }
+}
+
+/* Построение производных таблиц */
+int map_build_tables(Map *map, Vec2 first_spawn) {
+    if (!map->edges) {
+        map->edges = (uint16_t *)region_calloc(map->region, (size_t)map_chunk_count(map) * 4 * MAP_CHUNK_SIZE, sizeof(uint16_t));
+        if (!map->edges) return -1;
+    }
+    
+    map_compact_chunks(map);
+    uint16_t run[MAP_MAX_SIZE];
+    for (int i = 0; i < map->size; i++) {
+        map_build_edges_row(map, i, run);
+        map_build_edges_column(map, i, run);
+    }
+    map_build_spawns(map, first_spawn);
+    return 0;
+}
+
+/* Запись террейна без пересчёта таблиц */
+int map_write_terrain(Map *map, Vec2 pos, Terrain terrain) {
+    if (!map->region || !map_is_valid_pos(map, pos)) return -1;
+    
+    MapChunk *chunk = &map->chunks[map_chunk_index_at(map, pos)];
+    if (chunk->cells == MAP_CHUNK_UNIFORM) {
+        if (chunk->fill == (uint8_t)terrain) return 0;
+        
+        /* Первая отличающаяся клетка: разворачиваем однородный чанк.
+         * Пул рассчитан на все чанки, переполнение - признак испорченной карты */
+        if ((size_t)map->cells_used + MAP_CHUNK_CELLS > (size_t)map_chunk_count(map) * MAP_CHUNK_CELLS) {
+            return -1;
+        }
+        chunk->cells = map->cells_used;
+        map->cells_used += MAP_CHUNK_CELLS;
+        memset(map->cells + chunk->cells, chunk->fill, MAP_CHUNK_CELLS);
+    }
+    map->cells[chunk->cells + (pos.y & (MAP_CHUNK_SIZE - 1)) * MAP_CHUNK_SIZE + (pos.x & (MAP_CHUNK_SIZE - 1))] = (uint8_t)terrain;
+    return 0;
+}
+
+/* Хэш террейна: FNV-1a по размеру и клеткам построчно */
+uint64_t map_terrain_hash(const Map *map) {
+    uint64_t hash = 14695981039346656037ULL;
+    hash = (hash ^ (uint64_t)map->size) * 1099511628211ULL;
+    for (int y = 0; y < map->size; y++) {
+        for (int x = 0; x < map->size; x++) {
+            hash = (hash ^ (uint64_t)terrain_at(map, x, y)) * 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+/* Проверка совпадения террейна двух карт */
+int map_terrain_equals(const Map *a, const Map *b) {
+    if (a->size != b->size) return 0;
+    for (int y = 0; y < a->size; y++) {
+        for (int x = 0; x < a->size; x++) {
+            if (terrain_at(a, x, y) != terrain_at(b, x, y)) return 0;
+        }
+    }
+    return 1;
+}
+
+/* Размер блока под упакованную копию карты: чанки, выходы чанков, клетки неоднородных чанков */
+size_t map_packed_size(const Map *map) {
+    int chunk_count = map_chunk_count(map);
+    size_t dense = 0;
+    for (int i = 0; i < chunk_count; i++) {
+        if (map->chunks[i].cells != MAP_CHUNK_UNIFORM) dense++;
+    }
+    return (size_t)chunk_count * sizeof(MapChunk)
+           + (size_t)chunk_count * 4 * MAP_CHUNK_SIZE * sizeof(uint16_t)
+           + dense * MAP_CHUNK_CELLS;
+}
+
+/* Упаковка карты с таблицами в один блок */
+void map_pack(const Map *src, Map *dst, void *block) {
+    int chunk_count = map_chunk_count(src);
+    size_t edge_count = (size_t)chunk_count * 4 * MAP_CHUNK_SIZE;
+    
+    *dst = *src;
+    dst->region = NULL;
+    dst->chunks = (MapChunk *)block;
+    dst->edges = (uint16_t *)(dst->chunks + chunk_count);
+    memcpy(dst->edges, src->edges, edge_count * sizeof(uint16_t));
+    
+    dst->cells = (uint8_t *)(dst->edges + edge_count);
+    dst->cells_used = 0;
+    for (int i = 0; i < chunk_count; i++) {
+        dst->chunks[i] = src->chunks[i];
+        if (src->chunks[i].cells == MAP_CHUNK_UNIFORM) continue;
+        memcpy(dst->cells + dst->cells_used, src->cells + src->chunks[i].cells, MAP_CHUNK_CELLS);
+        dst->chunks[i].cells = dst->cells_used;
+        dst->cells_used += MAP_CHUNK_CELLS;
+    }
+}
+
+/* Карта поверх готового упакованного блока */
+void map_init_packed(Map *map, int size, const void *block) {
+    map->region = NULL;
+    map->size = size;
+    map->chunks_per_side = (size + MAP_CHUNK_SIZE - 1) / MAP_CHUNK_SIZE;
+    
+    /* Блок только читается: карта неизменна */
+    size_t edge_count = (size_t)map_chunk_count(map) * 4 * MAP_CHUNK_SIZE;
+    map->chunks = (MapChunk *)block;
+    map->edges = (uint16_t *)(map->chunks + map_chunk_count(map));
+    map->cells = (uint8_t *)(map->edges + edge_count);
+    map->cells_used = 0;
+    map->spawn_count = 0;
+}
+
+/* Проверка упакованной карты: выходы пересчитываются во временный буфер и сравниваются */
+int map_packed_valid(const Map *map) {
+    int chunk_count = map_chunk_count(map);
+    for (int i = 0; i < chunk_count; i++) {
+        const MapChunk *chunk = &map->chunks[i];
+        if (chunk->cells == MAP_CHUNK_UNIFORM) {
+            if (chunk->fill > TERRAIN_WALL) return 0;
+            continue;
+        }
+        for (int c = 0; c < MAP_CHUNK_CELLS; c++) {
+            if (map->cells[chunk->cells + c] > TERRAIN_WALL) return 0;
+        }
+    }
+    
+    size_t edge_count = (size_t)chunk_count * 4 * MAP_CHUNK_SIZE;
+    Map check = *map;
+    check.edges = (uint16_t *)malloc(edge_count * sizeof(uint16_t));
+    if (!check.edges) return 0;
+    
+    uint16_t run[MAP_MAX_SIZE];
+    for (int i = 0; i < map->size; i++) {
+        map_build_edges_row(&check, i, run);
+        map_build_edges_column(&check, i, run);
     }
-    return map->ground[pos.y * map->size + pos.x];
+    /* Сравниваются только полосы внутри карты: полосы за краем последнего чанка не читаются */
+    int valid = 1;
+    for (int i = 0; valid && i < chunk_count; i++) {
+        int cx = i % map->chunks_per_side;
+        int cy = i / map->chunks_per_side;
+        for (int d = DIR_UP; valid && d <= DIR_RIGHT; d++) {
+            int base = ((d == DIR_LEFT || d == DIR_RIGHT) ? cy : cx) * MAP_CHUNK_SIZE;
+            const uint16_t *expected = chunk_edges(&check, i, (Direction)d);
+            const uint16_t *stored = chunk_edges(map, i, (Direction)d);
+            for (int lane = 0; lane < MAP_CHUNK_SIZE && base + lane < map->size; lane++) {
+                if (stored[lane] != expected[lane]) {
+                    valid = 0;
+                    break;
+                }
+            }
+        }
+    }
+    free(check.edges);
+    return valid;
+}
+
+/* Количество чанков карты */
+int map_chunk_count(const Map *map) {
+    return map->chunks_per_side * map->chunks_per_side;
+}
+
+/* Получение чанка по индексу */
+const MapChunk* map_get_chunk(const Map *map, int chunk_index) {
+    if (chunk_index < 0 || chunk_index >= map_chunk_count(map)) return NULL;
+    return &map->chunks[chunk_index];
+}
+
+/* Клетки неоднородного чанка */
+const uint8_t* map_chunk_cells(const Map *map, const MapChunk *chunk) {
+    return chunk->cells == MAP_CHUNK_UNIFORM ? NULL : map->cells + chunk->cells;
 }
 
-/* Установка террейна в позиции */
-void map_set_terrain(Map *map, Vec2 pos, Terrain terrain) {
-    if (map_is_valid_pos(map, pos)) {
-        map->ground[pos.y * map->size + pos.x] = terrain;
+/* Индекс чанка, содержащего позицию */
+int map_chunk_index_at(const Map *map, Vec2 pos) {
+    return (pos.y >> MAP_CHUNK_SHIFT) * map->chunks_per_side + (pos.x >> MAP_CHUNK_SHIFT);
+}
+
+/* Получение террейна в позиции */
+Terrain map_get_terrain(const Map *map, Vec2 pos) {
+    if (!map_is_valid_pos(map, pos)) {
+        return TERRAIN_WALL;  /* За пределами карты - стена */
     }
+    return terrain_at(map, pos.x, pos.y);
 }
 
 /* Конвертация индекса массива в позицию */
-Vec2 map_index_to_pos(Map *map, int index) {
+Vec2 map_index_to_pos(const Map *map, int index) {
     return vec2_create(index % map->size, index / map->size);
 }
 
 /* Конвертация позиции в индекс массива */
-int map_pos_to_index(Map *map, Vec2 pos) {
+int map_pos_to_index(const Map *map, Vec2 pos) {
     return pos.y * map->size + pos.x;
 }
 
 /* Проверка, находится ли позиция в пределах карты */
-int map_is_valid_pos(Map *map, Vec2 pos) {
+int map_is_valid_pos(const Map *map, Vec2 pos) {
     return pos.x >= 0 && pos.x < map->size && 
            pos.y >= 0 && pos.y < map->size;
 }
 
 /* Проверка, можно ли пройти в позицию */
-int map_is_walkable(Map *map, Vec2 pos) {
+int map_is_walkable(const Map *map, Vec2 pos) {
     return map_get_terrain(map, pos) == TERRAIN_FLOOR;
 }
 
-/* Освобождение памяти карты */
-void map_destroy(Map *map) {
-    if (map->ground) {
-        free(map->ground);
-        map->ground = NULL;
+/* Количество проходимых клеток подряд от позиции в направлении:
+ * клетки до края чанка (не дальше края карты) плюс выход чанка */
+int map_distance_to_wall(const Map *map, Vec2 pos, Direction dir) {
+    if (!map_is_valid_pos(map, pos) || dir < DIR_UP || dir > DIR_RIGHT) {
+        return 0;
+    }
+    
+    int horizontal = (dir == DIR_LEFT || dir == DIR_RIGHT);
+    int step = (dir == DIR_DOWN || dir == DIR_RIGHT) ? 1 : -1;
+    int along = horizontal ? pos.x : pos.y;
+    int last = (along & ~(MAP_CHUNK_SIZE - 1)) + (step > 0 ? MAP_CHUNK_SIZE - 1 : 0);
+    if (last > map->size - 1) last = map->size - 1;
+    int steps = (last - along) * step;
+    
+    int chunk_index = map_chunk_index_at(map, pos);
+    const MapChunk *chunk = &map->chunks[chunk_index];
+    int count = 0;
+    if (chunk->cells == MAP_CHUNK_UNIFORM) {
+        if (chunk->fill != TERRAIN_FLOOR && steps > 0) return 0;
+        if (chunk->fill == TERRAIN_FLOOR) count = steps;
+    } else {
+        const uint8_t *cells = map->cells + chunk->cells;
+        int offset = (pos.y & (MAP_CHUNK_SIZE - 1)) * MAP_CHUNK_SIZE + (pos.x & (MAP_CHUNK_SIZE - 1));
+        int stride = horizontal ? step : step * MAP_CHUNK_SIZE;
+        for (; count < steps; count++) {
+            offset += stride;
+            if (cells[offset] != TERRAIN_FLOOR) return count;
+        }
     }
-    map->size = 0;
+    int lane = (horizontal ? pos.y : pos.x) & (MAP_CHUNK_SIZE - 1);
+    return count + chunk_edges(map, chunk_index, dir)[lane];
 }
-
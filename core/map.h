@@ -6,7 +6,11 @@
 #ifndef MAP_H
 #define MAP_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include "../common/region.h"
 #include "vec2.h"
+#include "direction.h"
 
 /* Тип террейна */
 typedef enum {
@@ -14,35 +18,117 @@ typedef enum {
     TERRAIN_WALL = 1    /* Стена - нельзя ходить */
 } Terrain;
 
-/* Карта арены */
+/* Максимальное количество кандидатов на точку спавна */
+#define MAP_MAX_SPAWNS 16
+
+/* Максимальный размер карты */
+#define MAP_MAX_SIZE 1024
+
+/* Террейн хранится квадратными чанками MAP_CHUNK_SIZE x MAP_CHUNK_SIZE */
+#define MAP_CHUNK_SHIFT 4
+#define MAP_CHUNK_SIZE (1 << MAP_CHUNK_SHIFT)
+#define MAP_CHUNK_CELLS (MAP_CHUNK_SIZE * MAP_CHUNK_SIZE)
+#define MAP_MAX_CHUNKS ((MAP_MAX_SIZE / MAP_CHUNK_SIZE) * (MAP_MAX_SIZE / MAP_CHUNK_SIZE))
+
+/* Значение MapChunk.cells у однородного чанка */
+#define MAP_CHUNK_UNIFORM UINT32_MAX
+
+/* Чанк террейна: однородный чанк (весь пол или вся стена) не занимает памяти.
+ * Клетки адресуются смещением в пуле карты, а не указателем, поэтому упакованная
+ * карта одинакова в памяти и в файле набора карт */
+typedef struct {
+    uint32_t cells;     /* Смещение клеток чанка [MAP_CHUNK_CELLS] в пуле или MAP_CHUNK_UNIFORM */
+    uint8_t fill;       /* Террейн однородного чанка */
+    uint8_t reserved[3];
+} MapChunk;
+
+/* Карта арены. При генерации память берётся из региона; готовая карта неизменна
+ * и упаковывается в один блок (map_pack), который делят все арены с таким же террейном.
+ * Упакованный блок: чанки, выходы чанков, клетки неоднородных чанков подряд.
+ * Дистанции до стен не хранятся поклеточно: у каждого чанка по каждому направлению
+ * и каждой строке (столбцу) записана длина серии пола сразу за его краем, а внутри
+ * чанка дистанция досчитывается не более чем за MAP_CHUNK_SIZE - 1 клеток */
 typedef struct {
+    Region *region;     /* Регион генерации (временные буферы), NULL у упакованной карты */
     int size;           /* Размер карты (size x size) */
-    Terrain *ground;    /* Массив террейна [size * size] */
+    int chunks_per_side; /* Количество чанков по стороне карты */
+    MapChunk *chunks;   /* Чанки террейна [chunks_per_side * chunks_per_side] */
+    uint8_t *cells;     /* Пул клеток неоднородных чанков */
+    uint32_t cells_used; /* Занято в пуле */
+    uint16_t *edges;    /* Выходы чанков [chunk_count * 4 * MAP_CHUNK_SIZE]: клеток пола подряд
+                         * за краем чанка по направлению и полосе (строке или столбцу) */
+    Vec2 spawns[MAP_MAX_SPAWNS]; /* Точки спавна, каждая следующая максимально удалена от предыдущих */
+    int spawn_count;    /* Количество точек спавна */
 } Map;
 
-/* Создание карты заданного размера (стены по периметру, пол внутри) */
-Map map_create(int size);
+/* Объём региона, которого заведомо хватает на генерацию карты заданного размера,
+ * включая таблицы и временные буферы */
+size_t map_region_size(int size);
 
-/* Получение террейна в позиции */
-Terrain map_get_terrain(Map *map, Vec2 pos);
+/* Создание террейна заданного размера на месте (стены по периметру, пол внутри).
+ * Таблицы не строятся. Возвращает 0 или -1, если в регионе не хватило памяти */
+int map_init(Map *map, int size, Region *region);
+
+/* Построение производных таблиц (выходы чанков, точки спавна) по готовому
+ * террейну. Однородные чанки при этом сворачиваются.
+ * first_spawn - клетка, от которой строится список спавна. Возвращает 0 или -1 */
+int map_build_tables(Map *map, Vec2 first_spawn);
+
+/* Запись террейна (только при генерации, до построения таблиц).
+ * Возвращает 0 или -1 (клетка вне карты, упакованная карта, пул клеток исчерпан) */
+int map_write_terrain(Map *map, Vec2 pos, Terrain terrain);
+
+/* Хэш террейна (не зависит от того, как чанки хранятся в памяти) */
+uint64_t map_terrain_hash(const Map *map);
 
-/* Установка террейна в позиции */
-void map_set_terrain(Map *map, Vec2 pos, Terrain terrain);
+/* Проверка совпадения террейна двух карт */
+int map_terrain_equals(const Map *a, const Map *b);
+
+/* Размер блока под упакованную копию карты с таблицами */
+size_t map_packed_size(const Map *map);
+
+/* Упаковка карты с таблицами в один блок размером map_packed_size:
+ * копия не ссылается на регион и может жить дольше него */
+void map_pack(const Map *src, Map *dst, void *block);
+
+/* Карта поверх готового упакованного блока (без копирования и разбора).
+ * Точки спавна блок не содержит, их заполняет вызывающий */
+void map_init_packed(Map *map, int size, const void *block);
+
+/* Проверка упакованной карты из недоверенного источника (границы чанков уже проверены):
+ * клетки - известный террейн, выходы чанков совпадают с пересчитанными по террейну.
+ * Возвращает 1 - карта годна, 0 - повреждена или не хватило памяти на проверку */
+int map_packed_valid(const Map *map);
+
+/* Количество чанков карты */
+int map_chunk_count(const Map *map);
+
+/* Получение чанка по индексу (chunk_y * chunks_per_side + chunk_x) */
+const MapChunk* map_get_chunk(const Map *map, int chunk_index);
+
+/* Клетки неоднородного чанка [MAP_CHUNK_CELLS] или NULL для однородного */
+const uint8_t* map_chunk_cells(const Map *map, const MapChunk *chunk);
+
+/* Индекс чанка, содержащего позицию */
+int map_chunk_index_at(const Map *map, Vec2 pos);
+
+/* Получение террейна в позиции */
+Terrain map_get_terrain(const Map *map, Vec2 pos);
 
 /* Конвертация индекса массива в позицию */
-Vec2 map_index_to_pos(Map *map, int index);
+Vec2 map_index_to_pos(const Map *map, int index);
 
 /* Конвертация позиции в индекс массива */
-int map_pos_to_index(Map *map, Vec2 pos);
+int map_pos_to_index(const Map *map, Vec2 pos);
 
 /* Проверка, находится ли позиция в пределах карты */
-int map_is_valid_pos(Map *map, Vec2 pos);
+int map_is_valid_pos(const Map *map, Vec2 pos);
 
 /* Проверка, можно ли пройти в позицию */
-int map_is_walkable(Map *map, Vec2 pos);
+int map_is_walkable(const Map *map, Vec2 pos);
 
-/* Освобождение памяти карты */
-void map_destroy(Map *map);
+/* Количество проходимых клеток подряд от позиции в направлении (до первой стены) */
+int map_distance_to_wall(const Map *map, Vec2 pos, Direction dir);
 
 #endif /* MAP_H */
 
@@ -0,0 +1,185 @@
+/*
+ * mapcache.c - Реализация кэша карт
+ */
+
+#include "mapcache.h"
+#include "mapgen.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+/* Количество корзин хэш-таблицы (степень двойки) */
+#define MAP_CACHE_BUCKETS 256
+
+/* Сколько памяти держат карты без ссылок (вытесняются самые давние) */
+#define MAP_CACHE_IDLE_BYTES ((size_t)64 << 20)
+
+/* Карта в кэше: заголовок и упакованная карта одним блоком.
+ * map - первое поле, поэтому указатель на карту приводится к записи */
+typedef struct MapCacheEntry {
+    Map map;                        /* Упакованная карта */
+    uint64_t hash;                  /* Хэш параметров генерации */
+    int size;                       /* Параметры генерации: размер, раскладка и её зерно */
+    MapLayout layout;
+    uint32_t layout_seed;
+    int refs;                       /* Количество ссылок */
+    size_t bytes;                   /* Размер блока записи */
+    struct MapCacheEntry *next;     /* Следующая запись в корзине */
+    struct MapCacheEntry *idle_prev; /* Соседи в списке карт без ссылок (от старых к новым) */
+    struct MapCacheEntry *idle_next;
+} MapCacheEntry;
+
+/* Смещение упакованной карты от начала записи */
+#define MAP_CACHE_HEADER_SIZE ((sizeof(MapCacheEntry) + REGION_ALIGN - 1) & ~(size_t)(REGION_ALIGN - 1))
+
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static MapCacheEntry *cache_buckets[MAP_CACHE_BUCKETS];
+static MapCacheEntry *idle_head;
+static MapCacheEntry *idle_tail;
+static size_t idle_bytes;
+static MapCacheStats cache_stats;
+
+/* Исключение карты из списка карт без ссылок */
+static void idle_unlink(MapCacheEntry *entry) {
+    if (entry->idle_prev) entry->idle_prev->idle_next = entry->idle_next;
+    else idle_head = entry->idle_next;
+    if (entry->idle_next) entry->idle_next->idle_prev = entry->idle_prev;
+    else idle_tail = entry->idle_prev;
+    entry->idle_prev = NULL;
+    entry->idle_next = NULL;
+    idle_bytes -= entry->bytes;
+}
+
+/* Удаление записи из хэш-таблицы (под блокировкой) */
+static void map_cache_remove(MapCacheEntry *entry) {
+    MapCacheEntry **link = &cache_buckets[entry->hash & (MAP_CACHE_BUCKETS - 1)];
+    while (*link != entry) link = &(*link)->next;
+    *link = entry->next;
+    cache_stats.maps--;
+    cache_stats.bytes -= entry->bytes;
+}
+
+/* Ключ карты: параметры генерации (карта по ним однозначна, генерировать её для поиска не нужно) */
+static uint64_t map_cache_key(int size, MapLayout layout, uint32_t layout_seed) {
+    uint64_t hash = ((uint64_t)(uint32_t)size << 40) ^ ((uint64_t)layout << 32) ^ layout_seed;
+    return hash * 0x9E3779B97F4A7C15ULL;
+}
+
+/* Поиск карты в кэше (под блокировкой); найденная получает ссылку */
+static const Map* map_cache_find(int size, MapLayout layout, uint32_t layout_seed, uint64_t hash) {
+    MapCacheEntry *entry = cache_buckets[hash & (MAP_CACHE_BUCKETS - 1)];
+    for (; entry; entry = entry->next) {
+        if (entry->hash != hash || entry->size != size) continue;
+        if (entry->layout != layout || entry->layout_seed != layout_seed) continue;
+        if (entry->refs++ == 0) idle_unlink(entry);
+        return &entry->map;
+    }
+    return NULL;
+}
+
+/* Генерация карты с таблицами в новую запись кэша (вне блокировки).
+ * Временная память генерации - отдельный регион, который освобождается до выхода */
+static MapCacheEntry* map_cache_generate(int size, MapLayout layout, uint32_t layout_seed) {
+    Region region;
+    if (region_init(&region, map_region_size(size)) < 0) return NULL;
+    
+    MapCacheEntry *entry = NULL;
+    Map scratch;
+    Vec2 first_spawn;
+    if (mapgen_generate(&scratch, size, layout, layout_seed, &region, &first_spawn) == 0 &&
+        map_build_tables(&scratch, first_spawn) == 0) {
+        size_t bytes = MAP_CACHE_HEADER_SIZE + map_packed_size(&scratch);
+        entry = (MapCacheEntry *)malloc(bytes);
+        if (entry) {
+            map_pack(&scratch, &entry->map, (uint8_t *)entry + MAP_CACHE_HEADER_SIZE);
+            entry->size = size;
+            entry->layout = layout;
+            entry->layout_seed = layout_seed;
+            entry->refs = 1;
+            entry->bytes = bytes;
+            entry->idle_prev = NULL;
+            entry->idle_next = NULL;
+        }
+    }
+    region_destroy(&region);
+    return entry;
+}
+
+/* Получение карты, сгенерированной по зерну */
+const Map* map_cache_acquire(int size, uint32_t seed) {
+    MapLayout layout;
+    uint32_t layout_seed;
+    mapgen_random_params(seed, &layout, &layout_seed);
+    uint64_t hash = map_cache_key(size, layout, layout_seed);
+    
+    pthread_mutex_lock(&cache_lock);
+    const Map *found = map_cache_find(size, layout, layout_seed, hash);
+    if (found) cache_stats.hits++;
+    pthread_mutex_unlock(&cache_lock);
+    if (found) return found;
+    
+    /* Карта генерируется вне блокировки: другие потоки тем временем получают свои карты */
+    MapCacheEntry *entry = map_cache_generate(size, layout, layout_seed);
+    if (!entry) return NULL;
+    entry->hash = hash;
+    
+    /* Пока карта строилась, ту же карту мог добавить другой поток */
+    pthread_mutex_lock(&cache_lock);
+    found = map_cache_find(size, layout, layout_seed, hash);
+    if (found) {
+        cache_stats.hits++;
+    } else {
+        MapCacheEntry **bucket = &cache_buckets[hash & (MAP_CACHE_BUCKETS - 1)];
+        entry->next = *bucket;
+        *bucket = entry;
+        cache_stats.misses++;
+        cache_stats.maps++;
+        cache_stats.bytes += entry->bytes;
+    }
+    pthread_mutex_unlock(&cache_lock);
+    
+    if (found) {
+        free(entry);
+        return found;
+    }
+    return &entry->map;
+}
+
+/* Возврат ссылки на карту: карта без ссылок ещё какое-то время ждёт повторного запроса */
+void map_cache_release(const Map *map) {
+    if (!map) return;
+    MapCacheEntry *entry = (MapCacheEntry *)map;
+    MapCacheEntry *evicted = NULL;
+    
+    pthread_mutex_lock(&cache_lock);
+    if (--entry->refs == 0) {
+        entry->idle_prev = idle_tail;
+        if (idle_tail) idle_tail->idle_next = entry;
+        else idle_head = entry;
+        idle_tail = entry;
+        idle_bytes += entry->bytes;
+        
+        /* Вытесненные записи собираются в список и освобождаются вне блокировки */
+        while (idle_bytes > MAP_CACHE_IDLE_BYTES) {
+            MapCacheEntry *oldest = idle_head;
+            idle_unlink(oldest);
+            map_cache_remove(oldest);
+            oldest->next = evicted;
+            evicted = oldest;
+        }
+    }
+    pthread_mutex_unlock(&cache_lock);
+    
+    while (evicted) {
+        MapCacheEntry *next = evicted->next;
+        free(evicted);
+        evicted = next;
+    }
+}
+
+/* Текущая статистика кэша */
+MapCacheStats map_cache_stats(void) {
+    pthread_mutex_lock(&cache_lock);
+    MapCacheStats stats = cache_stats;
+    pthread_mutex_unlock(&cache_lock);
+    return stats;
+}
@@ -0,0 +1,38 @@
+/*
+ * mapcache.h - Общий на процесс кэш карт
+ * Готовая карта неизменна, поэтому арены с одинаковой картой делят одну
+ * копию: карты ищутся по параметрам генерации (размер, раскладка, зерно раскладки)
+ * ещё до генерации и считают ссылки.
+ * Таблицы (выходы чанков для дистанций до стен, точки спавна) строятся один раз на уникальную карту.
+ * Потокобезопасен: матчи симулятора получают карты из разных потоков
+ */
+
+#ifndef MAPCACHE_H
+#define MAPCACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "map.h"
+
+/* Статистика кэша */
+typedef struct {
+    uint64_t hits;          /* Запросов, получивших уже готовую карту */
+    uint64_t misses;        /* Запросов, для которых генерировалась карта */
+    int maps;               /* Карт в кэше сейчас */
+    size_t bytes;           /* Память карт в кэше сейчас */
+} MapCacheStats;
+
+/* Получение карты, сгенерированной по зерну. Если карта с такими параметрами уже
+ * есть в кэше, отдаётся она; иначе карта генерируется во временном регионе
+ * (выделяется и освобождается здесь же) и добавляется в кэш.
+ * Возвращает NULL при нехватке памяти. Ссылку нужно вернуть map_cache_release */
+const Map* map_cache_acquire(int size, uint32_t seed);
+
+/* Возврат ссылки. Карта без ссылок остаётся в кэше, пока её не вытеснят
+ * более свежие (такие карты занимают не больше 64 МБ). NULL допускается */
+void map_cache_release(const Map *map);
+
+/* Текущая статистика кэша */
+MapCacheStats map_cache_stats(void);
+
+#endif /* MAPCACHE_H */
@@ -0,0 +1,192 @@
+/*
+ * mapgen.c - Реализация генератора карт арены
+ */
+
+#include "mapgen.h"
+#include "../common/rng.h"
+
+/* Минимальная доля пола, при которой раскладка считается годной (в процентах) */
+#define MAPGEN_MIN_FLOOR_PERCENT 50
+
+/* Запись клетки с зеркалированием по обеим осям (карта всегда симметрична).
+ * Возвращает 0 или -1, если запись не удалась */
+static int set_mirrored(Map *map, int x, int y, Terrain terrain) {
+    int last = map->size - 1;
+    if (map_write_terrain(map, vec2_create(x, y), terrain) < 0 ||
+        map_write_terrain(map, vec2_create(last - x, y), terrain) < 0 ||
+        map_write_terrain(map, vec2_create(x, last - y), terrain) < 0 ||
+        map_write_terrain(map, vec2_create(last - x, last - y), terrain) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/* Колонны на решётке с шагом 3-5 клеток. Раскладки возвращают 0 или -1 */
+static int generate_pillars(Map *map, Rng *rng) {
+    int half = map->size / 2;
+    int step = rng_range(rng, 3, 5);
+    int thick = rng_range(rng, 1, 2);
+    
+    for (int y = step; y < half; y += step) {
+        for (int x = step; x < half; x += step) {
+            for (int dy = 0; dy < thick && y + dy < half; dy++) {
+                for (int dx = 0; dx < thick && x + dx < half; dx++) {
+                    if (set_mirrored(map, x + dx, y + dy, TERRAIN_WALL) < 0) return -1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+/* Крестообразные перегородки с проходами - четыре комнаты */
+static int generate_rooms(Map *map, Rng *rng) {
+    int half = map->size / 2;
+    if (half < 4) return 0;
+    
+    /* Перегородки по центральным осям */
+    for (int i = 1; i < half; i++) {
+        if (set_mirrored(map, i, half - 1, TERRAIN_WALL) < 0 ||
+            set_mirrored(map, half - 1, i, TERRAIN_WALL) < 0) {
+            return -1;
+        }
+    }
+    
+    /* Проходы шириной 2 в каждой половине перегородки */
+    int door_x = rng_range(rng, 2, half - 3);
+    int door_y = rng_range(rng, 2, half - 3);
+    for (int d = 0; d < 2; d++) {
+        if (set_mirrored(map, door_x + d, half - 1, TERRAIN_FLOOR) < 0 ||
+            set_mirrored(map, half - 1, door_y + d, TERRAIN_FLOOR) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Случайные прямоугольные блоки в четверти карты с зеркалированием */
+static int generate_scatter(Map *map, Rng *rng) {
+    int half = map->size / 2;
+    if (half < 4) return 0;
+    
+    int blocks = rng_range(rng, 2, 2 + half / 3);
+    for (int b = 0; b < blocks; b++) {
+        int w = rng_range(rng, 1, 3);
+        int h = rng_range(rng, 1, 3);
+        int x0 = rng_range(rng, 2, half - 1);
+        int y0 = rng_range(rng, 2, half - 1);
+        for (int y = y0; y < y0 + h && y < half; y++) {
+            for (int x = x0; x < x0 + w && x < half; x++) {
+                if (set_mirrored(map, x, y, TERRAIN_WALL) < 0) return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* Заливка недостижимых участков пола стенами: остаётся одна связная область.
+ * Возвращает количество клеток пола в ней или -1, если не хватило памяти */
+static int keep_largest_region(Map *map) {
+    int cells = map->size * map->size;
+    
+    /* Временные буферы в конце региона карты */
+    size_t mark = region_mark(map->region);
+    int *region = (int *)region_alloc(map->region, (size_t)cells * sizeof(int));
+    int *queue = (int *)region_alloc(map->region, (size_t)cells * sizeof(int));
+    if (!region || !queue) {
+        region_rewind(map->region, mark);
+        return -1;
+    }
+    
+    for (int i = 0; i < cells; i++) region[i] = -1;
+    
+    int best_region = -1;
+    int best_size = 0;
+    int region_count = 0;
+    
+    for (int start = 0; start < cells; start++) {
+        if (region[start] >= 0 || !map_is_walkable(map, map_index_to_pos(map, start))) continue;
+        
+        /* BFS по 4-связности */
+        int head = 0;
+        int tail = 0;
+        queue[tail++] = start;
+        region[start] = region_count;
+        while (head < tail) {
+            Vec2 pos = map_index_to_pos(map, queue[head++]);
+            for (int d = DIR_UP; d <= DIR_RIGHT; d++) {
+                Vec2 next = vec2_add(pos, direction_to_vec2((Direction)d));
+                if (!map_is_walkable(map, next)) continue;
+                int index = map_pos_to_index(map, next);
+                if (region[index] < 0) {
+                    region[index] = region_count;
+                    queue[tail++] = index;
+                }
+            }
+        }
+        
+        if (tail > best_size) {
+            best_size = tail;
+            best_region = region_count;
+        }
+        region_count++;
+    }
+    
+    for (int i = 0; i < cells; i++) {
+        if (region[i] >= 0 && region[i] != best_region &&
+            map_write_terrain(map, map_index_to_pos(map, i), TERRAIN_WALL) < 0) {
+            best_size = -1;
+            break;
+        }
+    }
+    
+    region_rewind(map->region, mark);
+    return best_size;
+}
+
+/* Генерация террейна заданной раскладки */
+int mapgen_generate(Map *map, int size, MapLayout layout, uint32_t seed, Region *region, Vec2 *first_spawn) {
+    size_t mark = region_mark(region);
+    *first_spawn = vec2_create(1, 1);
+    if (map_init(map, size, region) < 0) return -1;
+    if (layout == MAP_LAYOUT_EMPTY) return 0;
+    
+    Rng rng = rng_create(seed);
+    int result = 0;
+    switch (layout) {
+        case MAP_LAYOUT_PILLARS: result = generate_pillars(map, &rng); break;
+        case MAP_LAYOUT_ROOMS:   result = generate_rooms(map, &rng); break;
+        case MAP_LAYOUT_SCATTER: result = generate_scatter(map, &rng); break;
+        default: break;
+    }
+    if (result < 0) return -1;
+    
+    /* Слишком тесная раскладка заменяется пустой (память неудачной раскладки возвращается региону) */
+    int floor = keep_largest_region(map);
+    if (floor < 0) return -1;
+    int interior = (size - 2) * (size - 2);
+    if (floor * 100 < interior * MAPGEN_MIN_FLOOR_PERCENT) {
+        region_rewind(region, mark);
+        return map_init(map, size, region);
+    }
+    
+    /* Первая точка спавна выбирается по зерну */
+    *first_spawn = vec2_create(rng_range(&rng, 1, size - 2), rng_range(&rng, 1, size - 2));
+    return 0;
+}
+
+/* Параметры случайной карты по зерну */
+void mapgen_random_params(uint32_t seed, MapLayout *layout, uint32_t *layout_seed) {
+    Rng rng = rng_create(seed);
+    *layout = (MapLayout)rng_range(&rng, 0, MAP_LAYOUT_COUNT - 1);
+    *layout_seed = rng_next(&rng);
+    if (*layout == MAP_LAYOUT_EMPTY) *layout_seed = 0;
+}
+
+/* Генерация террейна со случайной раскладкой */
+int mapgen_generate_random(Map *map, int size, uint32_t seed, Region *region, Vec2 *first_spawn) {
+    MapLayout layout;
+    uint32_t layout_seed;
+    mapgen_random_params(seed, &layout, &layout_seed);
+    return mapgen_generate(map, size, layout, layout_seed, region, first_spawn);
+}
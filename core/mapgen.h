@@ -0,0 +1,34 @@
+/*
+ * mapgen.h - Генератор карт арены
+ * Процедурные симметричные раскладки с препятствиями по зерну
+ */
+
+#ifndef MAPGEN_H
+#define MAPGEN_H
+
+#include <stdint.h>
+#include "map.h"
+
+/* Тип раскладки карты */
+typedef enum {
+    MAP_LAYOUT_EMPTY = 0,       /* Пустой квадрат со стенами по периметру */
+    MAP_LAYOUT_PILLARS = 1,     /* Решётка колонн */
+    MAP_LAYOUT_ROOMS = 2,       /* Четыре комнаты с проходами */
+    MAP_LAYOUT_SCATTER = 3,     /* Случайные блоки с зеркальной симметрией */
+    MAP_LAYOUT_COUNT = 4        /* Количество раскладок */
+} MapLayout;
+
+/* Генерация террейна заданной раскладки на месте, память берётся из региона.
+ * Таблицы не строятся: first_spawn получает клетку, от которой map_build_tables
+ * строит список спавна. Одинаковые (size, layout, seed) дают одинаковую карту.
+ * Возвращает 0 или -1 при нехватке памяти */
+int mapgen_generate(Map *map, int size, MapLayout layout, uint32_t seed, Region *region, Vec2 *first_spawn);
+
+/* Параметры случайной карты по зерну: раскладка и зерно раскладки. Зерно, которое
+ * раскладка не использует, обнуляется: одинаковые параметры - одинаковая карта */
+void mapgen_random_params(uint32_t seed, MapLayout *layout, uint32_t *layout_seed);
+
+/* Генерация террейна со случайной раскладкой, выбранной по зерну (mapgen_random_params) */
+int mapgen_generate_random(Map *map, int size, uint32_t seed, Region *region, Vec2 *first_spawn);
+
+#endif /* MAPGEN_H */
@@ -0,0 +1,264 @@
+/*
+ * maplib.c - Реализация библиотеки карт на диске
+ */
+
+#include "maplib.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Минимальный размер карты в библиотеке (периметр и хотя бы одна клетка пола) */
+#define MAP_LIBRARY_MIN_SIZE 3
+
+/* Хэш имени карты (FNV-1a) */
+static uint32_t name_hash(const char *name) {
+    uint32_t hash = 2166136261u;
+    for (; *name; name++) {
+        hash = (hash ^ (uint8_t)*name) * 16777619u;
+    }
+    return hash;
+}
+
+/* Выравнивание смещения вверх */
+static uint64_t align_up(uint64_t offset) {
+    return (offset + MAP_LIBRARY_ALIGN - 1) & ~(uint64_t)(MAP_LIBRARY_ALIGN - 1);
+}
+
+/* Проверка, что диапазон [offset, offset + size) лежит внутри файла */
+static int range_valid(const MapLibrary *library, uint64_t offset, uint64_t size) {
+    return offset <= library->length && size <= library->length - offset;
+}
+
+/* Проверка записи карты и её блока: после открытия карты загружаются без проверок */
+static int entry_valid(const MapLibrary *library, const MapLibraryEntry *entry) {
+    if (memchr(entry->name, '\0', MAP_LIBRARY_NAME_SIZE) == NULL || entry->name[0] == '\0') return 0;
+    if (entry->size < MAP_LIBRARY_MIN_SIZE || entry->size > MAP_MAX_SIZE) return 0;
+    if (entry->spawn_count > MAP_MAX_SPAWNS) return 0;
+    if (entry->data_offset % MAP_LIBRARY_ALIGN != 0) return 0;
+    if (!range_valid(library, entry->data_offset, entry->data_size)) return 0;
+    
+    for (uint32_t i = 0; i < entry->spawn_count; i++) {
+        if (entry->spawns[i][0] < 0 || entry->spawns[i][0] >= (int)entry->size) return 0;
+        if (entry->spawns[i][1] < 0 || entry->spawns[i][1] >= (int)entry->size) return 0;
+    }
+    
+    uint64_t chunks_per_side = (entry->size + MAP_CHUNK_SIZE - 1) / MAP_CHUNK_SIZE;
+    uint64_t chunk_count = chunks_per_side * chunks_per_side;
+    uint64_t tables = chunk_count * sizeof(MapChunk) + chunk_count * 4 * MAP_CHUNK_SIZE * sizeof(uint16_t);
+    if (entry->data_size < tables) return 0;
+    uint64_t cells_size = entry->data_size - tables;
+    
+    const MapChunk *chunks = (const MapChunk *)(library->data + entry->data_offset);
+    for (uint64_t i = 0; i < chunk_count; i++) {
+        if (chunks[i].cells != MAP_CHUNK_UNIFORM && (uint64_t)chunks[i].cells + MAP_CHUNK_CELLS > cells_size) {
+            return 0;
+        }
+    }
+    
+    /* Выходы чанков и точки спавна проверяются по террейну: по ним ходят боты и ставятся игроки */
+    Map map;
+    map_init_packed(&map, (int)entry->size, chunks);
+    if (!map_packed_valid(&map)) return 0;
+    for (uint32_t i = 0; i < entry->spawn_count; i++) {
+        if (!map_is_walkable(&map, vec2_create(entry->spawns[i][0], entry->spawns[i][1]))) return 0;
+    }
+    return 1;
+}
+
+/* Проверка таблицы поиска: индексы в пределах, занятых слотов ровно map_count,
+ * поэтому в таблице всегда есть пустой слот и поиск по ней конечен */
+static int slots_valid(const uint32_t *slots, uint32_t slot_count, uint32_t map_count) {
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < slot_count; i++) {
+        if (slots[i] > map_count) return 0;
+        if (slots[i] != 0) used++;
+    }
+    return used == map_count;
+}
+
+/* Открытие библиотеки */
+int map_library_open(MapLibrary *library, const char *path) {
+    memset(library, 0, sizeof(MapLibrary));
+    
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(MapLibraryHeader)) {
+        close(fd);
+        return -1;
+    }
+    
+    /* Отображение только для чтения: страницы файла общие для всех процессов */
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return -1;
+    
+    library->data = (const uint8_t *)data;
+    library->length = (size_t)st.st_size;
+    library->header = (const MapLibraryHeader *)data;
+    
+    const MapLibraryHeader *header = library->header;
+    uint32_t slots = header->slot_count;
+    int valid = memcmp(header->magic, MAP_LIBRARY_MAGIC, 4) == 0 &&
+                header->version == MAP_LIBRARY_VERSION &&
+                header->byte_order == MAP_LIBRARY_BYTE_ORDER &&
+                header->file_size == library->length &&
+                header->map_count > 0 &&
+                slots > header->map_count && (slots & (slots - 1)) == 0 &&
+                header->entries_offset % MAP_LIBRARY_ALIGN == 0 &&
+                header->name_slots_offset % sizeof(uint32_t) == 0 &&
+                header->hash_slots_offset % sizeof(uint32_t) == 0 &&
+                range_valid(library, header->entries_offset, (uint64_t)header->map_count * sizeof(MapLibraryEntry)) &&
+                range_valid(library, header->name_slots_offset, (uint64_t)slots * sizeof(uint32_t)) &&
+                range_valid(library, header->hash_slots_offset, (uint64_t)slots * sizeof(uint32_t));
+    
+    if (valid) {
+        library->entries = (const MapLibraryEntry *)(library->data + header->entries_offset);
+        library->name_slots = (const uint32_t *)(library->data + header->name_slots_offset);
+        library->hash_slots = (const uint32_t *)(library->data + header->hash_slots_offset);
+        for (uint32_t i = 0; valid && i < header->map_count; i++) {
+            valid = entry_valid(library, &library->entries[i]);
+        }
+        valid = valid && slots_valid(library->name_slots, slots, header->map_count) &&
+                slots_valid(library->hash_slots, slots, header->map_count);
+    }
+    
+    if (!valid) {
+        map_library_close(library);
+        return -1;
+    }
+    return 0;
+}
+
+/* Закрытие библиотеки */
+void map_library_close(MapLibrary *library) {
+    if (library->data) {
+        munmap((void *)library->data, library->length);
+    }
+    memset(library, 0, sizeof(MapLibrary));
+}
+
+/* Количество карт */
+int map_library_count(const MapLibrary *library) {
+    return library->header ? (int)library->header->map_count : 0;
+}
+
+/* Имя карты по индексу */
+const char* map_library_name(const MapLibrary *library, int index) {
+    return library->entries[index].name;
+}
+
+/* Размер карты по индексу */
+int map_library_map_size(const MapLibrary *library, int index) {
+    return (int)library->entries[index].size;
+}
+
+/* Поиск карты по имени (не больше slot_count проб, даже если пустой слот потерян) */
+int map_library_find(const MapLibrary *library, const char *name) {
+    uint32_t mask = library->header->slot_count - 1;
+    uint32_t slot = name_hash(name) & mask;
+    for (uint32_t probe = 0; probe <= mask && library->name_slots[slot] != 0; probe++, slot = (slot + 1) & mask) {
+        int index = (int)library->name_slots[slot] - 1;
+        if (strncmp(library->entries[index].name, name, MAP_LIBRARY_NAME_SIZE) == 0) return index;
+    }
+    return -1;
+}
+
+/* Поиск карты по хэшу террейна (не больше slot_count проб) */
+int map_library_find_hash(const MapLibrary *library, uint64_t terrain_hash) {
+    uint32_t mask = library->header->slot_count - 1;
+    uint32_t slot = (uint32_t)terrain_hash & mask;
+    for (uint32_t probe = 0; probe <= mask && library->hash_slots[slot] != 0; probe++, slot = (slot + 1) & mask) {
+        int index = (int)library->hash_slots[slot] - 1;
+        if (library->entries[index].terrain_hash == terrain_hash) return index;
+    }
+    return -1;
+}
+
+/* Загрузка карты за O(1) */
+void map_library_load(const MapLibrary *library, int index, Map *map) {
+    const MapLibraryEntry *entry = &library->entries[index];
+    map_init_packed(map, (int)entry->size, library->data + entry->data_offset);
+    
+    map->spawn_count = (int)entry->spawn_count;
+    for (int i = 0; i < map->spawn_count; i++) {
+        map->spawns[i] = vec2_create(entry->spawns[i][0], entry->spawns[i][1]);
+    }
+}
+
+/* Вставка индекса в таблицу открытой адресации */
+static void slots_insert(uint32_t *slots, uint32_t slot_count, uint32_t hash, int index) {
+    uint32_t slot = hash & (slot_count - 1);
+    while (slots[slot] != 0) slot = (slot + 1) & (slot_count - 1);
+    slots[slot] = (uint32_t)index + 1;
+}
+
+/* Запись библиотеки */
+int map_library_write(const char *path, const Map *const *maps, const char *const *names, int count) {
+    if (count <= 0) return -1;
+    
+    uint32_t slot_count = 2;
+    while (slot_count < 2 * (uint32_t)count) slot_count *= 2;
+    
+    /* Раскладка файла */
+    MapLibraryHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAP_LIBRARY_MAGIC, 4);
+    header.version = MAP_LIBRARY_VERSION;
+    header.byte_order = MAP_LIBRARY_BYTE_ORDER;
+    header.map_count = (uint32_t)count;
+    header.slot_count = slot_count;
+    header.entries_offset = align_up(sizeof(MapLibraryHeader));
+    header.name_slots_offset = header.entries_offset + (uint64_t)count * sizeof(MapLibraryEntry);
+    header.hash_slots_offset = header.name_slots_offset + (uint64_t)slot_count * sizeof(uint32_t);
+    
+    uint64_t offset = align_up(header.hash_slots_offset + (uint64_t)slot_count * sizeof(uint32_t));
+    for (int i = 0; i < count; i++) {
+        offset = align_up(offset + map_packed_size(maps[i]));
+    }
+    header.file_size = offset;
+    
+    uint8_t *file = (uint8_t *)calloc(1, (size_t)header.file_size);
+    if (!file) return -1;
+    memcpy(file, &header, sizeof(header));
+    
+    MapLibraryEntry *entries = (MapLibraryEntry *)(file + header.entries_offset);
+    uint32_t *name_slots = (uint32_t *)(file + header.name_slots_offset);
+    uint32_t *hash_slots = (uint32_t *)(file + header.hash_slots_offset);
+    
+    offset = align_up(header.hash_slots_offset + (uint64_t)slot_count * sizeof(uint32_t));
+    for (int i = 0; i < count; i++) {
+        const Map *map = maps[i];
+        MapLibraryEntry *entry = &entries[i];
+        strncpy(entry->name, names[i], MAP_LIBRARY_NAME_SIZE - 1);
+        entry->terrain_hash = map_terrain_hash(map);
+        entry->data_offset = offset;
+        entry->data_size = map_packed_size(map);
+        entry->size = (uint32_t)map->size;
+        entry->spawn_count = (uint32_t)map->spawn_count;
+        for (int s = 0; s < map->spawn_count; s++) {
+            entry->spawns[s][0] = (int16_t)map->spawns[s].x;
+            entry->spawns[s][1] = (int16_t)map->spawns[s].y;
+        }
+        
+        Map packed;
+        map_pack(map, &packed, file + offset);
+        slots_insert(name_slots, slot_count, name_hash(entry->name), i);
+        slots_insert(hash_slots, slot_count, (uint32_t)entry->terrain_hash, i);
+        offset = align_up(offset + entry->data_size);
+    }
+    
+    FILE *out = fopen(path, "wb");
+    int result = -1;
+    if (out) {
+        if (fwrite(file, 1, (size_t)header.file_size, out) == (size_t)header.file_size) result = 0;
+        if (fclose(out) != 0) result = -1;
+    }
+    free(file);
+    return result;
+}
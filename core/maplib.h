@@ -0,0 +1,98 @@
+/*
+ * maplib.h - Библиотека карт на диске
+ * Файл отображается в память только для чтения и без разбора: карта из библиотеки -
+ * структура Map поверх упакованного блока файла (map_init_packed), загрузка за O(1).
+ * Один файл разделяют все процессы сервера.
+ *
+ * Формат (порядок байт машины, проверяется по заголовку, все смещения от начала файла):
+ *   MapLibraryHeader
+ *   MapLibraryEntry[map_count]     - карты: имя, хэш террейна, точки спавна, блок данных
+ *   uint32_t name_slots[slot_count] - открытая адресация по хэшу имени (индекс + 1, 0 - пусто)
+ *   uint32_t hash_slots[slot_count] - то же по хэшу террейна
+ *   блоки данных карт               - упакованная карта (map_pack): чанки, выходы чанков, клетки
+ */
+
+#ifndef MAPLIB_H
+#define MAPLIB_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "map.h"
+
+/* Сигнатура и версия формата */
+#define MAP_LIBRARY_MAGIC "AAML"
+#define MAP_LIBRARY_VERSION 2
+
+/* Метка порядка байт: файл другой архитектуры читается как 0x0201 */
+#define MAP_LIBRARY_BYTE_ORDER 0x0102
+
+/* Длина имени карты вместе с завершающим нулём */
+#define MAP_LIBRARY_NAME_SIZE 32
+
+/* Выравнивание блоков данных в файле */
+#define MAP_LIBRARY_ALIGN 16
+
+/* Заголовок файла */
+typedef struct {
+    char magic[4];              /* MAP_LIBRARY_MAGIC */
+    uint16_t version;           /* MAP_LIBRARY_VERSION */
+    uint16_t byte_order;        /* MAP_LIBRARY_BYTE_ORDER */
+    uint32_t map_count;         /* Количество карт */
+    uint32_t slot_count;        /* Размер таблиц поиска (степень двойки, больше map_count) */
+    uint64_t file_size;         /* Полный размер файла */
+    uint64_t entries_offset;    /* Смещение записей карт */
+    uint64_t name_slots_offset; /* Смещение таблицы поиска по имени */
+    uint64_t hash_slots_offset; /* Смещение таблицы поиска по хэшу террейна */
+} MapLibraryHeader;
+
+/* Запись карты */
+typedef struct {
+    char name[MAP_LIBRARY_NAME_SIZE]; /* Имя карты */
+    uint64_t terrain_hash;      /* map_terrain_hash */
+    uint64_t data_offset;       /* Смещение упакованного блока */
+    uint64_t data_size;         /* Размер блока (map_packed_size) */
+    uint32_t size;              /* Размер карты */
+    uint32_t spawn_count;       /* Количество точек спавна */
+    int16_t spawns[MAP_MAX_SPAWNS][2]; /* Точки спавна (x, y) по убыванию удалённости */
+} MapLibraryEntry;
+
+/* Открытая библиотека */
+typedef struct {
+    const uint8_t *data;        /* Отображение файла */
+    size_t length;              /* Размер отображения */
+    const MapLibraryHeader *header;
+    const MapLibraryEntry *entries;
+    const uint32_t *name_slots;
+    const uint32_t *hash_slots;
+} MapLibrary;
+
+/* Открытие библиотеки: отображение файла и проверка заголовка, границ всех блоков,
+ * таблиц поиска (ровно map_count занятых слотов) и карт по террейну (выходы чанков,
+ * точки спавна на полу). Возвращает 0 или -1 (файл недоступен или повреждён) */
+int map_library_open(MapLibrary *library, const char *path);
+
+/* Закрытие библиотеки (карты из неё больше нельзя использовать) */
+void map_library_close(MapLibrary *library);
+
+/* Количество карт */
+int map_library_count(const MapLibrary *library);
+
+/* Имя карты по индексу */
+const char* map_library_name(const MapLibrary *library, int index);
+
+/* Размер карты по индексу */
+int map_library_map_size(const MapLibrary *library, int index);
+
+/* Поиск карты по имени, индекс или -1 */
+int map_library_find(const MapLibrary *library, const char *name);
+
+/* Поиск карты по хэшу террейна, индекс первой подходящей или -1 */
+int map_library_find_hash(const MapLibrary *library, uint64_t terrain_hash);
+
+/* Загрузка карты за O(1): map указывает в отображение файла и живёт, пока открыта библиотека */
+void map_library_load(const MapLibrary *library, int index, Map *map);
+
+/* Запись библиотеки из готовых карт (с построенными таблицами). Возвращает 0 или -1 */
+int map_library_write(const char *path, const Map *const *maps, const char *const *names, int count);
+
+#endif /* MAPLIB_H */
@@ -9,8 +9,10 @@ Player player_create(char symbol) {
     Player p;
     p.symbol = symbol;
     p.points = 0;
-    p.entity_id = -1;
+    p.entity_id = ENTITY_ID_NONE;
     p.connected = 0;
+    p.spells_cast = 0;
+    player_clear_inputs(&p);
     return p;
 }
 
@@ -26,6 +28,37 @@ int player_is_alive(Player *player) {
 
 /* Сброс игрока для новой арены */
 void player_reset(Player *player) {
-    player->entity_id = -1;
+    player->entity_id = ENTITY_ID_NONE;
+    player_clear_inputs(player);
+}
+
+/* Ввод без действий на заданный тик */
+PlayerInput player_input_none(uint32_t tick) {
+    PlayerInput input;
+    input.tick = tick;
+    input.move = DIR_NONE;
+    input.cast = DIR_NONE;
+    input.spell_type = SPELL_TYPE_BASIC;
+    input.rewind = 0;
+    input.buffered = 0;
+    return input;
+}
+
+/* Постановка ввода в очередь */
+int player_queue_input(Player *player, const PlayerInput *input) {
+    if (player->input_count >= PLAYER_INPUT_QUEUE_SIZE) {
+        return -1;
+    }
+    int tail = (player->input_head + player->input_count) % PLAYER_INPUT_QUEUE_SIZE;
+    player->inputs[tail] = *input;
+    player->input_count++;
+    return 0;
+}
+
+/* Очистка очереди и отложенных действий */
+void player_clear_inputs(Player *player) {
+    player->input_head = 0;
+    player->input_count = 0;
+    player->next = player_input_none(0);
 }
 
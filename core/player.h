@@ -6,15 +6,39 @@
 #ifndef PLAYER_H
 #define PLAYER_H
 
+#include "entity.h"
+
 /* Максимальное количество игроков */
 #define MAX_PLAYERS 8
 
+/* Ёмкость очереди ввода игрока */
+#define PLAYER_INPUT_QUEUE_SIZE 8
+
+/* Ввод игрока на тик (DIR_NONE = действия нет) */
+typedef struct {
+    uint32_t tick;          /* Тик арены, в начале которого ввод применяется */
+    Direction move;         /* Направление движения */
+    Direction cast;         /* Направление заклинания */
+    SpellType spell_type;   /* Тип заклинания */
+    int rewind;             /* Откат попаданий заклинания в тиках (компенсация лага) */
+    int buffered;           /* 1 - разовое нажатие: во время перезарядки ждёт её конца,
+                             * 0 - решение на свой тик (боты решают заново каждый тик) */
+} PlayerInput;
+
 /* Игрок */
 typedef struct {
     char symbol;    /* Символ игрока */
     int points;     /* Набранные очки */
-    int entity_id;  /* ID сущности на арене (-1 если нет) */
+    int entity_id;  /* Хэндл сущности на арене (ENTITY_ID_NONE если нет) */
     int connected;  /* Флаг подключения */
+    int spells_cast; /* Создано заклинаний за игру */
+    
+    /* Ввод ждёт своего тика в очереди; разовое действие, пришедшее во время
+     * перезарядки, откладывается (одно движение и одно заклинание) */
+    PlayerInput inputs[PLAYER_INPUT_QUEUE_SIZE]; /* Очередь ввода (кольцевой буфер) */
+    int input_head;         /* Начало очереди */
+    int input_count;        /* Количество вводов в очереди */
+    PlayerInput next;       /* Отложенные до конца перезарядки действия */
 } Player;
 
 /* Создание игрока */
@@ -29,5 +53,14 @@ int player_is_alive(Player *player);
 /* Сброс игрока для новой арены */
 void player_reset(Player *player);
 
+/* Ввод без действий на заданный тик */
+PlayerInput player_input_none(uint32_t tick);
+
+/* Постановка ввода в очередь, возвращает 0 или -1 если очередь заполнена */
+int player_queue_input(Player *player, const PlayerInput *input);
+
+/* Очистка очереди и отложенных действий */
+void player_clear_inputs(Player *player);
+
 #endif /* PLAYER_H */
 
@@ -0,0 +1,190 @@
+/*
+ * sim.c - Реализация безголовой симуляции матчей
+ */
+
+#include "sim.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void sim_input_source(Game *game, int player_index, void *user);
+
+/* Параметры по умолчанию */
+SimConfig sim_config_default(void) {
+    SimConfig config;
+    config.seed = 1;
+    config.map_size = 20;
+    config.winner_points = 5;
+    config.player_count = 2;
+    config.max_ticks = SIM_DEFAULT_MAX_TICKS;
+    config.map_library = NULL;
+    config.library_map = -1;
+    return config;
+}
+
+/* Пустой вход */
+SimInput sim_input_none(void) {
+    SimInput input;
+    input.move = DIR_NONE;
+    input.cast = DIR_NONE;
+    input.spell_type = SPELL_TYPE_BASIC;
+    return input;
+}
+
+/* Создание матча */
+SimMatch* sim_match_create(const SimConfig *config) {
+    SimMatch *match = (SimMatch *)malloc(sizeof(SimMatch));
+    if (!match) return NULL;
+    memset(match, 0, sizeof(SimMatch));
+    
+    match->config = *config;
+    if (match->config.player_count < 2) match->config.player_count = 2;
+    if (match->config.player_count > MAX_PLAYERS) match->config.player_count = MAX_PLAYERS;
+    
+    match->game = game_create(config->map_size, config->winner_points, match->config.player_count);
+    if (!match->game) {
+        free(match);
+        return NULL;
+    }
+    game_set_seed(match->game, config->seed);
+    if (config->map_library) {
+        game_set_map_library(match->game, config->map_library, config->library_map);
+    }
+    game_set_input_source(match->game, sim_input_source, match);
+    match->bot_rng = rng_create(config->seed ^ BOT_SEED_SALT);
+    match->bot_nav = bot_nav_create();
+    if (!match->bot_nav) {
+        game_destroy(match->game);
+        free(match);
+        return NULL;
+    }
+    
+    for (int i = 0; i < match->config.player_count; i++) {
+        game_add_player(match->game, (char)('A' + i));
+        match->controllers[i] = sim_bot_controller;
+    }
+    
+    match->result.seed = config->seed;
+    match->result.winner_index = -1;
+    
+    game_start(match->game);
+    match->result.arenas = match->game->arena_number;
+    return match;
+}
+
+/* Назначение источника входов игроку */
+void sim_match_set_controller(SimMatch *match, int player_index, SimController controller, void *user) {
+    if (player_index < 0 || player_index >= MAX_PLAYERS) return;
+    match->controllers[player_index] = controller;
+    match->controller_data[player_index] = user;
+}
+
+/* Скриптовый вход на следующий тик */
+void sim_match_set_input(SimMatch *match, int player_index, const SimInput *input) {
+    if (player_index < 0 || player_index >= MAX_PLAYERS) return;
+    match->pending[player_index] = *input;
+    match->has_pending[player_index] = 1;
+}
+
+/* Источник ввода игры: вход игрока ставится в очередь в начале тика
+ * (тем же путём, что и сообщения клиентов) */
+static void sim_input_source(Game *game, int player_index, void *user) {
+    SimMatch *match = (SimMatch *)user;
+    
+    SimInput input = sim_input_none();
+    if (match->has_pending[player_index]) {
+        input = match->pending[player_index];
+        match->has_pending[player_index] = 0;
+    } else if (match->controllers[player_index]) {
+        match->controllers[player_index](match, player_index, &input, match->controller_data[player_index]);
+    }
+    if (input.move == DIR_NONE && input.cast == DIR_NONE) return;
+    
+    PlayerInput queued = player_input_none(game_next_input_tick(game));
+    queued.move = input.move;
+    queued.cast = input.cast;
+    queued.spell_type = input.spell_type;
+    game_queue_input(game, player_index, &queued);
+}
+
+/* Фиксация итога по текущему состоянию игры */
+static void sim_update_result(SimMatch *match) {
+    Game *game = match->game;
+    match->result.spells_cast = 0;
+    for (int i = 0; i < game->player_count; i++) {
+        match->result.points[i] = game->players[i].points;
+        match->result.spells_cast += game->players[i].spells_cast;
+    }
+    
+    if (game->state == GAME_STATE_FINISHED) {
+        match->result.finished = 1;
+        match->result.winner = game_get_winner(game);
+        match->result.winner_index = game_get_player_index(game, match->result.winner);
+    }
+}
+
+/* Проверка окончания матча */
+int sim_match_is_over(SimMatch *match) {
+    if (match->game->state != GAME_STATE_PLAYING) return 1;
+    return match->config.max_ticks > 0 && match->result.ticks >= match->config.max_ticks;
+}
+
+/* Шаг матча на ticks тиков */
+int sim_match_step(SimMatch *match, int ticks) {
+    int played = 0;
+    
+    while (played < ticks && !sim_match_is_over(match)) {
+        game_step(match->game, SIM_TICK_SECONDS);
+        match->result.ticks++;
+        match->result.arenas = match->game->arena_number;
+        played++;
+    }
+    
+    sim_update_result(match);
+    return played;
+}
+
+/* Освобождение матча */
+void sim_match_destroy(SimMatch *match) {
+    if (!match) return;
+    bot_nav_destroy(match->bot_nav);
+    game_destroy(match->game);
+    free(match);
+}
+
+/* Встроенный бот */
+void sim_bot_controller(SimMatch *match, int player_index, SimInput *input, void *user) {
+    (void)user;
+    BotInput action = bot_think(match->bot_nav, match->game, player_index, &match->bot_rng);
+    input->move = action.move;
+    input->cast = action.cast;
+    input->spell_type = action.spell_type;
+}
+
+/* Прогон одного матча ботов до конца */
+SimResult sim_run_match(const SimConfig *config) {
+    SimResult result;
+    SimMatch *match = sim_match_create(config);
+    if (!match) {
+        memset(&result, 0, sizeof(result));
+        result.seed = config->seed;
+        result.winner_index = -1;
+        return result;
+    }
+    
+    while (!sim_match_is_over(match)) {
+        sim_match_step(match, 1024);
+    }
+    
+    result = match->result;
+    sim_match_destroy(match);
+    return result;
+}
+
+/* Пакетный прогон */
+void sim_run_batch(const SimConfig *config, int match_count, SimResult *results) {
+    for (int i = 0; i < match_count; i++) {
+        SimConfig match_config = *config;
+        match_config.seed = config->seed + (uint64_t)i;
+        results[i] = sim_run_match(&match_config);
+    }
+}
@@ -0,0 +1,101 @@
+/*
+ * sim.h - Безголовая симуляция матчей
+ * Матч по зерну без сокетов и вывода: входы от скрипта или ботов, шаг на N тиков, результат
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include "game.h"
+#include "bot.h"
+
+/* Длительность тика симуляции в секундах (как у сервера, ~60 FPS) */
+#define SIM_TICK_SECONDS (16 / 1000.0f)
+
+/* Лимит тиков матча по умолчанию: 10 минут игрового времени.
+ * Боты могут зайти в тупик, поэтому матч без лимита не гарантированно заканчивается */
+#define SIM_DEFAULT_MAX_TICKS 36000
+
+/* Действия игрока на один тик (DIR_NONE = действия нет) */
+typedef struct {
+    Direction move;         /* Направление движения */
+    Direction cast;         /* Направление заклинания */
+    SpellType spell_type;   /* Тип заклинания */
+} SimInput;
+
+/* Параметры матча */
+typedef struct {
+    uint64_t seed;          /* Зерно матча */
+    int map_size;           /* Размер карты */
+    int winner_points;      /* Очки для победы */
+    int player_count;       /* Количество игроков (2..MAX_PLAYERS) */
+    int max_ticks;          /* Ограничение длины матча в тиках (0 = без ограничения) */
+    const MapLibrary *map_library; /* Библиотека карт (NULL - карты генерируются по зерну) */
+    int library_map;        /* Карта библиотеки для всех арен или -1 - по зерну арены */
+} SimConfig;
+
+/* Итог матча */
+typedef struct {
+    uint64_t seed;              /* Зерно матча */
+    int finished;               /* Матч завершён победой (0 = упёрся в max_ticks) */
+    char winner;                /* Символ победителя ('\0' если нет) */
+    int winner_index;           /* Индекс победителя (-1 если нет) */
+    int ticks;                  /* Сыграно тиков */
+    int arenas;                 /* Сыграно арен */
+    int spells_cast;            /* Создано заклинаний */
+    int points[MAX_PLAYERS];    /* Очки игроков */
+} SimResult;
+
+typedef struct SimMatch SimMatch;
+
+/* Источник входов игрока (бот или скрипт), вызывается раз в тик */
+typedef void (*SimController)(SimMatch *match, int player_index, SimInput *input, void *user);
+
+/* Безголовый матч */
+struct SimMatch {
+    SimConfig config;                           /* Параметры */
+    Game *game;                                 /* Игра */
+    SimResult result;                           /* Текущий итог */
+    SimController controllers[MAX_PLAYERS];     /* Источники входов (NULL = нет) */
+    void *controller_data[MAX_PLAYERS];         /* Данные источников входов */
+    SimInput pending[MAX_PLAYERS];              /* Скриптовые входы на следующий тик */
+    int has_pending[MAX_PLAYERS];               /* Флаги наличия скриптовых входов */
+    Rng bot_rng;                                /* Генератор решений встроенных ботов */
+    BotNav *bot_nav;                            /* Общие поля расстояний встроенных ботов */
+};
+
+/* Параметры по умолчанию (как у сервера: карта 20, 5 очков, 2 игрока; лимит SIM_DEFAULT_MAX_TICKS) */
+SimConfig sim_config_default(void);
+
+/* Пустой вход (без действий) */
+SimInput sim_input_none(void);
+
+/* Создание матча; все игроки по умолчанию управляются встроенным ботом */
+SimMatch* sim_match_create(const SimConfig *config);
+
+/* Назначение источника входов игроку (NULL - игрок бездействует) */
+void sim_match_set_controller(SimMatch *match, int player_index, SimController controller, void *user);
+
+/* Скриптовый вход на следующий тик (имеет приоритет над источником входов) */
+void sim_match_set_input(SimMatch *match, int player_index, const SimInput *input);
+
+/* Шаг матча на ticks тиков, возвращает число сыгранных тиков (меньше при завершении) */
+int sim_match_step(SimMatch *match, int ticks);
+
+/* Проверка окончания матча (победа или max_ticks) */
+int sim_match_is_over(SimMatch *match);
+
+/* Освобождение матча */
+void sim_match_destroy(SimMatch *match);
+
+/* Встроенный бот (bot_think): идёт по полю к огневой позиции ближайшего врага и стреляет */
+void sim_bot_controller(SimMatch *match, int player_index, SimInput *input, void *user);
+
+/* Прогон одного матча ботов до конца */
+SimResult sim_run_match(const SimConfig *config);
+
+/* Пакетный прогон: матч i играется с зерном config->seed + i */
+void sim_run_batch(const SimConfig *config, int match_count, SimResult *results);
+
+#endif /* SIM_H */
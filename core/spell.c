@@ -3,30 +3,23 @@
  */
 
 #include "spell.h"
+#include <string.h>
 
 /* Время между перемещениями заклинания (при скорости 15.0 - быстрое движение) */
 #define SPELL_MOVE_INTERVAL 0.066f
 
-/* Создание заклинания */
-Spell spell_create(int id, int caster_id, Vec2 pos, Direction dir, int damage, float speed, int spell_type) {
-    Spell s;
-    s.id = id;
-    s.caster_id = caster_id;
-    s.position = pos;
-    s.direction = dir;
-    s.damage = damage;
-    s.speed = speed;
-    s.move_timer = 0.0f;
-    s.spell_type = spell_type;
-    s.affected_count = 0;
-    s.destroyed = 0;
-    
-    /* Инициализируем массив затронутых сущностей */
-    for (int i = 0; i < MAX_AFFECTED; i++) {
-        s.affected_ids[i] = -1;
-    }
-    
-    return s;
+/* Создание заклинания на месте */
+void spell_create(Spell *spell, int id, int caster_id, Vec2 pos, Direction dir, int damage, float speed,
+                  int spell_type) {
+    /* Обнуление целиком, а не по полям: байты выравнивания входят в снимок состояния */
+    memset(spell, 0, sizeof(*spell));
+    spell->id = id;
+    spell->caster_id = caster_id;
+    spell->position = pos;
+    spell->direction = dir;
+    spell->damage = damage;
+    spell->speed = speed;
+    spell->spell_type = spell_type;
 }
 
 /* Обновление заклинания (движение) */
@@ -43,21 +36,24 @@ void spell_update(Spell *spell, float delta_time) {
     }
 }
 
+/* Слово маски и бит для слота сущности */
+#define AFFECTED_WORD(entity_id) (ENTITY_ID_SLOT(entity_id) / SPELL_AFFECTED_WORD_BITS)
+#define AFFECTED_BIT(entity_id) \
+    ((SpellAffectedWord)1 << (ENTITY_ID_SLOT(entity_id) % SPELL_AFFECTED_WORD_BITS))
+
 /* Проверка, затронута ли сущность */
 int spell_has_affected(Spell *spell, int entity_id) {
-    for (int i = 0; i < spell->affected_count; i++) {
-        if (spell->affected_ids[i] == entity_id) {
-            return 1;
-        }
-    }
-    return 0;
+    return (spell->affected[AFFECTED_WORD(entity_id)] & AFFECTED_BIT(entity_id)) != 0;
 }
 
 /* Пометить сущность как затронутую */
 void spell_mark_affected(Spell *spell, int entity_id) {
-    if (spell->affected_count < MAX_AFFECTED && !spell_has_affected(spell, entity_id)) {
-        spell->affected_ids[spell->affected_count++] = entity_id;
-    }
+    spell->affected[AFFECTED_WORD(entity_id)] |= AFFECTED_BIT(entity_id);
+}
+
+/* Снять отметку со слота сущности */
+void spell_clear_affected(Spell *spell, int entity_id) {
+    spell->affected[AFFECTED_WORD(entity_id)] &= (SpellAffectedWord)~AFFECTED_BIT(entity_id);
 }
 
 /* Уничтожить заклинание */
@@ -6,17 +6,34 @@
 #ifndef SPELL_H
 #define SPELL_H
 
+#include <stdint.h>
 #include "vec2.h"
 #include "direction.h"
+#include "entity.h"
 
 /* Максимальное количество заклинаний на арене */
 #define MAX_SPELLS 64
-/* Максимальное количество затронутых сущностей одним заклинанием */
-#define MAX_AFFECTED 16
+
+/* Слово битовой маски затронутых сущностей (бит = слот сущности).
+ * Ширина слова подбирается под MAX_ENTITIES, для больших комнат маска многословная */
+#if MAX_ENTITIES <= 16
+typedef uint16_t SpellAffectedWord;
+#define SPELL_AFFECTED_WORD_BITS 16
+#elif MAX_ENTITIES <= 32
+typedef uint32_t SpellAffectedWord;
+#define SPELL_AFFECTED_WORD_BITS 32
+#else
+typedef uint64_t SpellAffectedWord;
+#define SPELL_AFFECTED_WORD_BITS 64
+#endif
+
+/* Количество слов маски затронутых сущностей */
+#define SPELL_AFFECTED_WORDS ((MAX_ENTITIES + SPELL_AFFECTED_WORD_BITS - 1) / SPELL_AFFECTED_WORD_BITS)
 
 /* Типы заклинаний (для Spell) */
 #define SPELL_TYPE_BASIC_VAL 1   /* Базовая атака */
 #define SPELL_TYPE_POWER_VAL 2   /* Усиленная атака */
+#define SPELL_TYPE_BLAST_VAL 3   /* Взрыв по области */
 
 /* Заклинание (проектил) */
 typedef struct {
@@ -27,14 +44,14 @@ typedef struct {
     int damage;                     /* Урон при попадании */
     float speed;                    /* Скорость движения */
     float move_timer;               /* Таймер для движения */
-    int spell_type;                 /* Тип заклинания (1=базовая, 2=усиленная) */
-    int affected_ids[MAX_AFFECTED]; /* ID затронутых сущностей */
-    int affected_count;             /* Количество затронутых */
+    int spell_type;                 /* Тип заклинания (1=базовая, 2=усиленная, 3=взрыв) */
+    int rewind;                     /* Откат позиций целей в тиках (компенсация лага) */
+    SpellAffectedWord affected[SPELL_AFFECTED_WORDS]; /* Маска затронутых слотов сущностей */
     int destroyed;                  /* Флаг уничтожения */
 } Spell;
 
-/* Создание заклинания */
-Spell spell_create(int id, int caster_id, Vec2 pos, Direction dir, int damage, float speed, int spell_type);
+/* Создание заклинания на месте (выравнивание тоже обнуляется: снимки сравниваются побайтно) */
+void spell_create(Spell *spell, int id, int caster_id, Vec2 pos, Direction dir, int damage, float speed, int spell_type);
 
 /* Обновление заклинания (движение) */
 void spell_update(Spell *spell, float delta_time);
@@ -45,6 +62,9 @@ int spell_has_affected(Spell *spell, int entity_id);
 /* Пометить сущность как затронутую */
 void spell_mark_affected(Spell *spell, int entity_id);
 
+/* Снять отметку со слота сущности (при освобождении слота) */
+void spell_clear_affected(Spell *spell, int entity_id);
+
 /* Уничтожить заклинание */
 void spell_destroy(Spell *spell);
 
@@ -0,0 +1,259 @@
+/*
+ * maps_main.c - Сборка библиотеки карт
+ * Карты из текстовых файлов и генератора упаковываются в один файл
+ * вместе с таблицами, сервер отображает его в память (--maps)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include "../core/maplib.h"
+#include "../core/mapgen.h"
+
+/* Максимальное количество карт в одной библиотеке */
+#define MAPS_MAX 256
+
+/* Длина строки текстовой карты с запасом на перевод строки */
+#define MAPS_LINE_SIZE (MAP_MAX_SIZE + 4)
+
+/* Карта, собираемая в библиотеку */
+typedef struct {
+    Region region;              /* Память карты */
+    Map map;                    /* Карта с построенными таблицами */
+    char name[MAP_LIBRARY_NAME_SIZE]; /* Имя в библиотеке */
+} MapsItem;
+
+/* Вывод справки */
+static void print_usage(const char *prog_name) {
+    printf("Использование: %s [опции] [карта.txt...]\n", prog_name);
+    printf("Опции:\n");
+    printf("  -o, --output FILE      Записать библиотеку из перечисленных карт\n");
+    printf("  -g, --generate S:SEED  Добавить сгенерированную карту размера S (имя gen-S-SEED)\n");
+    printf("  -l, --list FILE        Показать карты библиотеки\n");
+    printf("  --help                 Показать эту справку\n");
+    printf("Текстовая карта: квадрат из '#' (стена) и '.' (пол); цифры 1-9 на полу\n");
+    printf("задают точки спавна по порядку, без них точки выбираются автоматически\n");
+}
+
+/* Имя карты по пути файла: без каталога и расширения */
+static void name_from_path(const char *path, char *name) {
+    const char *base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+    size_t len = strcspn(base, ".");
+    if (len >= MAP_LIBRARY_NAME_SIZE) len = MAP_LIBRARY_NAME_SIZE - 1;
+    memcpy(name, base, len);
+    name[len] = '\0';
+}
+
+/* Чтение текстовой карты. Возвращает 0 или -1 с сообщением об ошибке */
+static int load_text_map(MapsItem *item, const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Ошибка: не удалось открыть %s\n", path);
+        return -1;
+    }
+    
+    /* Первая строка задаёт размер карты */
+    char line[MAPS_LINE_SIZE];
+    int size = 0;
+    if (fgets(line, sizeof(line), file)) {
+        size = (int)strcspn(line, "\r\n");
+    }
+    if (size < 3 || size > MAP_MAX_SIZE) {
+        fprintf(stderr, "Ошибка: %s - неверный размер карты %d\n", path, size);
+        fclose(file);
+        return -1;
+    }
+    if (region_init(&item->region, map_region_size(size)) < 0 || map_init(&item->map, size, &item->region) < 0) {
+        fprintf(stderr, "Ошибка: не хватает памяти на карту %s\n", path);
+        region_destroy(&item->region);
+        fclose(file);
+        return -1;
+    }
+    
+    Vec2 spawns[9];
+    int spawn_found[9] = {0};
+    int y = 0;
+    int ok = 1;
+    do {
+        if ((int)strcspn(line, "\r\n") != size) {
+            fprintf(stderr, "Ошибка: %s:%d - строка должна быть длиной %d\n", path, y + 1, size);
+            ok = 0;
+            break;
+        }
+        for (int x = 0; x < size; x++) {
+            char c = line[x];
+            Vec2 pos = vec2_create(x, y);
+            int written = 0;
+            if (c == '#') {
+                written = map_write_terrain(&item->map, pos, TERRAIN_WALL);
+            } else if (c == '.' || (c >= '1' && c <= '9')) {
+                written = map_write_terrain(&item->map, pos, TERRAIN_FLOOR);
+                if (c != '.') {
+                    spawns[c - '1'] = pos;
+                    spawn_found[c - '1'] = 1;
+                }
+            } else {
+                fprintf(stderr, "Ошибка: %s:%d - неизвестный символ '%c'\n", path, y + 1, c);
+                ok = 0;
+            }
+            if (written < 0) {
+                fprintf(stderr, "Ошибка: %s:%d - не удалось записать клетку %d\n", path, y + 1, x + 1);
+                ok = 0;
+            }
+        }
+        y++;
+    } while (ok && y < size && fgets(line, sizeof(line), file));
+    fclose(file);
+    
+    if (ok && y != size) {
+        fprintf(stderr, "Ошибка: %s - карта должна быть квадратной (%d строк)\n", path, size);
+        ok = 0;
+    }
+    if (!ok) {
+        region_destroy(&item->region);
+        return -1;
+    }
+    
+    /* Заданные точки спавна заменяют выбранные автоматически */
+    int spawn_count = 0;
+    while (spawn_count < 9 && spawn_found[spawn_count]) spawn_count++;
+    map_build_tables(&item->map, spawn_count > 0 ? spawns[0] : vec2_create(1, 1));
+    if (spawn_count > 0) {
+        memcpy(item->map.spawns, spawns, (size_t)spawn_count * sizeof(Vec2));
+        item->map.spawn_count = spawn_count;
+    }
+    name_from_path(path, item->name);
+    return 0;
+}
+
+/* Генерация карты по "размер:зерно". Возвращает 0 или -1 */
+static int load_generated_map(MapsItem *item, const char *spec) {
+    int size = 0;
+    unsigned long seed = 0;
+    if (sscanf(spec, "%d:%lu", &size, &seed) != 2 || size < 10 || size > MAP_MAX_SIZE) {
+        fprintf(stderr, "Ошибка: ожидается РАЗМЕР:ЗЕРНО (размер 10-%d), получено %s\n", MAP_MAX_SIZE, spec);
+        return -1;
+    }
+    
+    Vec2 first_spawn;
+    if (region_init(&item->region, map_region_size(size)) < 0) return -1;
+    if (mapgen_generate_random(&item->map, size, (uint32_t)seed, &item->region, &first_spawn) < 0 ||
+        map_build_tables(&item->map, first_spawn) < 0) {
+        region_destroy(&item->region);
+        return -1;
+    }
+    snprintf(item->name, sizeof(item->name), "gen-%d-%lu", size, seed);
+    return 0;
+}
+
+/* Вывод содержимого библиотеки */
+static int list_library(const char *path) {
+    MapLibrary library;
+    if (map_library_open(&library, path) < 0) {
+        fprintf(stderr, "Ошибка: %s - не библиотека карт или файл повреждён\n", path);
+        return 1;
+    }
+    
+    int count = map_library_count(&library);
+    printf("%s: карт %d\n", path, count);
+    for (int i = 0; i < count; i++) {
+        Map map;
+        map_library_load(&library, i, &map);
+        printf("  %-24s %4dx%-4d спавнов %2d, хэш %016llx\n", map_library_name(&library, i),
+               map.size, map.size, map.spawn_count,
+               (unsigned long long)library.entries[i].terrain_hash);
+    }
+    map_library_close(&library);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *output = NULL;
+    static MapsItem items[MAPS_MAX];
+    int count = 0;
+    int failed = 0;
+    
+    /* Опции командной строки */
+    static struct option long_options[] = {
+        {"output", required_argument, 0, 'o'},
+        {"generate", required_argument, 0, 'g'},
+        {"list", required_argument, 0, 'l'},
+        {"help", no_argument, 0, 0},
+        {0, 0, 0, 0}
+    };
+    
+    int opt;
+    int option_index = 0;
+    
+    while ((opt = getopt_long(argc, argv, "o:g:l:", long_options, &option_index)) != -1) {
+        switch (opt) {
+            case 'o':
+                output = optarg;
+                break;
+            case 'g':
+                if (count >= MAPS_MAX) {
+                    fprintf(stderr, "Ошибка: больше %d карт\n", MAPS_MAX);
+                    return 1;
+                }
+                if (load_generated_map(&items[count], optarg) < 0) failed = 1;
+                else count++;
+                break;
+            case 'l':
+                return list_library(optarg);
+            case 0:
+                if (strcmp(long_options[option_index].name, "help") == 0) {
+                    print_usage(argv[0]);
+                    return 0;
+                }
+                break;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    
+    for (int i = optind; i < argc; i++) {
+        if (count >= MAPS_MAX) {
+            fprintf(stderr, "Ошибка: больше %d карт\n", MAPS_MAX);
+            return 1;
+        }
+        if (load_text_map(&items[count], argv[i]) < 0) failed = 1;
+        else count++;
+    }
+    
+    if (!output || count == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    
+    /* Имена - ключи поиска, повторяться они не могут */
+    const Map *maps[MAPS_MAX];
+    const char *names[MAPS_MAX];
+    for (int i = 0; i < count; i++) {
+        for (int j = 0; j < i; j++) {
+            if (strcmp(items[i].name, items[j].name) == 0) {
+                fprintf(stderr, "Ошибка: имя карты %s встречается дважды\n", items[i].name);
+                failed = 1;
+            }
+        }
+        maps[i] = &items[i].map;
+        names[i] = items[i].name;
+    }
+    
+    int result = 1;
+    if (!failed) {
+        if (map_library_write(output, maps, names, count) == 0) {
+            printf("%s: записано карт %d\n", output, count);
+            result = 0;
+        } else {
+            fprintf(stderr, "Ошибка записи %s\n", output);
+        }
+    }
+    
+    for (int i = 0; i < count; i++) {
+        region_destroy(&items[i].region);
+    }
+    return result;
+}
@@ -5,9 +5,6 @@
 #include "encoder.h"
 #include <string.h>
 
-/* Версия протокола */
-#define PROTOCOL_VERSION "1.0.0"
-
 /* === Вспомогательные функции === */
 
 /* Запись заголовка пакета */
@@ -60,10 +57,12 @@ int encode_move_player(uint8_t *buffer, Direction dir) {
     return offset;
 }
 
-int encode_cast_skill(uint8_t *buffer, Direction dir, uint8_t spell_type) {
-    int offset = write_header(buffer, CLIENT_MSG_CAST_SKILL, 2);
+int encode_cast_skill(uint8_t *buffer, Direction dir, uint8_t spell_type, uint32_t seen_tick) {
+    int offset = write_header(buffer, CLIENT_MSG_CAST_SKILL, 6);
     buffer[offset++] = (uint8_t)dir;
     buffer[offset++] = spell_type;
+    memcpy(buffer + offset, &seen_tick, 4);
+    offset += 4;
     return offset;
 }
 
@@ -137,7 +136,7 @@ int encode_wait_arena(uint8_t *buffer, int seconds) {
 }
 
 int encode_start_arena(uint8_t *buffer, Arena *arena, Game *game) {
-    /* Формат: arena_number(2) + player_count(1) + map_size(2) + entity_ids... + map_data... */
+    /* Формат: arena_number(2) + player_count(1) + map_size(2) + entity_ids... */
     int offset = PACKET_HEADER_SIZE;
     
     uint16_t arena_num = (uint16_t)game->arena_number;
@@ -145,7 +144,7 @@ int encode_start_arena(uint8_t *buffer, Arena *arena, Game *game) {
     
     buffer[offset++] = (uint8_t)game->player_count;
     
-    uint16_t map_size = (uint16_t)arena->map.size;
+    uint16_t map_size = (uint16_t)arena->map->size;
     memcpy(buffer + offset, &map_size, 2); offset += 2;
     
     /* Entity IDs для каждого игрока */
@@ -154,48 +153,89 @@ int encode_start_arena(uint8_t *buffer, Arena *arena, Game *game) {
         memcpy(buffer + offset, &eid, 4); offset += 4;
     }
     
-    /* Данные карты */
-    int map_data_size = arena->map.size * arena->map.size;
-    for (int i = 0; i < map_data_size; i++) {
-        buffer[offset++] = (uint8_t)arena->map.ground[i];
-    }
-    
     /* Записываем заголовок */
     write_header(buffer, SERVER_MSG_START_ARENA, (uint16_t)(offset - PACKET_HEADER_SIZE));
     return offset;
 }
 
+int encode_map_chunk_bytes(const Map *map, int chunk_index) {
+    const MapChunk *chunk = map_get_chunk(map, chunk_index);
+    return (chunk && map_chunk_cells(map, chunk)) ? 3 + MAP_CHUNK_CELLS / 8 : 3;
+}
+
+int encode_map_chunks(uint8_t *buffer, const Map *map, const int *chunk_indices, int count) {
+    /* Формат: count(2) + чанки... */
+    int offset = PACKET_HEADER_SIZE;
+    
+    uint16_t chunk_count = (uint16_t)count;
+    memcpy(buffer + offset, &chunk_count, 2); offset += 2;
+    
+    for (int i = 0; i < count; i++) {
+        const MapChunk *chunk = map_get_chunk(map, chunk_indices[i]);
+        uint16_t index = (uint16_t)chunk_indices[i];
+        memcpy(buffer + offset, &index, 2); offset += 2;
+        
+        const uint8_t *cells = map_chunk_cells(map, chunk);
+        if (!cells) {
+            buffer[offset++] = chunk->fill;
+            continue;
+        }
+        
+        /* Неоднородный чанк: по биту на клетку, 1 - стена */
+        buffer[offset++] = MAP_CHUNK_PACKED;
+        memset(buffer + offset, 0, MAP_CHUNK_CELLS / 8);
+        for (int c = 0; c < MAP_CHUNK_CELLS; c++) {
+            if (cells[c] == TERRAIN_WALL) {
+                buffer[offset + c / 8] |= (uint8_t)(1 << (c % 8));
+            }
+        }
+        offset += MAP_CHUNK_CELLS / 8;
+    }
+    
+    write_header(buffer, SERVER_MSG_MAP_CHUNKS, (uint16_t)(offset - PACKET_HEADER_SIZE));
+    return offset;
+}
+
 int encode_game_step(uint8_t *buffer, Arena *arena, Game *game) {
     int offset = PACKET_HEADER_SIZE;
     
+    /* Номер кадра: клиент возвращает его с заклинаниями для компенсации лага */
+    memcpy(buffer + offset, &arena->state.tick, 4);
+    offset += 4;
+    
     /* Количество сущностей и заклинаний */
-    uint8_t entity_count = (uint8_t)arena->entity_count;
-    uint8_t spell_count = (uint8_t)arena->spell_count;
+    int entity_count_offset = offset;
+    uint8_t entity_count = 0;
+    uint8_t spell_count = (uint8_t)arena->state.spell_count;
     uint8_t player_count = (uint8_t)game->player_count;
     
     buffer[offset++] = entity_count;
     buffer[offset++] = spell_count;
     buffer[offset++] = player_count;
     
-    /* Данные сущностей */
-    for (int i = 0; i < arena->entity_count; i++) {
-        Entity *e = &arena->entities[i];
+    /* Данные сущностей (свободные слоты пропускаем) */
+    for (int i = 0; i < arena->state.entity_count; i++) {
+        if (!arena_entity_slot_used(arena, i)) continue;
+        Entity *e = &arena->state.entities[i];
+        EntityCold *cold = &arena->state.entity_cold[i];
         EntityData data;
         data.id = e->id;
-        data.symbol = e->symbol;
+        data.symbol = cold->symbol;
         data.pos_x = (int16_t)e->position.x;
         data.pos_y = (int16_t)e->position.y;
-        data.health = (uint8_t)e->health;
-        data.energy = (uint8_t)e->energy;
-        data.direction = (uint8_t)e->direction;
-        data.spell_type = (uint8_t)e->spell_type;
+        data.health = (uint8_t)cold->health;
+        data.energy = (uint8_t)cold->energy;
+        data.direction = (uint8_t)cold->direction;
+        data.spell_type = (uint8_t)cold->spell_type;
         memcpy(buffer + offset, &data, ENTITY_DATA_SIZE);
         offset += ENTITY_DATA_SIZE;
+        entity_count++;
     }
+    buffer[entity_count_offset] = entity_count;
     
     /* Данные заклинаний */
-    for (int i = 0; i < arena->spell_count; i++) {
-        Spell *s = &arena->spells[i];
+    for (int i = 0; i < arena->state.spell_count; i++) {
+        Spell *s = arena_get_spell(arena, i);
         SpellData data;
         data.id = s->id;
         data.pos_x = (int16_t)s->position.x;
@@ -216,6 +256,23 @@ int encode_game_step(uint8_t *buffer, Arena *arena, Game *game) {
         offset += PLAYER_DATA_SIZE;
     }
     
+    /* Взрывы этого кадра из журнала событий арены */
+    int explosion_count_offset = offset;
+    uint8_t explosion_count = 0;
+    buffer[offset++] = 0;
+    for (int e = 0; e < arena->event_count && explosion_count < MAX_STEP_EXPLOSIONS; e++) {
+        const ArenaEvent *event = &arena->events[e];
+        if (event->type != ARENA_EVENT_SPELL_EXPLODED) continue;
+        ExplosionData data;
+        data.pos_x = (int16_t)event->position.x;
+        data.pos_y = (int16_t)event->position.y;
+        data.radius = (uint8_t)event->value;
+        memcpy(buffer + offset, &data, EXPLOSION_DATA_SIZE);
+        offset += EXPLOSION_DATA_SIZE;
+        explosion_count++;
+    }
+    buffer[explosion_count_offset] = explosion_count;
+    
     /* Записываем заголовок */
     write_header(buffer, SERVER_MSG_GAME_STEP, (uint16_t)(offset - PACKET_HEADER_SIZE));
     return offset;
@@ -260,10 +317,13 @@ int decode_move_player(const uint8_t *buffer, Direction *dir) {
     return 1;
 }
 
-int decode_cast_skill(const uint8_t *buffer, Direction *dir, uint8_t *spell_type) {
+int decode_cast_skill(const uint8_t *buffer, size_t len, Direction *dir, uint8_t *spell_type, uint32_t *seen_tick) {
     *dir = (Direction)buffer[0];
     *spell_type = buffer[1];
-    return 2;
+    *seen_tick = 0;
+    if (len < 6) return 2;
+    memcpy(seen_tick, buffer + 2, 4);
+    return 6;
 }
 
 int decode_login_status(const uint8_t *buffer, char *symbol, LoginStatus *status, int32_t *token) {
@@ -286,9 +346,66 @@ int decode_static_info(const uint8_t *buffer, int *udp_port, int *map_size, int
     return 8;
 }
 
-int decode_game_step(const uint8_t *buffer, size_t len, EntityData *entities, int *entity_count,
-                     SpellData *spells, int *spell_count, PlayerData *players, int *player_count) {
+int decode_start_arena(const uint8_t *buffer, size_t len, int *arena_number, int *map_size) {
+    if (len < 5) return 0;
+    
+    uint16_t arena_num, size;
+    memcpy(&arena_num, buffer, 2);
+    int player_count = buffer[2];
+    memcpy(&size, buffer + 3, 2);
+    *arena_number = arena_num;
+    *map_size = size;
+    
+    /* Entity IDs игроков клиенту не нужны */
+    return 5 + player_count * 4;
+}
+
+int decode_map_chunks(const uint8_t *buffer, size_t len, uint8_t *terrain, int map_size) {
+    if (len < 2) return 0;
+    
+    uint16_t count;
+    memcpy(&count, buffer, 2);
+    size_t offset = 2;
+    int chunks_per_side = (map_size + MAP_CHUNK_SIZE - 1) / MAP_CHUNK_SIZE;
+    
+    int decoded = 0;
+    for (int i = 0; i < count && offset + 3 <= len; i++) {
+        uint16_t index;
+        memcpy(&index, buffer + offset, 2);
+        uint8_t kind = buffer[offset + 2];
+        offset += 3;
+        
+        const uint8_t *bits = NULL;
+        if (kind == MAP_CHUNK_PACKED) {
+            if (offset + MAP_CHUNK_CELLS / 8 > len) break;
+            bits = buffer + offset;
+            offset += MAP_CHUNK_CELLS / 8;
+        }
+        if (index >= chunks_per_side * chunks_per_side) continue;
+        
+        /* Клетки за краем карты в крайних чанках пропускаются */
+        int base_x = (index % chunks_per_side) * MAP_CHUNK_SIZE;
+        int base_y = (index / chunks_per_side) * MAP_CHUNK_SIZE;
+        for (int c = 0; c < MAP_CHUNK_CELLS; c++) {
+            int x = base_x + c % MAP_CHUNK_SIZE;
+            int y = base_y + c / MAP_CHUNK_SIZE;
+            if (x >= map_size || y >= map_size) continue;
+            terrain[y * map_size + x] = bits ? ((bits[c / 8] >> (c % 8)) & 1) : kind;
+        }
+        decoded++;
+    }
+    return decoded;
+}
+
+int decode_game_step(const uint8_t *buffer, size_t len, uint32_t *tick, EntityData *entities, int *entity_count,
+                     SpellData *spells, int *spell_count, PlayerData *players, int *player_count,
+                     ExplosionData *explosions, int *explosion_count) {
     int offset = 0;
+    *entity_count = *spell_count = *player_count = *explosion_count = 0;
+    if (len < 7) return 0;
+    
+    memcpy(tick, buffer + offset, 4);
+    offset += 4;
     
     *entity_count = buffer[offset++];
     *spell_count = buffer[offset++];
@@ -312,6 +429,17 @@ int decode_game_step(const uint8_t *buffer, size_t len, EntityData *entities, in
         offset += PLAYER_DATA_SIZE;
     }
     
+    /* Хвост со взрывами (у старого сервера его нет) */
+    if ((size_t)offset < len) {
+        int count = buffer[offset++];
+        if (count > MAX_STEP_EXPLOSIONS) count = MAX_STEP_EXPLOSIONS;
+        for (int i = 0; i < count && (size_t)offset + EXPLOSION_DATA_SIZE <= len; i++) {
+            memcpy(&explosions[i], buffer + offset, EXPLOSION_DATA_SIZE);
+            offset += EXPLOSION_DATA_SIZE;
+            (*explosion_count)++;
+        }
+    }
+    
     return offset;
 }
 
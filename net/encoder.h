@@ -35,8 +35,9 @@ int encode_trust_udp(uint8_t *buffer);
 /* Кодирование движения игрока */
 int encode_move_player(uint8_t *buffer, Direction dir);
 
-/* Кодирование применения способности (spell_type: 1 = базовая, 2 = усиленная) */
-int encode_cast_skill(uint8_t *buffer, Direction dir, uint8_t spell_type);
+/* Кодирование применения способности (spell_type: 1 = базовая, 2 = усиленная, 3 = взрыв).
+ * seen_tick - номер последнего полученного кадра (0 - кадров не было) */
+int encode_cast_skill(uint8_t *buffer, Direction dir, uint8_t spell_type, uint32_t seen_tick);
 
 /* === Функции кодирования (сервер → клиент) === */
 
@@ -64,10 +65,16 @@ int encode_finish_game(uint8_t *buffer, char winner);
 /* Кодирование ожидания арены */
 int encode_wait_arena(uint8_t *buffer, int seconds);
 
-/* Кодирование начала арены */
+/* Кодирование начала арены (террейн передаётся отдельно чанками) */
 int encode_start_arena(uint8_t *buffer, Arena *arena, Game *game);
 
-/* Кодирование кадра состояния */
+/* Размер записи чанка карты в пакете MAP_CHUNKS */
+int encode_map_chunk_bytes(const Map *map, int chunk_index);
+
+/* Кодирование порции чанков карты */
+int encode_map_chunks(uint8_t *buffer, const Map *map, const int *chunk_indices, int count);
+
+/* Кодирование кадра состояния (со взрывами этого тика из журнала событий арены) */
 int encode_game_step(uint8_t *buffer, Arena *arena, Game *game);
 
 /* Кодирование игрового события */
@@ -90,8 +97,9 @@ int decode_connect_udp(const uint8_t *buffer, int32_t *token);
 /* Декодирование движения игрока */
 int decode_move_player(const uint8_t *buffer, Direction *dir);
 
-/* Декодирование применения способности (spell_type: 1 = базовая, 2 = усиленная) */
-int decode_cast_skill(const uint8_t *buffer, Direction *dir, uint8_t *spell_type);
+/* Декодирование применения способности (spell_type: 1 = базовая, 2 = усиленная, 3 = взрыв).
+ * В коротком пакете без номера кадра seen_tick = 0 */
+int decode_cast_skill(const uint8_t *buffer, size_t len, Direction *dir, uint8_t *spell_type, uint32_t *seen_tick);
 
 /* Декодирование статуса входа */
 int decode_login_status(const uint8_t *buffer, char *symbol, LoginStatus *status, int32_t *token);
@@ -99,9 +107,16 @@ int decode_login_status(const uint8_t *buffer, char *symbol, LoginStatus *status
 /* Декодирование статической информации */
 int decode_static_info(const uint8_t *buffer, int *udp_port, int *map_size, int *winner_points, int *max_players);
 
-/* Декодирование кадра состояния */
-int decode_game_step(const uint8_t *buffer, size_t len, EntityData *entities, int *entity_count,
-                     SpellData *spells, int *spell_count, PlayerData *players, int *player_count);
+/* Декодирование начала арены */
+int decode_start_arena(const uint8_t *buffer, size_t len, int *arena_number, int *map_size);
+
+/* Декодирование порции чанков в террейн map_size * map_size клеток, возвращает число чанков */
+int decode_map_chunks(const uint8_t *buffer, size_t len, uint8_t *terrain, int map_size);
+
+/* Декодирование кадра состояния. explosions - буфер [MAX_STEP_EXPLOSIONS] */
+int decode_game_step(const uint8_t *buffer, size_t len, uint32_t *tick, EntityData *entities, int *entity_count,
+                     SpellData *spells, int *spell_count, PlayerData *players, int *player_count,
+                     ExplosionData *explosions, int *explosion_count);
 
 #endif /* ENCODER_H */
 
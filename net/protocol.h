@@ -10,6 +10,10 @@
 #include "../core/direction.h"
 #include "../core/vec2.h"
 
+/* Версия протокола. Старшая часть меняется вместе с форматом сообщений:
+ * клиент с другой старшей версией сервером не принимается */
+#define PROTOCOL_VERSION "2.0.0"
+
 /* Типы сообщений от клиента к серверу */
 typedef enum {
     CLIENT_MSG_VERSION = 0,         /* Проверка версии */
@@ -34,7 +38,8 @@ typedef enum {
     SERVER_MSG_WAIT_ARENA = 7,      /* Ожидание арены */
     SERVER_MSG_START_ARENA = 8,     /* Начало арены */
     SERVER_MSG_GAME_STEP = 9,       /* Кадр состояния */
-    SERVER_MSG_GAME_EVENT = 10      /* Игровое событие */
+    SERVER_MSG_GAME_EVENT = 10,     /* Игровое событие */
+    SERVER_MSG_MAP_CHUNKS = 11      /* Порция чанков карты */
 } ServerMessageType;
 
 /* Статус входа */
@@ -60,7 +65,7 @@ typedef struct __attribute__((packed)) {
     uint8_t health;         /* Здоровье (0-100) */
     uint8_t energy;         /* Энергия (0-100) */
     uint8_t direction;      /* Направление */
-    uint8_t spell_type;     /* Тип заклинания (1 = базовая, 2 = усиленная) */
+    uint8_t spell_type;     /* Тип заклинания (1 = базовая, 2 = усиленная, 3 = взрыв) */
 } EntityData;
 
 /* Данные заклинания для сериализации */
@@ -69,7 +74,7 @@ typedef struct __attribute__((packed)) {
     int16_t pos_x;          /* Позиция X */
     int16_t pos_y;          /* Позиция Y */
     uint8_t direction;      /* Направление */
-    uint8_t spell_type;     /* Тип заклинания (1 = базовая, 2 = усиленная) */
+    uint8_t spell_type;     /* Тип заклинания (1 = базовая, 2 = усиленная, 3 = взрыв) */
 } SpellData;
 
 /* Данные игрока для сериализации */
@@ -78,11 +83,27 @@ typedef struct __attribute__((packed)) {
     uint16_t points;        /* Очки */
 } PlayerData;
 
+/* Взрыв за кадр. Хвост GAME_STEP после игроков: количество(1) + ExplosionData[количество];
+ * старый клиент хвост не читает */
+typedef struct __attribute__((packed)) {
+    int16_t pos_x;          /* Центр X */
+    int16_t pos_y;          /* Центр Y */
+    uint8_t radius;         /* Радиус в клетках */
+} ExplosionData;
+
+/* Формат чанка в MAP_CHUNKS: индекс(2) + вид(1) [+ битовая маска стен].
+ * Вид - террейн однородного чанка либо MAP_CHUNK_PACKED */
+#define MAP_CHUNK_PACKED 0xFF
+
 /* Размеры пакетов */
 #define PACKET_HEADER_SIZE sizeof(PacketHeader)
 #define ENTITY_DATA_SIZE sizeof(EntityData)
 #define SPELL_DATA_SIZE sizeof(SpellData)
 #define PLAYER_DATA_SIZE sizeof(PlayerData)
+#define EXPLOSION_DATA_SIZE sizeof(ExplosionData)
+
+/* Сколько взрывов одного кадра передаётся (остальные не рисуются) */
+#define MAX_STEP_EXPLOSIONS 16
 
 /* Максимальный размер пакета */
 #define MAX_PACKET_SIZE 4096
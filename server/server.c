@@ -5,6 +5,7 @@
 #include "server.h"
 #include "../net/encoder.h"
 #include "../net/protocol.h"
+#include "../common/log.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -13,11 +14,20 @@
 #include <errno.h>
 
 #define FRAME_TIME_MS 16    /* ~60 FPS */
-#define PROTOCOL_VERSION "1.0.0"
+#define TICKS_PER_SECOND (1000 / FRAME_TIME_MS)
+#define MAP_STREAM_BYTES_PER_TICK 1024  /* Бюджет чанков карты на клиента за тик */
 
 /* Прототипы внутренних функций */
 static void process_session_tcp_buffer(Server *server, Session **session);
 static void handle_single_packet(Server *server, Session **session, uint8_t *buffer, int len);
+static void on_arena_countdown(Timer *timer, void *user);
+static void server_start_prepare(Server *server);
+static void server_finish_prepare(Server *server);
+static void on_login_timeout(Timer *timer, void *user);
+static void on_idle_timeout(Timer *timer, void *user);
+static void server_bot_input(Game *game, int player_index, void *user);
+static void on_drop_log(Timer *timer, void *user);
+static void server_close_session(Server *server, Session *session);
 
 /* Получение времени в миллисекундах */
 static long get_time_ms(void) {
@@ -26,8 +36,14 @@ static long get_time_ms(void) {
     return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
 }
 
+/* Время сервера по номеру кадра, мс (для лимитов: без системного вызова на сообщение) */
+static int64_t server_now_ms(Server *server) {
+    return (int64_t)server->timers.next_tick * FRAME_TIME_MS;
+}
+
 /* Создание сервера */
-Server* server_create(int tcp_port, int udp_port, int max_players, int map_size, int winner_points) {
+Server* server_create(int tcp_port, int udp_port, int max_players, int map_size, int winner_points,
+                      int bot_count) {
     Server *server = (Server *)malloc(sizeof(Server));
     if (!server) return NULL;
     
@@ -39,7 +55,7 @@ Server* server_create(int tcp_port, int udp_port, int max_players, int map_size,
     server->tcp_listener = socket_tcp_create();
     int actual_tcp_port = tcp_port;
     if (socket_bind_with_fallback(&server->tcp_listener, &actual_tcp_port, 10) < 0) {
-        fprintf(stderr, "Ошибка: не удалось привязать TCP порт (пробовали %d-%d)\n", 
+        LOG_ERROR("Не удалось привязать TCP порт (пробовали %d-%d)",
                 tcp_port, tcp_port + 9);
         free(server);
         return NULL;
@@ -47,7 +63,7 @@ Server* server_create(int tcp_port, int udp_port, int max_players, int map_size,
     server->tcp_port = actual_tcp_port;
     
     if (socket_listen(&server->tcp_listener, 10) < 0) {
-        fprintf(stderr, "Ошибка: не удалось начать прослушивание\n");
+        LOG_ERROR("Не удалось начать прослушивание");
         socket_close(&server->tcp_listener);
         free(server);
         return NULL;
@@ -58,7 +74,7 @@ Server* server_create(int tcp_port, int udp_port, int max_players, int map_size,
     server->udp_socket = socket_udp_create();
     int actual_udp_port = udp_port;
     if (socket_bind_with_fallback(&server->udp_socket, &actual_udp_port, 10) < 0) {
-        fprintf(stderr, "Ошибка: не удалось привязать UDP порт (пробовали %d-%d)\n",
+        LOG_ERROR("Не удалось привязать UDP порт (пробовали %d-%d)",
                 udp_port, udp_port + 9);
         socket_close(&server->tcp_listener);
         free(server);
@@ -67,12 +83,58 @@ Server* server_create(int tcp_port, int udp_port, int max_players, int map_size,
     server->udp_port = actual_udp_port;
     socket_set_nonblocking(&server->udp_socket);
     
-    /* Создаём комнату и игру */
-    server->room = room_session_create(max_players);
+    /* Создаём комнату и игру: места ботов недоступны для входа */
+    server->room = room_session_create(max_players - bot_count);
     server->game = game_create(map_size, winner_points, max_players);
+    if (!server->game) {
+        LOG_ERROR("Не удалось выделить память игры (карта %d)", map_size);
+        socket_close(&server->udp_socket);
+        socket_close(&server->tcp_listener);
+        free(server);
+        return NULL;
+    }
+    server->game->hold_between_arenas = 1;  /* Между аренами сервер ведёт отсчёт */
+    
+    /* Таймеры встроены в сервер и сессии, поэтому инициализируются после размещения */
+    timer_wheel_init(&server->timers);
+    timer_init(&server->arena_timer, on_arena_countdown, server);
+    server->arena_countdown = 0;
+    server->preparing = 0;
+    server->idle_kick_ticks = 0;
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        Session *s = &server->room.sessions[i];
+        s->owner = server;
+        timer_init(&s->login_timer, on_login_timeout, s);
+        timer_init(&s->idle_timer, on_idle_timeout, s);
+    }
+    
+    for (int i = 0; i < SERVER_UDP_SOURCE_SLOTS; i++) {
+        server->udp_sources[i] = token_bucket_create(SERVER_UDP_RATE, SERVER_UDP_BURST, 0);
+    }
+    memset(&server->drops, 0, sizeof(server->drops));
+    server->drops_logged = server->drops;
+    timer_init(&server->drop_log_timer, on_drop_log, server);
+    timer_schedule(&server->timers, &server->drop_log_timer, (uint64_t)SERVER_DROP_LOG_SECONDS * TICKS_PER_SECOND);
     
-    printf("Сервер запущен на TCP:%d UDP:%d\n", server->tcp_port, server->udp_port);
-    printf("Ожидание %d игроков...\n", max_players);
+    /* Боты берут символы с конца алфавита */
+    server->bot_count = 0;
+    for (int i = 0; i < bot_count; i++) {
+        char symbol = (char)('Z' - i);
+        if (game_add_player(server->game, symbol) >= 0) {
+            server->bot_symbols[server->bot_count++] = symbol;
+        }
+    }
+    server->bot_nav = bot_nav_create();
+    game_set_input_source(server->game, server_bot_input, server);
+    server->next_seed = (uint64_t)time(NULL);
+    server->bot_rng = rng_create(server->next_seed ^ BOT_SEED_SALT);
+    server_set_max_rewind(server, SERVER_DEFAULT_REWIND_MS);
+    
+    LOG_INFO("Сервер запущен на TCP:%d UDP:%d", server->tcp_port, server->udp_port);
+    if (server->bot_count > 0) {
+        LOG_INFO("Ботов: %d", server->bot_count);
+    }
+    LOG_INFO("Ожидание %d игроков...", max_players - server->bot_count);
     
     return server;
 }
@@ -92,6 +154,9 @@ void server_run(Server *server) {
         }
         last_frame = now;
         
+        /* Отложенные события этого тика */
+        timer_wheel_tick(&server->timers);
+        
         /* Проверяем новые подключения */
         server_handle_connection(server);
         
@@ -109,68 +174,47 @@ void server_run(Server *server) {
                                        available_space);
                     if (n > 0) {
                         s->tcp_buffer_len += (size_t)n;
+                        if (s->active && server->idle_kick_ticks > 0) {
+                            timer_schedule(&server->timers, &s->idle_timer, (uint64_t)server->idle_kick_ticks);
+                        }
                         /* Обрабатываем все полные пакеты в буфере */
                         /* Передаем указатель на указатель, чтобы можно было изменить сессию */
                         process_session_tcp_buffer(server, &s);
                         /* После обработки s может указывать на другую сессию (например, после LOGIN) */
                     } else if (n == 0) {
                         /* Клиент отключился */
-                        if (s->active) {
-                            printf("Игрок %c отключился\n", s->symbol);
-                            game_remove_player(server->game, game_get_player_index(server->game, s->symbol));
-                            room_session_remove(&server->room, s->token);
-                            
-                            /* Отправляем обновлённый список игроков */
-                            char symbols[MAX_PLAYERS];
-                            int count = room_session_get_symbols(&server->room, symbols);
-                            uint8_t buf[64];
-                            int len = encode_dynamic_info(buf, symbols, count);
-                            server_broadcast(server, buf, len);
-                        } else {
-                            /* Неавторизованный клиент отключился */
-                            socket_close(&s->tcp_socket);
-                            s->tcp_buffer_len = 0;
-                        }
+                        if (s->active) LOG_INFO("Игрок %c отключился", s->symbol);
+                        server_close_session(server, s);
                     } else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
                         /* Ошибка чтения */
-                        if (s->active) {
-                            printf("Ошибка чтения от игрока %c\n", s->symbol);
-                            game_remove_player(server->game, game_get_player_index(server->game, s->symbol));
-                            room_session_remove(&server->room, s->token);
-                            
-                            char symbols[MAX_PLAYERS];
-                            int count = room_session_get_symbols(&server->room, symbols);
-                            uint8_t buf[64];
-                            int len = encode_dynamic_info(buf, symbols, count);
-                            server_broadcast(server, buf, len);
-                        } else {
-                            socket_close(&s->tcp_socket);
-                            s->tcp_buffer_len = 0;
-                        }
+                        if (s->active) LOG_WARN("Ошибка чтения от игрока %c", s->symbol);
+                        server_close_session(server, s);
                     }
                 }
             }
         }
         
-        /* Обрабатываем UDP сообщения */
-        if (socket_has_data(&server->udp_socket, 0)) {
+        /* Обрабатываем UDP сообщения: не больше бюджета кадра, чтобы поток датаграмм не съел тик */
+        for (int k = 0; k < SERVER_UDP_DATAGRAMS_PER_TICK; k++) {
             uint8_t buffer[MAX_PACKET_SIZE];
             struct sockaddr_in src;
             int n = socket_recvfrom(&server->udp_socket, buffer, sizeof(buffer), &src);
-            if (n > 0) {
-                server_handle_udp(server, buffer, n, &src);
-            }
+            if (n < 0) break;
+            
+            /* Пустая датаграмма - тоже датаграмма: отбрасывается разбором, чтение продолжается */
+            server_handle_udp(server, buffer, n, &src);
         }
         
         /* Обновляем игру */
         if (server->game->state == GAME_STATE_PLAYING) {
             game_step(server->game, FRAME_TIME_MS / 1000.0f);
             server_broadcast_game_step(server);
+            server_stream_map(server);
             
             /* Проверяем окончание игры */
             if (server->game->state == GAME_STATE_FINISHED) {
                 char winner = game_get_winner(server->game);
-                printf("Игра окончена! Победитель: %c\n", winner);
+                LOG_INFO("Игра окончена! Победитель: %c", winner);
                 
                 uint8_t buf[64];
                 int len = encode_finish_game(buf, winner);
@@ -183,22 +227,161 @@ void server_run(Server *server) {
         
         /* Проверяем, готова ли игра к началу */
         if (server->game->state == GAME_STATE_WAITING && game_is_ready(server->game)) {
-            printf("Все игроки подключены, начинаем игру!\n");
+            LOG_INFO("Все игроки подключены, начинаем игру!");
             
             uint8_t buf[64];
             int len = encode_start_game(buf, server->game->winner_points);
             server_broadcast(server, buf, len);
             
-            game_start(server->game);
+            /* Вся случайность матча - от его зерна: по логу матч можно воспроизвести */
+            uint64_t seed = server->next_seed++;
+            server_finish_prepare(server);
+            game_set_seed(server->game, seed);
+            server->bot_rng = rng_create(seed ^ BOT_SEED_SALT);
+            LOG_INFO("Зерно матча: %llu", (unsigned long long)seed);
             
-            /* Отправляем информацию об арене */
-            uint8_t arena_buf[MAX_PACKET_SIZE];
-            len = encode_start_arena(arena_buf, server->game->arena, server->game);
-            server_broadcast(server, arena_buf, len);
+            game_start(server->game);
+            if (server->game->arena) server_broadcast_start_arena(server);
+        }
+        
+        /* Арена окончена (или не создалась): отсчёт до следующей, карта тем временем
+         * готовится в фоновом потоке */
+        if (server->game->state == GAME_STATE_ARENA_OVER && !timer_is_pending(&server->arena_timer)) {
+            server->arena_countdown = SERVER_ARENA_COUNTDOWN_SECONDS;
+            timer_schedule(&server->timers, &server->arena_timer, 0);
+            server_start_prepare(server);
         }
     }
 }
 
+/* Рассылка начала арены; карта досылается чанками заново */
+void server_broadcast_start_arena(Server *server) {
+    uint8_t arena_buf[MAX_PACKET_SIZE];
+    int len = encode_start_arena(arena_buf, server->game->arena, server->game);
+    server_broadcast(server, arena_buf, len);
+    room_session_reset_chunks(&server->room);
+    LOG_DEBUG("Арена %d", server->game->arena_number);
+}
+
+/* Поток подготовки следующей арены */
+static void* server_prepare_thread(void *arg) {
+    Server *server = (Server *)arg;
+    game_prepare_arena(server->game);
+    return NULL;
+}
+
+/* Запуск подготовки следующей арены: генерация большой карты идёт вне игрового цикла.
+ * Пока поток работает, цикл не трогает генератор матча и подготовленную карту */
+static void server_start_prepare(Server *server) {
+    if (server->preparing) return;
+    if (pthread_create(&server->prepare_thread, NULL, server_prepare_thread, server) != 0) {
+        /* Без потока карта будет получена в game_next_arena */
+        LOG_WARN("Не удалось запустить подготовку арены в фоне");
+        return;
+    }
+    server->preparing = 1;
+}
+
+/* Ожидание окончания подготовки арены */
+static void server_finish_prepare(Server *server) {
+    if (!server->preparing) return;
+    pthread_join(server->prepare_thread, NULL);
+    server->preparing = 0;
+}
+
+/* Отсчёт до новой арены: раз в секунду WAIT_ARENA, по окончании - новая арена */
+static void on_arena_countdown(Timer *timer, void *user) {
+    Server *server = (Server *)user;
+    if (server->game->state != GAME_STATE_ARENA_OVER) return;
+    
+    if (server->arena_countdown > 0) {
+        uint8_t buf[64];
+        int len = encode_wait_arena(buf, server->arena_countdown);
+        server_broadcast(server, buf, len);
+        server->arena_countdown--;
+        timer_schedule(&server->timers, timer, TICKS_PER_SECOND);
+        return;
+    }
+    
+    /* Если арена не создалась, игра остаётся в GAME_STATE_ARENA_OVER и отсчёт начнётся заново */
+    server_finish_prepare(server);
+    game_next_arena(server->game);
+    if (!server->game->arena) {
+        LOG_WARN("Не удалось создать арену %d, повтор после отсчёта", server->game->arena_number + 1);
+        return;
+    }
+    server_broadcast_start_arena(server);
+}
+
+/* Подключение не прислало LOGIN вовремя */
+static void on_login_timeout(Timer *timer, void *user) {
+    (void)timer;
+    Session *s = (Session *)user;
+    if (s->active || s->tcp_socket.fd < 0) return;
+    
+    LOG_INFO("Подключение закрыто: нет входа за %d с", SERVER_LOGIN_TIMEOUT_SECONDS);
+    socket_close(&s->tcp_socket);
+    s->tcp_buffer_len = 0;
+}
+
+/* Игрок слишком долго ничего не присылал */
+static void on_idle_timeout(Timer *timer, void *user) {
+    (void)timer;
+    Session *s = (Session *)user;
+    if (!s->active) return;
+    
+    LOG_INFO("Игрок %c отключён за бездействие", s->symbol);
+    server_remove_session((Server *)s->owner, s);
+}
+
+/* Закрытие подключения: игрок удаляется, неавторизованный сокет просто закрывается */
+static void server_close_session(Server *server, Session *session) {
+    if (session->active) {
+        server_remove_session(server, session);
+        return;
+    }
+    timer_cancel(&server->timers, &session->login_timer);
+    socket_close(&session->tcp_socket);
+    session->tcp_buffer_len = 0;
+}
+
+/* Периодический вывод отброшенного трафика (только если что-то отброшено) */
+static void on_drop_log(Timer *timer, void *user) {
+    Server *server = (Server *)user;
+    ServerDropStats *now = &server->drops;
+    ServerDropStats *last = &server->drops_logged;
+    if (now->rate_limited != last->rate_limited || now->malformed != last->malformed ||
+        now->unauthenticated != last->unauthenticated) {
+        LOG_INFO("Отброшено за %d с: сверх лимита %llu, некорректных %llu, без входа %llu",
+                 SERVER_DROP_LOG_SECONDS,
+                 (unsigned long long)(now->rate_limited - last->rate_limited),
+                 (unsigned long long)(now->malformed - last->malformed),
+                 (unsigned long long)(now->unauthenticated - last->unauthenticated));
+        *last = *now;
+    }
+    timer_schedule(&server->timers, timer, (uint64_t)SERVER_DROP_LOG_SECONDS * TICKS_PER_SECOND);
+}
+
+/* Ведро датаграмм адреса источника. Адреса с одним хэшем делят ведро: при коллизии
+ * запас не сбрасывается, поэтому перебор адресов не даёт флуду новых токенов */
+static TokenBucket *server_udp_source_bucket(Server *server, const struct sockaddr_in *src) {
+    uint32_t addr = src->sin_addr.s_addr;
+    return &server->udp_sources[(addr * 2654435761u) >> 26];
+}
+
+/* Удаление игрока вместе с сессией и рассылка обновлённого списка */
+void server_remove_session(Server *server, Session *session) {
+    timer_cancel(&server->timers, &session->idle_timer);
+    game_remove_player(server->game, game_get_player_index(server->game, session->symbol));
+    room_session_remove(&server->room, session->token);
+    
+    char symbols[MAX_PLAYERS];
+    int count = room_session_get_symbols(&server->room, symbols);
+    uint8_t buf[64];
+    int len = encode_dynamic_info(buf, symbols, count);
+    server_broadcast(server, buf, len);
+}
+
 /* Обработка нового подключения */
 void server_handle_connection(Server *server) {
     if (socket_has_data(&server->tcp_listener, 0)) {
@@ -211,6 +394,11 @@ void server_handle_connection(Server *server) {
             for (int i = 0; i < MAX_PLAYERS; i++) {
                 if (!server->room.sessions[i].active && server->room.sessions[i].tcp_socket.fd < 0) {
                     server->room.sessions[i].tcp_socket = client;
+                    server->room.sessions[i].version_rejected = 0;
+                    server->room.sessions[i].bucket = token_bucket_create(SERVER_SESSION_RATE, SERVER_SESSION_BURST,
+                                                                          server_now_ms(server));
+                    timer_schedule(&server->timers, &server->room.sessions[i].login_timer,
+                                   (uint64_t)SERVER_LOGIN_TIMEOUT_SECONDS * TICKS_PER_SECOND);
                     break;
                 }
             }
@@ -226,6 +414,14 @@ static void process_session_tcp_buffer(Server *server, Session **session) {
         
         size_t packet_size = PACKET_HEADER_SIZE + header.data_length;
         
+        /* Пакет, который не поместится в буфер, никогда не будет полным */
+        if (packet_size > SESSION_TCP_BUFFER_SIZE) {
+            server->drops.malformed++;
+            LOG_WARN("Подключение закрыто: пакет %zu байт больше буфера", packet_size);
+            server_close_session(server, *session);
+            return;
+        }
+        
         /* Проверяем, есть ли полный пакет в буфере */
         if ((*session)->tcp_buffer_len < packet_size) {
             /* Неполный пакет, ждём больше данных */
@@ -235,8 +431,12 @@ static void process_session_tcp_buffer(Server *server, Session **session) {
         /* Сохраняем текущую длину буфера на случай, если она изменится в handle_single_packet */
         size_t buffer_len_before = (*session)->tcp_buffer_len;
         
-        /* Обрабатываем полный пакет */
-        handle_single_packet(server, session, (*session)->tcp_buffer, (int)packet_size);
+        /* Обрабатываем полный пакет; сверх лимита подключения он только вычитывается */
+        if (token_bucket_take(&(*session)->bucket, server_now_ms(server))) {
+            handle_single_packet(server, session, (*session)->tcp_buffer, (int)packet_size);
+        } else {
+            server->drops.rate_limited++;
+        }
         
         /* Проверяем, изменилась ли длина буфера (например, при LOGIN) */
         if ((*session)->tcp_buffer_len != buffer_len_before) {
@@ -255,6 +455,16 @@ static void process_session_tcp_buffer(Server *server, Session **session) {
     }
 }
 
+/* Совместимость версии клиента: 2 - та же версия, 1 - та же старшая часть
+ * (формат сообщений общий), 0 - несовместима */
+static int server_version_compatibility(const char *client_version) {
+    const char *dot = strchr(PROTOCOL_VERSION, '.');
+    size_t major_len = (size_t)(dot - PROTOCOL_VERSION);
+    if (strcmp(client_version, PROTOCOL_VERSION) == 0) return 2;
+    if (strncmp(client_version, PROTOCOL_VERSION, major_len + 1) == 0) return 1;
+    return 0;
+}
+
 /* Обработка одного полного пакета от клиента */
 static void handle_single_packet(Server *server, Session **session, uint8_t *data, int len) {
     if (len < (int)PACKET_HEADER_SIZE) return;
@@ -266,10 +476,24 @@ static void handle_single_packet(Server *server, Session **session, uint8_t *dat
     uint8_t response[MAX_PACKET_SIZE];
     int resp_len = 0;
     
+    /* Клиенту с несовместимой версией отвечаем только на VERSION, а подключение
+     * закрывает таймаут входа: так клиент успевает показать причину отказа */
+    if ((*session)->version_rejected && header.message_type != CLIENT_MSG_VERSION) return;
+    
     switch (header.message_type) {
         case CLIENT_MSG_VERSION: {
-            /* Отправляем ответ версии */
-            resp_len = encode_version_response(response, PROTOCOL_VERSION, 1);
+            /* Сверяем версию клиента и отправляем ответ */
+            char client_version[33];
+            int compatibility = 0;
+            if (header.data_length >= 1 && header.data_length >= 1 + payload[0]) {
+                decode_version(payload, client_version, sizeof(client_version));
+                compatibility = server_version_compatibility(client_version);
+            }
+            if (compatibility == 0 && !(*session)->active) {
+                (*session)->version_rejected = 1;
+                LOG_INFO("Подключение отклонено: несовместимая версия клиента");
+            }
+            resp_len = encode_version_response(response, PROTOCOL_VERSION, compatibility);
             socket_send_all(&(*session)->tcp_socket, response, (size_t)resp_len);
             break;
         }
@@ -312,7 +536,8 @@ static void handle_single_packet(Server *server, Session **session, uint8_t *dat
             /* Проверяем символ */
             if (symbol < 'A' || symbol > 'Z') {
                 status = LOGIN_INVALID_CHAR;
-            } else if (room_session_find_by_symbol(&server->room, symbol)) {
+            } else if (room_session_find_by_symbol(&server->room, symbol) ||
+                       game_get_player_by_symbol(server->game, symbol)) {
                 status = LOGIN_ALREADY_USED;
             } else if (room_session_is_full(&server->room)) {
                 status = LOGIN_ROOM_FULL;
@@ -324,7 +549,7 @@ static void handle_single_packet(Server *server, Session **session, uint8_t *dat
                 } else {
                     /* Добавляем игрока в игру */
                     game_add_player(server->game, symbol);
-                    printf("Игрок %c подключился (токен: %d)\n", symbol, token);
+                    LOG_INFO("Игрок %c подключился (токен: %d)", symbol, token);
                     
                     /* Получаем новую сессию и восстанавливаем буфер */
                     Session *new_session = room_session_find_by_token(&server->room, token);
@@ -339,6 +564,18 @@ static void handle_single_packet(Server *server, Session **session, uint8_t *dat
                                    remaining_len);
                         }
                         new_session->tcp_buffer_len = remaining_len;
+                        new_session->bucket = (*session)->bucket;  /* Повторный вход не обнуляет лимит */
+                        new_session->udp_bucket = token_bucket_create(SERVER_UDP_SESSION_RATE,
+                                                                      SERVER_UDP_SESSION_BURST,
+                                                                      server_now_ms(server));
+                        
+                        /* Вход выполнен: таймаут входа больше не нужен */
+                        timer_cancel(&server->timers, &(*session)->login_timer);
+                        timer_cancel(&server->timers, &new_session->login_timer);
+                        if (server->idle_kick_ticks > 0) {
+                            timer_schedule(&server->timers, &new_session->idle_timer,
+                                           (uint64_t)server->idle_kick_ticks);
+                        }
                         
                         /* Очищаем старую сессию, если это другой слот */
                         if (new_session != *session) {
@@ -367,54 +604,49 @@ static void handle_single_packet(Server *server, Session **session, uint8_t *dat
         
         case CLIENT_MSG_LOGOUT: {
             if (!(*session)->active) break;
-            printf("Игрок %c вышел\n", (*session)->symbol);
-            game_remove_player(server->game, game_get_player_index(server->game, (*session)->symbol));
-            room_session_remove(&server->room, (*session)->token);
-            
-            /* Рассылаем обновлённый список */
-            char symbols[MAX_PLAYERS];
-            int count = room_session_get_symbols(&server->room, symbols);
-            resp_len = encode_dynamic_info(response, symbols, count);
-            server_broadcast(server, response, resp_len);
+            LOG_INFO("Игрок %c вышел", (*session)->symbol);
+            server_remove_session(server, *session);
             break;
         }
         
         case CLIENT_MSG_MOVE_PLAYER: {
-            if (!(*session)->active) break;
+            if (!(*session)->active) {
+                server->drops.unauthenticated++;
+                break;
+            }
+            if (header.data_length != 1 || payload[0] > DIR_RIGHT) {
+                server->drops.malformed++;
+                break;
+            }
             if (server->game->state != GAME_STATE_PLAYING) break;
             
             Direction dir;
             decode_move_player(payload, &dir);
-            
-            /* Находим сущность игрока и перемещаем */
-            Player *player = game_get_player_by_symbol(server->game, (*session)->symbol);
-            if (player && player->entity_id >= 0 && server->game->arena) {
-                arena_move_entity(server->game->arena, player->entity_id, dir);
-            }
+            server_queue_move(server, (*session)->symbol, dir, 1);
             break;
         }
         
         case CLIENT_MSG_CAST_SKILL: {
-            if (!(*session)->active) break;
+            if (!(*session)->active) {
+                server->drops.unauthenticated++;
+                break;
+            }
+            if (header.data_length < 2 || payload[0] > DIR_RIGHT) {
+                server->drops.malformed++;
+                break;
+            }
             if (server->game->state != GAME_STATE_PLAYING) break;
             
             Direction dir;
             uint8_t spell_type_raw;
-            decode_cast_skill(payload, &dir, &spell_type_raw);
+            uint32_t seen_tick;
+            decode_cast_skill(payload, header.data_length, &dir, &spell_type_raw, &seen_tick);
             
             /* Преобразуем в SpellType */
-            SpellType spell_type = (spell_type_raw == 2) ? SPELL_TYPE_POWER : SPELL_TYPE_BASIC;
-            
-            /* Находим сущность игрока и применяем способность */
-            Player *player = game_get_player_by_symbol(server->game, (*session)->symbol);
-            if (player && player->entity_id >= 0 && server->game->arena) {
-                /* Обновляем выбранный тип заклинания у сущности */
-                Entity *entity = arena_get_entity(server->game->arena, player->entity_id);
-                if (entity) {
-                    entity->spell_type = spell_type;
-                }
-                arena_cast_spell(server->game->arena, player->entity_id, dir, spell_type);
-            }
+            SpellType spell_type = SPELL_TYPE_BASIC;
+            if (spell_type_raw == 2) spell_type = SPELL_TYPE_POWER;
+            else if (spell_type_raw == 3) spell_type = SPELL_TYPE_BLAST;
+            server_queue_cast(server, (*session)->symbol, dir, spell_type, seen_tick, 1);
             break;
         }
         
@@ -425,6 +657,7 @@ static void handle_single_packet(Server *server, Session **session, uint8_t *dat
         }
         
         default:
+            server->drops.malformed++;
             break;
     }
 }
@@ -437,26 +670,109 @@ void server_handle_message(Server *server, Session *session, uint8_t *data, int
 
 /* Обработка UDP сообщения */
 void server_handle_udp(Server *server, uint8_t *data, int len, struct sockaddr_in *src) {
-    if (len < (int)PACKET_HEADER_SIZE) return;
+    /* По UDP приходит только CONNECT_UDP с токеном (4 байта). Датаграмма с токеном
+     * вошедшего игрока расходует лимит его сессии, остальные - общий лимит адреса
+     * источника: подделанный адрес игрока не исчерпывает его лимит */
+    int well_formed = len == (int)PACKET_HEADER_SIZE + 4 && data[0] == CLIENT_MSG_CONNECT_UDP &&
+                      (data[1] | (data[2] << 8)) == 4;
+    Session *session = NULL;
+    if (well_formed) {
+        int32_t token;
+        decode_connect_udp(data + PACKET_HEADER_SIZE, &token);
+        session = room_session_find_by_token(&server->room, token);
+    }
     
-    PacketHeader header;
-    decode_packet_header(data, &header);
-    uint8_t *payload = data + PACKET_HEADER_SIZE;
+    TokenBucket *bucket = session ? &session->udp_bucket : server_udp_source_bucket(server, src);
+    if (!token_bucket_take(bucket, server_now_ms(server))) {
+        server->drops.rate_limited++;
+        return;
+    }
+    if (!well_formed) {
+        server->drops.malformed++;
+        return;
+    }
+    if (!session) {
+        server->drops.unauthenticated++;
+        return;
+    }
+    session->udp_addr = *src;
+    session->udp_connected = 1;
     
-    if (header.message_type == CLIENT_MSG_CONNECT_UDP) {
-        int32_t token;
-        decode_connect_udp(payload, &token);
-        
-        Session *session = room_session_find_by_token(&server->room, token);
-        if (session) {
-            session->udp_addr = *src;
-            session->udp_connected = 1;
-            
-            /* Отправляем подтверждение */
-            uint8_t response[64];
-            int resp_len = encode_udp_connected(response);
-            socket_send_all(&session->tcp_socket, response, (size_t)resp_len);
-        }
+    /* Отправляем подтверждение */
+    uint8_t response[64];
+    int resp_len = encode_udp_connected(response);
+    socket_send_all(&session->tcp_socket, response, (size_t)resp_len);
+}
+
+/* Постановка движения игрока в очередь ввода */
+void server_queue_move(Server *server, char symbol, Direction dir, int buffered) {
+    PlayerInput input = player_input_none(game_next_input_tick(server->game));
+    input.move = dir;
+    input.buffered = buffered;
+    game_queue_input(server->game, game_get_player_index(server->game, symbol), &input);
+}
+
+/* Установка зерна следующего матча */
+void server_set_seed(Server *server, uint64_t seed) {
+    server->next_seed = seed;
+}
+
+/* Арены на картах библиотеки */
+void server_set_map_library(Server *server, const MapLibrary *library, int map_index) {
+    game_set_map_library(server->game, library, map_index);
+}
+
+/* Установка времени отключения за бездействие */
+void server_set_idle_kick(Server *server, int seconds) {
+    server->idle_kick_ticks = (seconds > 0) ? seconds * TICKS_PER_SECOND : 0;
+}
+
+/* Установка предела отката при компенсации лага */
+void server_set_max_rewind(Server *server, int rewind_ms) {
+    int ticks = rewind_ms / FRAME_TIME_MS;
+    if (ticks < 0) ticks = 0;
+    if (ticks > ARENA_HISTORY_TICKS - 1) ticks = ARENA_HISTORY_TICKS - 1;
+    server->max_rewind_ticks = ticks;
+}
+
+/* Постановка способности игрока в очередь ввода */
+void server_queue_cast(Server *server, char symbol, Direction dir, SpellType spell_type, uint32_t seen_tick,
+                       int buffered) {
+    Arena *arena = server->game->arena;
+    if (!arena) return;
+    
+    /* Попадания проверяются по кадру, который видел игрок, но не старше предела.
+     * Кадр из будущего или с прошлой арены означает, что откатывать нечего.
+     * Задержка считается по приходу: отложенное на перезарядку заклинание её не накапливает */
+    int rewind = 0;
+    if (seen_tick > 0 && seen_tick <= arena->state.tick) {
+        uint32_t lag = arena->state.tick - seen_tick;
+        rewind = (lag < (uint32_t)server->max_rewind_ticks) ? (int)lag : server->max_rewind_ticks;
+    }
+    
+    PlayerInput input = player_input_none(game_next_input_tick(server->game));
+    input.cast = dir;
+    input.spell_type = spell_type;
+    input.rewind = rewind;
+    input.buffered = buffered;
+    game_queue_input(server->game, game_get_player_index(server->game, symbol), &input);
+}
+
+/* Решение бота в начале тика (источник ввода игры; игроки-люди пропускаются) */
+static void server_bot_input(Game *game, int player_index, void *user) {
+    Server *server = (Server *)user;
+    if (!server->bot_nav) return;
+    
+    char symbol = game->players[player_index].symbol;
+    if (!memchr(server->bot_symbols, symbol, (size_t)server->bot_count)) return;
+    
+    /* Боты ставят действия в очередь ввода тем же путём, что и сообщения клиентов */
+    BotInput input = bot_think(server->bot_nav, game, player_index, &server->bot_rng);
+    if (input.move != DIR_NONE) {
+        server_queue_move(server, symbol, input.move, 0);
+    }
+    if (input.cast != DIR_NONE) {
+        server_queue_cast(server, symbol, input.cast, input.spell_type, 0, 0);
     }
 }
 
@@ -479,6 +795,72 @@ void server_broadcast_game_step(Server *server) {
     }
 }
 
+/* Порция чанков для одного клиента */
+typedef struct {
+    int indices[MAP_STREAM_BYTES_PER_TICK / 3];
+    int count;
+    int bytes;
+} ChunkBatch;
+
+/* Добавление чанка в порцию, если он ещё не отправлен. Возвращает 0, когда бюджет исчерпан */
+static int stream_add_chunk(Session *s, const Map *map, ChunkBatch *batch, int cx, int cy) {
+    if (cx < 0 || cy < 0 || cx >= map->chunks_per_side || cy >= map->chunks_per_side) return 1;
+    
+    int index = cy * map->chunks_per_side + cx;
+    if (s->chunks_sent[index / 8] & (1 << (index % 8))) return 1;
+    
+    int bytes = encode_map_chunk_bytes(map, index);
+    if (batch->bytes + bytes > MAP_STREAM_BYTES_PER_TICK) return 0;
+    
+    batch->indices[batch->count++] = index;
+    batch->bytes += bytes;
+    s->chunks_sent[index / 8] |= (uint8_t)(1 << (index % 8));
+    s->chunks_sent_count++;
+    return 1;
+}
+
+/* Досылка чанков карты клиентам */
+void server_stream_map(Server *server) {
+    if (!server->game->arena) return;
+    
+    const Map *map = server->game->arena->map;
+    int total = map_chunk_count(map);
+    
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        Session *s = &server->room.sessions[i];
+        if (!s->active || s->chunks_sent_count >= total) continue;
+        
+        /* Центр раскрытия - чанк игрока, для погибшего - центр карты */
+        int center_x = map->chunks_per_side / 2;
+        int center_y = map->chunks_per_side / 2;
+        Player *player = game_get_player_by_symbol(server->game, s->symbol);
+        Entity *entity = player ? arena_get_entity(server->game->arena, player->entity_id) : NULL;
+        if (entity) {
+            center_x = entity->position.x >> MAP_CHUNK_SHIFT;
+            center_y = entity->position.y >> MAP_CHUNK_SHIFT;
+        }
+        
+        /* Обходим кольца чанков вокруг центра по возрастанию расстояния */
+        ChunkBatch batch;
+        batch.count = 0;
+        batch.bytes = 0;
+        int open = 1;
+        for (int r = 0; open && r < map->chunks_per_side; r++) {
+            for (int dy = -r; open && dy <= r; dy++) {
+                int edge = (dy == -r || dy == r);
+                for (int dx = -r; open && dx <= r; dx += edge ? 1 : 2 * r) {
+                    open = stream_add_chunk(s, map, &batch, center_x + dx, center_y + dy);
+                }
+            }
+        }
+        if (batch.count == 0) continue;
+        
+        uint8_t buffer[MAX_PACKET_SIZE];
+        int len = encode_map_chunks(buffer, map, batch.indices, batch.count);
+        socket_send_all(&s->tcp_socket, buffer, (size_t)len);
+    }
+}
+
 /* Рассылка сообщения всем клиентам */
 void server_broadcast(Server *server, uint8_t *data, int len) {
     for (int i = 0; i < MAX_PLAYERS; i++) {
@@ -496,12 +878,18 @@ void server_stop(Server *server) {
 
 /* Освобождение ресурсов */
 void server_destroy(Server *server) {
+    LOG_INFO("Отброшено всего: сверх лимита %llu, некорректных %llu, без входа %llu",
+             (unsigned long long)server->drops.rate_limited,
+             (unsigned long long)server->drops.malformed,
+             (unsigned long long)server->drops.unauthenticated);
+    server_finish_prepare(server);
     room_session_destroy(&server->room);
     socket_close(&server->tcp_listener);
     socket_close(&server->udp_socket);
     if (server->game) {
         game_destroy(server->game);
     }
+    bot_nav_destroy(server->bot_nav);
     free(server);
 }
 
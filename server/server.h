@@ -6,9 +6,45 @@
 #ifndef SERVER_H
 #define SERVER_H
 
+#include <pthread.h>
 #include "session.h"
 #include "../core/game.h"
+#include "../core/bot.h"
 #include "../net/socket.h"
+#include "../common/timer.h"
+
+/* Предел отката по умолчанию при компенсации лага, мс */
+#define SERVER_DEFAULT_REWIND_MS 150
+
+/* Отсчёт перед новой ареной и таймаут входа, секунды */
+#define SERVER_ARENA_COUNTDOWN_SECONDS 3
+#define SERVER_LOGIN_TIMEOUT_SECONDS 10
+
+/* Лимит сообщений одного TCP подключения: в секунду и запас на всплеск */
+#define SERVER_SESSION_RATE 60
+#define SERVER_SESSION_BURST 30
+
+/* Лимит UDP датаграмм с токеном вошедшего игрока (своё ведро у каждой сессии) */
+#define SERVER_UDP_SESSION_RATE 4
+#define SERVER_UDP_SESSION_BURST 8
+
+/* Небольшой лимит остальных UDP датаграмм с одного адреса и размер таблицы адресов */
+#define SERVER_UDP_RATE 2
+#define SERVER_UDP_BURST 4
+#define SERVER_UDP_SOURCE_SLOTS 64
+
+/* Сколько UDP датаграмм читается за кадр (остальные ждут в буфере сокета) */
+#define SERVER_UDP_DATAGRAMS_PER_TICK 64
+
+/* Период вывода счётчиков отброшенного трафика в лог, секунды */
+#define SERVER_DROP_LOG_SECONDS 10
+
+/* Счётчики отброшенного трафика */
+typedef struct {
+    uint64_t rate_limited;      /* Сверх лимита подключения или адреса */
+    uint64_t malformed;         /* Некорректные пакеты и датаграммы */
+    uint64_t unauthenticated;   /* До входа или с неизвестным токеном */
+} ServerDropStats;
 
 /* Сервер */
 typedef struct {
@@ -19,10 +55,34 @@ typedef struct {
     int tcp_port;           /* TCP порт */
     int udp_port;           /* UDP порт */
     int running;            /* Флаг работы */
+    
+    /* Серверные боты: играют как обычные игроки без сессий */
+    char bot_symbols[MAX_PLAYERS];  /* Символы ботов */
+    int bot_count;                  /* Количество ботов */
+    BotNav *bot_nav;                /* Общие поля расстояний ботов */
+    Rng bot_rng;                    /* Генератор решений ботов (выводится из зерна матча) */
+    uint64_t next_seed;             /* Зерно следующего матча (каждый следующий - +1) */
+    
+    int max_rewind_ticks;           /* Предел отката попаданий в тиках (компенсация лага) */
+    
+    /* Отложенные события по тикам игрового цикла */
+    TimerWheel timers;              /* Колесо таймеров сервера */
+    Timer arena_timer;              /* Отсчёт до следующей арены */
+    int arena_countdown;            /* Оставшиеся секунды отсчёта */
+    pthread_t prepare_thread;       /* Поток подготовки карты следующей арены */
+    int preparing;                  /* 1 - поток подготовки запущен и ещё не присоединён */
+    int idle_kick_ticks;            /* Отключение за бездействие в тиках (0 - выключено) */
+    
+    /* Защита от флуда */
+    TokenBucket udp_sources[SERVER_UDP_SOURCE_SLOTS]; /* Лимиты UDP по хэшу адреса источника */
+    ServerDropStats drops;          /* Отброшено всего */
+    ServerDropStats drops_logged;   /* Значения на момент последнего вывода в лог */
+    Timer drop_log_timer;           /* Периодический вывод счётчиков */
 } Server;
 
-/* Создание сервера */
-Server* server_create(int tcp_port, int udp_port, int max_players, int map_size, int winner_points);
+/* Создание сервера (bot_count из max_players мест занимают боты) */
+Server* server_create(int tcp_port, int udp_port, int max_players, int map_size, int winner_points,
+                      int bot_count);
 
 /* Главный цикл сервера */
 void server_run(Server *server);
@@ -36,9 +96,41 @@ void server_handle_message(Server *server, Session *session, uint8_t *data, int
 /* Обработка UDP сообщения */
 void server_handle_udp(Server *server, uint8_t *data, int len, struct sockaddr_in *src);
 
+/* Постановка движения игрока в очередь ввода на следующий тик
+ * (общий путь для сообщений клиентов и ботов). buffered - отложить на время перезарядки */
+void server_queue_move(Server *server, char symbol, Direction dir, int buffered);
+
+/* Установка зерна следующего матча: матч с тем же зерном и теми же действиями игроков повторяется */
+void server_set_seed(Server *server, uint64_t seed);
+
+/* Арены на картах библиотеки (map_index -1 - карта выбирается по зерну арены).
+ * Библиотека должна оставаться открытой до server_destroy */
+void server_set_map_library(Server *server, const MapLibrary *library, int map_index);
+
+/* Установка времени отключения за бездействие (0 - не отключать) */
+void server_set_idle_kick(Server *server, int seconds);
+
+/* Установка предела отката при компенсации лага (обрезается глубиной истории арены) */
+void server_set_max_rewind(Server *server, int rewind_ms);
+
+/* Постановка способности игрока в очередь ввода на следующий тик (общий путь для сообщений
+ * клиентов и ботов). seen_tick - кадр, который видел игрок (0 - без отката),
+ * buffered - отложить на время перезарядки */
+void server_queue_cast(Server *server, char symbol, Direction dir, SpellType spell_type, uint32_t seen_tick,
+                       int buffered);
+
+/* Удаление игрока вместе с сессией и рассылка обновлённого списка игроков */
+void server_remove_session(Server *server, Session *session);
+
+/* Рассылка начала арены (карта досылается чанками заново) */
+void server_broadcast_start_arena(Server *server);
+
 /* Рассылка GameStep всем клиентам */
 void server_broadcast_game_step(Server *server);
 
+/* Досылка чанков карты клиентам, ближайшие к игроку - первыми */
+void server_stream_map(Server *server);
+
 /* Рассылка сообщения всем клиентам */
 void server_broadcast(Server *server, uint8_t *data, int len);
 
@@ -9,6 +9,7 @@
 #include <signal.h>
 #include <getopt.h>
 #include "server.h"
+#include "../common/log.h"
 
 /* Глобальный указатель для обработки сигналов */
 static Server *g_server = NULL;
@@ -20,7 +21,6 @@ static Server *g_server = NULL;
 static void signal_handler(int sig) {
     (void)sig;
     if (g_server) {
-        printf("\nОстановка сервера...\n");
         server_stop(g_server);
     }
 }
@@ -33,7 +33,14 @@ static void print_usage(const char *prog_name) {
     printf("  -t, --tcp PORT      TCP порт (по умолчанию: 3042)\n");
     printf("  -u, --udp PORT      UDP порт (по умолчанию: 3043)\n");
     printf("  -m, --map SIZE      Размер карты (по умолчанию: 20)\n");
+    printf("  -k, --maps FILE     Библиотека карт (asciiarena_maps) вместо генерации по -m\n");
+    printf("  -a, --arena NAME    Карта библиотеки для всех арен (по умолчанию: по зерну арены)\n");
     printf("  -w, --winner POINTS Очки для победы (по умолчанию: 5)\n");
+    printf("  -b, --bots NUM      Количество серверных ботов из числа игроков (по умолчанию: 0)\n");
+    printf("  -r, --rewind MS     Предел компенсации лага при попаданиях (по умолчанию: %d)\n", SERVER_DEFAULT_REWIND_MS);
+    printf("  -s, --seed SEED     Зерно первого матча (по умолчанию: время запуска)\n");
+    printf("  -i, --idle SECONDS  Отключать игроков без активности (по умолчанию: 0 - не отключать)\n");
+    printf("  -l, --log LEVEL     Уровень журнала: debug, info, warn, error, none (по умолчанию: info)\n");
     printf("  --help              Показать эту справку\n");
 }
 
@@ -42,7 +49,16 @@ int main(int argc, char *argv[]) {
     int tcp_port = 3042;
     int udp_port = 3043;
     int map_size = 20;
+    int map_size_set = 0;
     int winner_points = 5;
+    int bot_count = 0;
+    int rewind_ms = SERVER_DEFAULT_REWIND_MS;
+    int idle_seconds = 0;
+    uint64_t seed = 0;
+    int seed_set = 0;
+    int log_level = LOG_LEVEL_INFO;
+    const char *maps_path = NULL;
+    const char *arena_name = NULL;
     
     /* Опции командной строки */
     static struct option long_options[] = {
@@ -50,7 +66,14 @@ int main(int argc, char *argv[]) {
         {"tcp", required_argument, 0, 't'},
         {"udp", required_argument, 0, 'u'},
         {"map", required_argument, 0, 'm'},
+        {"maps", required_argument, 0, 'k'},
+        {"arena", required_argument, 0, 'a'},
         {"winner", required_argument, 0, 'w'},
+        {"bots", required_argument, 0, 'b'},
+        {"rewind", required_argument, 0, 'r'},
+        {"seed", required_argument, 0, 's'},
+        {"idle", required_argument, 0, 'i'},
+        {"log", required_argument, 0, 'l'},
         {"help", no_argument, 0, 0},
         {0, 0, 0, 0}
     };
@@ -58,7 +81,7 @@ int main(int argc, char *argv[]) {
     int opt;
     int option_index = 0;
     
-    while ((opt = getopt_long(argc, argv, "p:t:u:m:w:", long_options, &option_index)) != -1) {
+    while ((opt = getopt_long(argc, argv, "p:t:u:m:k:a:w:b:r:s:i:l:", long_options, &option_index)) != -1) {
         switch (opt) {
             case 'p':
                 max_players = atoi(optarg);
@@ -74,12 +97,42 @@ int main(int argc, char *argv[]) {
             case 'm':
                 map_size = atoi(optarg);
                 if (map_size < 10) map_size = 10;
-                if (map_size > 50) map_size = 50;
+                if (map_size > MAP_MAX_SIZE) map_size = MAP_MAX_SIZE;
+                map_size_set = 1;
+                break;
+            case 'k':
+                maps_path = optarg;
+                break;
+            case 'a':
+                arena_name = optarg;
                 break;
             case 'w':
                 winner_points = atoi(optarg);
                 if (winner_points < 1) winner_points = 1;
                 break;
+            case 'b':
+                bot_count = atoi(optarg);
+                if (bot_count < 0) bot_count = 0;
+                break;
+            case 'r':
+                rewind_ms = atoi(optarg);
+                if (rewind_ms < 0) rewind_ms = 0;
+                break;
+            case 's':
+                seed = strtoull(optarg, NULL, 10);
+                seed_set = 1;
+                break;
+            case 'i':
+                idle_seconds = atoi(optarg);
+                if (idle_seconds < 0) idle_seconds = 0;
+                break;
+            case 'l':
+                log_level = log_parse_level(optarg);
+                if (log_level < 0) {
+                    print_usage(argv[0]);
+                    return 1;
+                }
+                break;
             case 0:
                 if (strcmp(long_options[option_index].name, "help") == 0) {
                     print_usage(argv[0]);
@@ -92,21 +145,74 @@ int main(int argc, char *argv[]) {
         }
     }
     
+    /* Комната может целиком состоять из ботов */
+    if (bot_count > max_players) bot_count = max_players;
+    
+    /* Библиотека карт отображается в память и открыта до остановки сервера */
+    MapLibrary library;
+    int arena_index = -1;
+    if (maps_path) {
+        if (map_library_open(&library, maps_path) < 0) {
+            fprintf(stderr, "Ошибка: %s - не библиотека карт или файл повреждён\n", maps_path);
+            return 1;
+        }
+        if (arena_name) {
+            arena_index = map_library_find(&library, arena_name);
+            if (arena_index < 0) {
+                fprintf(stderr, "Ошибка: в библиотеке %s нет карты %s\n", maps_path, arena_name);
+                map_library_close(&library);
+                return 1;
+            }
+        }
+        
+        /* Клиенты получают наибольший размер карты, с которым им придётся играть */
+        int requested_size = map_size;
+        map_size = 0;
+        for (int i = 0; i < map_library_count(&library); i++) {
+            if (arena_index >= 0 && i != arena_index) continue;
+            int size = map_library_map_size(&library, i);
+            if (size > map_size) map_size = size;
+        }
+        if (map_size_set && requested_size != map_size) {
+            fprintf(stderr, "Внимание: -m %d не действует, размер карт задаёт библиотека (%d)\n",
+                    requested_size, map_size);
+        }
+    }
+    
     /* Устанавливаем обработчик сигналов */
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
     
+    /* Журнал пишется фоновым потоком, игровой цикл не блокируется на выводе */
+    if (log_init(stdout, (LogLevel)log_level) < 0) {
+        fprintf(stderr, "Ошибка запуска журнала\n");
+        return 1;
+    }
+    
     /* Создаём и запускаем сервер */
-    g_server = server_create(tcp_port, udp_port, max_players, map_size, winner_points);
+    g_server = server_create(tcp_port, udp_port, max_players, map_size, winner_points, bot_count);
     if (!g_server) {
-        fprintf(stderr, "Ошибка создания сервера\n");
+        LOG_ERROR("Ошибка создания сервера");
+        log_shutdown();
+        if (maps_path) map_library_close(&library);
         return 1;
     }
     
+    if (maps_path) {
+        server_set_map_library(g_server, &library, arena_index);
+        LOG_INFO("Библиотека карт %s: карт %d%s%s", maps_path, map_library_count(&library),
+                 arena_name ? ", все арены на карте " : "", arena_name ? arena_name : "");
+    }
+    
+    server_set_max_rewind(g_server, rewind_ms);
+    server_set_idle_kick(g_server, idle_seconds);
+    if (seed_set) server_set_seed(g_server, seed);
     server_run(g_server);
     server_destroy(g_server);
+    if (maps_path) map_library_close(&library);
     
-    printf("Сервер остановлен\n");
+    LOG_INFO("Сервер остановлен");
+    log_shutdown();
     return 0;
 }
 
@@ -42,7 +42,10 @@ int room_session_add(RoomSession *room, char symbol, Socket tcp_socket) {
             s->tcp_socket = tcp_socket;
             s->udp_connected = 0;
             s->active = 1;
+            s->version_rejected = 0;
             s->tcp_buffer_len = 0;  /* Инициализация TCP буфера */
+            memset(s->chunks_sent, 0, sizeof(s->chunks_sent));
+            s->chunks_sent_count = 0;
             memset(&s->udp_addr, 0, sizeof(s->udp_addr));
             
             room->session_count++;
@@ -110,6 +113,14 @@ int room_session_get_symbols(RoomSession *room, char *symbols) {
     return count;
 }
 
+/* Сброс отправленных чанков карты */
+void room_session_reset_chunks(RoomSession *room) {
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        memset(room->sessions[i].chunks_sent, 0, sizeof(room->sessions[i].chunks_sent));
+        room->sessions[i].chunks_sent_count = 0;
+    }
+}
+
 /* Освобождение ресурсов */
 void room_session_destroy(RoomSession *room) {
     for (int i = 0; i < MAX_PLAYERS; i++) {
@@ -9,6 +9,9 @@
 #include "../net/socket.h"
 #include "../net/protocol.h"
 #include "../core/player.h"
+#include "../core/map.h"
+#include "../common/timer.h"
+#include "../common/ratelimit.h"
 
 /* Размер буфера для TCP потока */
 #define SESSION_TCP_BUFFER_SIZE (MAX_PACKET_SIZE * 2)
@@ -21,10 +24,24 @@ typedef struct {
     struct sockaddr_in udp_addr;  /* UDP адрес клиента */
     int udp_connected;      /* Флаг UDP соединения */
     int active;             /* Флаг активности */
+    int version_rejected;   /* Версия клиента несовместима: кроме VERSION ничего не принимается */
     
     /* Буфер для TCP потока (обработка частичных пакетов) */
     uint8_t tcp_buffer[SESSION_TCP_BUFFER_SIZE];
     size_t tcp_buffer_len;  /* Текущая длина данных в буфере */
+    
+    /* Отправленные клиенту чанки карты текущей арены (битовая маска) */
+    uint8_t chunks_sent[MAP_MAX_CHUNKS / 8];
+    int chunks_sent_count;
+    
+    /* Таймеры сервера (слот сессии не перемещается, поэтому таймеры встроены) */
+    Timer login_timer;      /* Таймаут входа для подключения без LOGIN */
+    Timer idle_timer;       /* Отключение за бездействие */
+    void *owner;            /* Сервер - владелец таймеров (данные таймеров - сама сессия) */
+    
+    /* Лимит входящих сообщений (переносится в слот игрока при входе) */
+    TokenBucket bucket;
+    TokenBucket udp_bucket; /* Лимит датаграмм с токеном сессии (заводится при входе) */
 } Session;
 
 /* Комната с сессиями */
@@ -59,6 +76,9 @@ int room_session_is_full(RoomSession *room);
 /* Получение списка символов игроков */
 int room_session_get_symbols(RoomSession *room, char *symbols);
 
+/* Сброс отправленных чанков карты у всех сессий (новая арена) */
+void room_session_reset_chunks(RoomSession *room);
+
 /* Освобождение ресурсов */
 void room_session_destroy(RoomSession *room);
 
@@ -0,0 +1,241 @@
+/*
+ * sim_main.c - Пакетный прогон матчей ботов
+ * Тысячи независимых матчей по зернам на всех ядрах, сводная статистика баланса
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include "../core/sim.h"
+#include "../core/mapcache.h"
+#include "../common/workpool.h"
+
+/* Контекст пакетного прогона */
+typedef struct {
+    SimConfig config;       /* Базовые параметры (зерно матча i = seed + i) */
+    SimResult *results;     /* Итоги по индексу матча */
+} BatchContext;
+
+/* Получение времени в секундах */
+static double get_time_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Задача пула: один матч. Итог пишется в свой слот, поэтому порядок потоков не важен */
+static void run_match_task(int index, int worker, void *ctx) {
+    (void)worker;
+    BatchContext *batch = (BatchContext *)ctx;
+    SimConfig config = batch->config;
+    config.seed = batch->config.seed + (uint64_t)index;
+    batch->results[index] = sim_run_match(&config);
+}
+
+/* Вывод справки */
+static void print_usage(const char *prog_name) {
+    printf("Использование: %s [опции]\n", prog_name);
+    printf("Опции:\n");
+    printf("  -n, --matches NUM   Количество матчей (по умолчанию: 1000)\n");
+    printf("  -j, --threads NUM   Количество потоков (по умолчанию: все ядра)\n");
+    printf("  -s, --seed SEED     Зерно первого матча (по умолчанию: 1)\n");
+    printf("  -p, --players NUM   Количество игроков (по умолчанию: 2)\n");
+    printf("  -m, --map SIZE      Размер карты (по умолчанию: 20)\n");
+    printf("  -w, --winner POINTS Очки для победы (по умолчанию: 5)\n");
+    printf("  -t, --ticks NUM     Лимит тиков на матч (по умолчанию: 36000)\n");
+    printf("  -k, --maps FILE     Библиотека карт (asciiarena_maps) вместо генерации по -m\n");
+    printf("  -a, --arena NAME    Карта библиотеки для всех арен (по умолчанию: по зерну арены)\n");
+    printf("  --help              Показать эту справку\n");
+}
+
+/* Вывод сводной статистики (детерминирована при любом числе потоков, кроме скорости) */
+static void print_stats(const SimConfig *config, const SimResult *results, int count,
+                        int threads, double elapsed) {
+    long total_ticks = 0;
+    long total_arenas = 0;
+    long total_spells = 0;
+    int finished = 0;
+    int min_ticks = 0;
+    int max_ticks = 0;
+    int wins[MAX_PLAYERS] = {0};
+    
+    for (int i = 0; i < count; i++) {
+        const SimResult *r = &results[i];
+        total_ticks += r->ticks;
+        total_arenas += r->arenas;
+        total_spells += r->spells_cast;
+        if (i == 0 || r->ticks < min_ticks) min_ticks = r->ticks;
+        if (i == 0 || r->ticks > max_ticks) max_ticks = r->ticks;
+        if (r->finished) {
+            finished++;
+            if (r->winner_index >= 0 && r->winner_index < MAX_PLAYERS) {
+                wins[r->winner_index]++;
+            }
+        }
+    }
+    
+    printf("Матчей: %d (завершено: %d, упёрлись в лимит: %d), потоков: %d\n",
+           count, finished, count - finished, threads);
+    printf("Параметры: зерно %llu, игроков %d, карта %d, очков %d\n",
+           (unsigned long long)config->seed, config->player_count,
+           config->map_size, config->winner_points);
+    
+    printf("Победы:\n");
+    for (int i = 0; i < config->player_count; i++) {
+        double rate = finished > 0 ? 100.0 * wins[i] / finished : 0.0;
+        printf("  %c: %d (%.1f%%)\n", 'A' + i, wins[i], rate);
+    }
+    
+    printf("Длина матча (тики): средняя %.1f, мин %d, макс %d\n",
+           (double)total_ticks / count, min_ticks, max_ticks);
+    printf("Арен за матч: %.2f\n", (double)total_arenas / count);
+    printf("Заклинаний за матч: %.1f\n", (double)total_spells / count);
+    
+    if (config->map_library) {
+        printf("Карты: из библиотеки, %d шт.\n", map_library_count(config->map_library));
+    } else {
+        /* Совпадения зависят от того, какие матчи шли одновременно */
+        MapCacheStats cache = map_cache_stats();
+        uint64_t requests = cache.hits + cache.misses;
+        printf("Карты: построено %llu, взято из кэша %llu (%.1f%%)\n",
+               (unsigned long long)cache.misses, (unsigned long long)cache.hits,
+               requests > 0 ? 100.0 * (double)cache.hits / (double)requests : 0.0);
+    }
+    printf("Время: %.3f с, тиков в секунду: %.0f\n",
+           elapsed, elapsed > 0 ? (double)total_ticks / elapsed : 0.0);
+}
+
+int main(int argc, char *argv[]) {
+    SimConfig config = sim_config_default();
+    int match_count = 1000;
+    int threads = workpool_cpu_count();
+    const char *maps_path = NULL;
+    int map_size_set = 0;
+    const char *arena_name = NULL;
+    
+    /* Опции командной строки */
+    static struct option long_options[] = {
+        {"matches", required_argument, 0, 'n'},
+        {"threads", required_argument, 0, 'j'},
+        {"seed", required_argument, 0, 's'},
+        {"players", required_argument, 0, 'p'},
+        {"map", required_argument, 0, 'm'},
+        {"winner", required_argument, 0, 'w'},
+        {"ticks", required_argument, 0, 't'},
+        {"maps", required_argument, 0, 'k'},
+        {"arena", required_argument, 0, 'a'},
+        {"help", no_argument, 0, 0},
+        {0, 0, 0, 0}
+    };
+    
+    int opt;
+    int option_index = 0;
+    
+    while ((opt = getopt_long(argc, argv, "n:j:s:p:m:w:t:k:a:", long_options, &option_index)) != -1) {
+        switch (opt) {
+            case 'n':
+                match_count = atoi(optarg);
+                if (match_count < 1) match_count = 1;
+                break;
+            case 'j':
+                threads = atoi(optarg);
+                if (threads < 1) threads = 1;
+                if (threads > WORKPOOL_MAX_THREADS) threads = WORKPOOL_MAX_THREADS;
+                break;
+            case 's':
+                config.seed = strtoull(optarg, NULL, 10);
+                break;
+            case 'p':
+                config.player_count = atoi(optarg);
+                if (config.player_count < 2) config.player_count = 2;
+                if (config.player_count > MAX_PLAYERS) config.player_count = MAX_PLAYERS;
+                break;
+            case 'm':
+                config.map_size = atoi(optarg);
+                if (config.map_size < 10) config.map_size = 10;
+                if (config.map_size > MAP_MAX_SIZE) config.map_size = MAP_MAX_SIZE;
+                map_size_set = 1;
+                break;
+            case 'w':
+                config.winner_points = atoi(optarg);
+                if (config.winner_points < 1) config.winner_points = 1;
+                break;
+            case 't':
+                config.max_ticks = atoi(optarg);
+                if (config.max_ticks < 0) config.max_ticks = 0;
+                break;
+            case 'k':
+                maps_path = optarg;
+                break;
+            case 'a':
+                arena_name = optarg;
+                break;
+            case 0:
+                if (strcmp(long_options[option_index].name, "help") == 0) {
+                    print_usage(argv[0]);
+                    return 0;
+                }
+                break;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    
+    /* Библиотека карт общая для всех потоков: отображение только читается */
+    MapLibrary library;
+    if (maps_path) {
+        if (map_library_open(&library, maps_path) < 0) {
+            fprintf(stderr, "Ошибка: %s - не библиотека карт или файл повреждён\n", maps_path);
+            return 1;
+        }
+        int requested_size = config.map_size;
+        if (arena_name) {
+            config.library_map = map_library_find(&library, arena_name);
+            if (config.library_map < 0) {
+                fprintf(stderr, "Ошибка: в библиотеке %s нет карты %s\n", maps_path, arena_name);
+                map_library_close(&library);
+                return 1;
+            }
+            config.map_size = map_library_map_size(&library, config.library_map);
+        } else {
+            /* Размер игры - самая большая карта библиотеки, меньшие карты тоже допускаются */
+            config.map_size = 0;
+            for (int i = 0; i < map_library_count(&library); i++) {
+                int size = map_library_map_size(&library, i);
+                if (size > config.map_size) config.map_size = size;
+            }
+        }
+        if (map_size_set && requested_size != config.map_size) {
+            fprintf(stderr, "Внимание: -m %d не действует, размер карт задаёт библиотека (%d)\n",
+                    requested_size, config.map_size);
+        }
+        config.map_library = &library;
+    }
+    
+    BatchContext batch;
+    batch.config = config;
+    batch.results = (SimResult *)calloc((size_t)match_count, sizeof(SimResult));
+    if (!batch.results) {
+        fprintf(stderr, "Ошибка: не хватает памяти на %d матчей\n", match_count);
+        return 1;
+    }
+    
+    double start = get_time_sec();
+    if (workpool_run(threads, match_count, run_match_task, &batch) < 0) {
+        fprintf(stderr, "Ошибка запуска пула потоков\n");
+        free(batch.results);
+        return 1;
+    }
+    double elapsed = get_time_sec() - start;
+    
+    print_stats(&config, batch.results, match_count, threads, elapsed);
+    
+    free(batch.results);
+    if (config.map_library) {
+        map_library_close(&library);
+    }
+    return 0;
+}
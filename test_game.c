@@ -0,0 +1,717 @@
+/*
+ * test_game.c - Безголовые проверки ядра игры
+ * Матчи через API core/sim.h без сокетов и вывода. Код возврата 0 - все проверки прошли
+ */
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "core/sim.h"
+#include "core/mapgen.h"
+#include "core/maplib.h"
+#include "core/bot.h"
+#include "common/rng.h"
+#include "common/ratelimit.h"
+
+/* Счётчики проверок */
+static int checks_run = 0;
+static int checks_failed = 0;
+
+/* Проверка условия с сообщением о провале */
+#define CHECK(cond) do { \
+    checks_run++; \
+    if (!(cond)) { \
+        checks_failed++; \
+        printf("  ПРОВАЛ %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+    } \
+} while (0)
+
+/* Лимит по умолчанию конечен: матч без действий игроков заканчивается по лимиту */
+static void test_default_tick_limit(void) {
+    SimConfig config = sim_config_default();
+    CHECK(config.max_ticks == SIM_DEFAULT_MAX_TICKS);
+    
+    config.max_ticks = 500;
+    SimMatch *match = sim_match_create(&config);
+    CHECK(match != NULL);
+    if (!match) return;
+    for (int i = 0; i < config.player_count; i++) {
+        sim_match_set_controller(match, i, NULL, NULL);
+    }
+    while (!sim_match_is_over(match)) {
+        sim_match_step(match, 1024);
+    }
+    CHECK(match->result.ticks == 500);
+    CHECK(!match->result.finished);
+    CHECK(match->result.winner_index == -1);
+    sim_match_destroy(match);
+}
+
+/* Матч ботов с одним зерном воспроизводится побайтно */
+static void test_deterministic_match(void) {
+    SimConfig config = sim_config_default();
+    config.seed = 12345;
+    config.player_count = 4;
+    SimResult first = sim_run_match(&config);
+    SimResult second = sim_run_match(&config);
+    CHECK(memcmp(&first, &second, sizeof(SimResult)) == 0);
+    CHECK(first.ticks > 0 && first.ticks <= config.max_ticks);
+}
+
+/* Завершённый матч имеет победителя с нужным числом очков */
+static void test_match_has_winner(void) {
+    SimConfig config = sim_config_default();
+    int finished = 0;
+    for (int i = 0; i < 20; i++) {
+        config.seed = 100 + (uint64_t)i;
+        SimResult result = sim_run_match(&config);
+        if (!result.finished) continue;
+        finished++;
+        CHECK(result.winner_index >= 0 && result.winner_index < config.player_count);
+        if (result.winner_index >= 0) {
+            CHECK(result.points[result.winner_index] >= config.winner_points);
+            CHECK(result.winner == 'A' + result.winner_index);
+        }
+    }
+    CHECK(finished > 0);
+}
+
+/* Скриптовый вход двигает сущность игрока на следующем тике */
+static void test_scripted_input(void) {
+    SimConfig config = sim_config_default();
+    SimMatch *match = sim_match_create(&config);
+    CHECK(match != NULL);
+    if (!match) return;
+    sim_match_set_controller(match, 0, NULL, NULL);
+    sim_match_set_controller(match, 1, NULL, NULL);
+    
+    Arena *arena = match->game->arena;
+    Entity *entity = arena_get_entity(arena, match->game->players[0].entity_id);
+    CHECK(entity != NULL);
+    if (!entity) {
+        sim_match_destroy(match);
+        return;
+    }
+    
+    /* Ищем свободное соседнее направление */
+    Direction dir = DIR_NONE;
+    for (int d = DIR_UP; d <= DIR_RIGHT; d++) {
+        Vec2 next = vec2_add(entity->position, direction_to_vec2((Direction)d));
+        if (map_is_walkable(arena->map, next) && !arena_is_position_occupied(arena, next)) {
+            dir = (Direction)d;
+            break;
+        }
+    }
+    CHECK(dir != DIR_NONE);
+    
+    Vec2 expected = vec2_add(entity->position, direction_to_vec2(dir));
+    SimInput input = sim_input_none();
+    input.move = dir;
+    sim_match_set_input(match, 0, &input);
+    sim_match_step(match, 1);
+    CHECK(vec2_equals(entity->position, expected));
+    sim_match_destroy(match);
+}
+
+/* Контроллер, запоминающий позицию сущности игрока 0 в момент опроса */
+static void record_controller(SimMatch *match, int player_index, SimInput *input, void *user) {
+    (void)player_index;
+    (void)input;
+    Entity *entity = arena_get_entity(match->game->arena, match->game->players[0].entity_id);
+    if (entity) *(Vec2 *)user = entity->position;
+}
+
+/* Источники ввода всех игроков опрашиваются до применения чьего-либо ввода:
+ * второй игрок не видит шаг первого, сделанный в том же тике */
+static void test_inputs_polled_before_apply(void) {
+    SimConfig config = sim_config_default();
+    SimMatch *match = sim_match_create(&config);
+    CHECK(match != NULL);
+    if (!match) return;
+    
+    Vec2 seen = vec2_create(-1, -1);
+    sim_match_set_controller(match, 0, NULL, NULL);
+    sim_match_set_controller(match, 1, record_controller, &seen);
+    
+    Arena *arena = match->game->arena;
+    Entity *entity = arena_get_entity(arena, match->game->players[0].entity_id);
+    CHECK(entity != NULL);
+    if (!entity) {
+        sim_match_destroy(match);
+        return;
+    }
+    Vec2 before = entity->position;
+    
+    Direction dir = DIR_NONE;
+    for (int d = DIR_UP; d <= DIR_RIGHT; d++) {
+        Vec2 next = vec2_add(before, direction_to_vec2((Direction)d));
+        if (map_is_walkable(arena->map, next) && !arena_is_position_occupied(arena, next)) {
+            dir = (Direction)d;
+            break;
+        }
+    }
+    CHECK(dir != DIR_NONE);
+    
+    SimInput input = sim_input_none();
+    input.move = dir;
+    sim_match_set_input(match, 0, &input);
+    sim_match_step(match, 1);
+    CHECK(!vec2_equals(entity->position, before));
+    CHECK(vec2_equals(seen, before));
+    sim_match_destroy(match);
+}
+
+/* Дистанции до стен по выходам чанков совпадают с прямым обходом клеток,
+ * в том числе у карт, размер которых не кратен чанку */
+static void test_wall_distance(void) {
+    const int sizes[] = { 20, 37, 64, 100 };
+    for (int s = 0; s < 4; s++) {
+        Region region;
+        if (region_init(&region, map_region_size(sizes[s])) < 0) continue;
+        Map map;
+        Vec2 first_spawn;
+        int generated = mapgen_generate_random(&map, sizes[s], 77 + (uint32_t)s, &region, &first_spawn) == 0 &&
+                        map_build_tables(&map, first_spawn) == 0;
+        CHECK(generated);
+        
+        int mismatches = 0;
+        for (int y = 0; generated && y < map.size; y++) {
+            for (int x = 0; x < map.size; x++) {
+                for (int d = DIR_UP; d <= DIR_RIGHT; d++) {
+                    Vec2 delta = direction_to_vec2((Direction)d);
+                    Vec2 next = vec2_create(x + delta.x, y + delta.y);
+                    int expected = 0;
+                    while (map_is_walkable(&map, next)) {
+                        expected++;
+                        next = vec2_add(next, delta);
+                    }
+                    if (map_distance_to_wall(&map, vec2_create(x, y), (Direction)d) != expected) mismatches++;
+                }
+            }
+        }
+        CHECK(mismatches == 0);
+        region_destroy(&region);
+    }
+}
+
+/* Запись террейна сообщает об ошибке, а не пропускает клетку молча */
+static void test_write_terrain_errors(void) {
+    Region region;
+    if (region_init(&region, map_region_size(20)) < 0) return;
+    Map map;
+    CHECK(map_init(&map, 20, &region) == 0);
+    CHECK(map_write_terrain(&map, vec2_create(5, 5), TERRAIN_WALL) == 0);
+    CHECK(map_write_terrain(&map, vec2_create(20, 5), TERRAIN_WALL) < 0);
+    
+    /* Пул клеток исчерпан: развернуть ещё один чанк нельзя */
+    map.cells_used = (uint32_t)(map_chunk_count(&map) * MAP_CHUNK_CELLS);
+    map.chunks[0].cells = MAP_CHUNK_UNIFORM;
+    map.chunks[0].fill = TERRAIN_FLOOR;
+    CHECK(map_write_terrain(&map, vec2_create(1, 1), TERRAIN_WALL) < 0);
+    
+    /* Упакованная карта неизменна */
+    map.region = NULL;
+    CHECK(map_write_terrain(&map, vec2_create(5, 5), TERRAIN_FLOOR) < 0);
+    region_destroy(&region);
+}
+
+/* Арена на открытой карте (стены только по периметру) для прямых проверок ядра */
+typedef struct {
+    Region region;
+    Map map;
+    Arena *arena;
+} TestArena;
+
+/* Создание арены size x size со стенами в walls[wall_count]. Возвращает 0 или -1 */
+static int test_arena_create(TestArena *test, int size, const Vec2 *walls, int wall_count) {
+    if (region_init(&test->region, arena_region_size(size) + sizeof(Arena) + REGION_ALIGN) < 0) return -1;
+    test->arena = (Arena *)region_alloc(&test->region, sizeof(Arena));
+    int ok = test->arena && map_init(&test->map, size, &test->region) == 0;
+    for (int i = 0; ok && i < wall_count; i++) {
+        ok = map_write_terrain(&test->map, walls[i], TERRAIN_WALL) == 0;
+    }
+    if (!ok || map_build_tables(&test->map, vec2_create(1, 1)) < 0) {
+        region_destroy(&test->region);
+        return -1;
+    }
+    arena_init(test->arena, &test->map);
+    return 0;
+}
+
+/* Обновление арены на ticks тиков */
+static void test_arena_run(TestArena *test, int ticks) {
+    for (int t = 0; t < ticks; t++) {
+        arena_update(test->arena, 16 / 1000.0f);
+    }
+}
+
+/* Есть ли в журнале последнего тика событие type */
+static int test_arena_has_event(const TestArena *test, ArenaEventType type) {
+    for (int e = 0; e < test->arena->event_count; e++) {
+        if (test->arena->events[e].type == type) return 1;
+    }
+    return 0;
+}
+
+/* Заклинание в упор во внутреннюю стену гаснет, а не пролетает сквозь неё
+ * (цель вне радиуса взрыва, урон ей возможен только при пролёте) */
+static void test_spell_into_adjacent_wall(void) {
+    const Vec2 wall = vec2_create(5, 5);
+    for (int blast = 0; blast <= 1; blast++) {
+        TestArena test;
+        CHECK(test_arena_create(&test, 20, &wall, 1) == 0);
+        Arena *arena = test.arena;
+        int caster = arena_add_entity(arena, 'A', vec2_create(5, 4), 100, 100);
+        int target = arena_add_entity(arena, 'B', vec2_create(5, 9), 100, 100);
+        
+        int spell = arena_cast_spell(arena, caster, DIR_DOWN, blast ? SPELL_TYPE_BLAST : SPELL_TYPE_BASIC);
+        CHECK(spell >= 0);
+        test_arena_run(&test, 1);
+        CHECK(test_arena_has_event(&test, ARENA_EVENT_SPELL_HIT_WALL));
+        CHECK(test_arena_has_event(&test, ARENA_EVENT_SPELL_EXPLODED) == blast);
+        CHECK(arena->state.spell_count == 0);
+        
+        test_arena_run(&test, 60);
+        CHECK(arena_get_entity_cold(arena, target)->health == 100);
+        region_destroy(&test.region);
+    }
+}
+
+/* Список смертей журнала: смерти между тиками переносятся в следующее обновление
+ * и указывают на события ENTITY_DIED, а тик без смертей список очищает */
+static void test_death_events(void) {
+    const Vec2 wall = vec2_create(5, 5);
+    TestArena test;
+    CHECK(test_arena_create(&test, 20, &wall, 1) == 0);
+    Arena *arena = test.arena;
+    int caster = arena_add_entity(arena, 'A', vec2_create(5, 4), 100, 100);
+    arena_add_entity(arena, 'B', vec2_create(4, 5), 5, 100);
+    arena_add_entity(arena, 'C', vec2_create(6, 5), 5, 100);
+    test_arena_run(&test, 1);
+    CHECK(arena->death_count == 0);
+    
+    /* Взрыв в упор в стену убивает обе цели ещё до обновления */
+    CHECK(arena_cast_spell(arena, caster, DIR_DOWN, SPELL_TYPE_BLAST) >= 0);
+    CHECK(arena->death_count == 2);
+    test_arena_run(&test, 1);
+    CHECK(arena->death_count == 2);
+    int died = 0;
+    for (int e = 0; e < arena->event_count; e++) {
+        if (arena->events[e].type == ARENA_EVENT_ENTITY_DIED) died++;
+    }
+    CHECK(died == 2);
+    for (int d = 0; d < arena->death_count; d++) {
+        const ArenaEvent *event = &arena->events[arena->death_events[d]];
+        CHECK(event->type == ARENA_EVENT_ENTITY_DIED && event->source_id == caster);
+    }
+    
+    test_arena_run(&test, 1);
+    CHECK(arena->death_count == 0);
+    region_destroy(&test.region);
+}
+
+/* Сценарий арены для сравнения ядер: count сущностей ходят и стреляют по зерну,
+ * посреди прогона сущность 0 удаляется и добавляется снова в освобождённый слот */
+static void test_kernel_script(Arena *arena, int count) {
+    static const Vec2 spawns[] = {
+        {3, 3}, {16, 16}, {3, 16}, {16, 3}, {9, 4}, {4, 10}, {15, 9}, {10, 15}
+    };
+    int ids[8];
+    for (int i = 0; i < count; i++) {
+        ids[i] = arena_add_entity(arena, (char)('A' + i), spawns[i], 10, 100);
+    }
+    
+    Rng rng = rng_create(11);
+    for (int t = 0; t < 600; t++) {
+        if (t == 300) {
+            arena_remove_entity(arena, ids[0]);
+            ids[0] = arena_add_entity(arena, 'A', spawns[0], 10, 100);
+        }
+        for (int i = 0; i < count; i++) {
+            arena_move_entity(arena, ids[i], (Direction)rng_range(&rng, DIR_UP, DIR_RIGHT));
+            if (rng_range(&rng, 0, 3) == 0) {
+                arena_cast_spell(arena, ids[i], (Direction)rng_range(&rng, DIR_UP, DIR_RIGHT),
+                                 (SpellType)rng_range(&rng, SPELL_TYPE_BASIC, SPELL_TYPE_BLAST));
+            }
+        }
+        arena_update(arena, 16 / 1000.0f);
+    }
+}
+
+/* Развёрнутые ядра 2, 4 и 8 дают то же состояние, что и общее, а сущности сверх
+ * ёмкости ядра не добавляются */
+static void test_arena_kernels(void) {
+    const Vec2 wall = vec2_create(9, 9);
+    for (int capacity = 2; capacity <= 8; capacity *= 2) {
+        TestArena generic, unrolled;
+        CHECK(test_arena_create(&generic, 20, &wall, 1) == 0);
+        CHECK(test_arena_create(&unrolled, 20, &wall, 1) == 0);
+        arena_set_capacity(unrolled.arena, capacity);
+        CHECK(arena_capacity(unrolled.arena) == capacity);
+        
+        test_kernel_script(generic.arena, capacity);
+        test_kernel_script(unrolled.arena, capacity);
+        CHECK(memcmp(&generic.arena->state, &unrolled.arena->state, sizeof(ArenaState)) == 0);
+        CHECK(arena_add_entity(unrolled.arena, 'Z', vec2_create(5, 5), 60, 100) == ENTITY_ID_NONE);
+        
+        /* Ёмкость не опускается ниже числа занятых слотов */
+        arena_set_capacity(generic.arena, 1);
+        CHECK(arena_capacity(generic.arena) >= capacity);
+        region_destroy(&generic.region);
+        region_destroy(&unrolled.region);
+    }
+}
+
+/* Дуэль для компенсации лага: цель B на линии огня A пять тиков, затем шаг вниз
+ * с линии и ещё четыре тика. Заклинание создаётся с откатом rewind
+ * (при отрицательном - обычным arena_cast_spell) */
+static int test_rewind_duel(TestArena *test, int rewind, int *target) {
+    if (test_arena_create(test, 20, NULL, 0) < 0) return -1;
+    Arena *arena = test->arena;
+    int caster = arena_add_entity(arena, 'A', vec2_create(5, 10), 100, 100);
+    *target = arena_add_entity(arena, 'B', vec2_create(10, 10), 100, 100);
+    test_arena_run(test, 5);
+    CHECK(arena_move_entity(arena, *target, DIR_DOWN) == 1);
+    test_arena_run(test, 4);
+    if (rewind < 0) return arena_cast_spell(arena, caster, DIR_RIGHT, SPELL_TYPE_BASIC);
+    return arena_cast_spell_rewind(arena, caster, DIR_RIGHT, SPELL_TYPE_BASIC, rewind);
+}
+
+/* Компенсация лага: попадание по позиции rewind тиков назад, откат ограничен
+ * историей, нулевой откат совпадает с обычным заклинанием */
+static void test_lag_compensation(void) {
+    /* Цель уже сошла с линии, но заклинатель видел её на линии */
+    TestArena test;
+    int target;
+    int spell = test_rewind_duel(&test, 8, &target);
+    CHECK(spell >= 0);
+    CHECK(arena_entity_position_at(test.arena, arena_get_entity(test.arena, target), 8).y == 10);
+    test_arena_run(&test, 10);
+    CHECK(arena_get_entity_cold(test.arena, target)->health < 100);
+    region_destroy(&test.region);
+    
+    /* Откат больше истории ограничивается ARENA_HISTORY_TICKS - 1 */
+    spell = test_rewind_duel(&test, 1000, &target);
+    CHECK(spell >= 0);
+    CHECK(test.arena->state.spells[spell].rewind == ARENA_HISTORY_TICKS - 1);
+    region_destroy(&test.region);
+    
+    /* Без отката заклинание проходит мимо и состояние совпадает с arena_cast_spell */
+    TestArena plain;
+    int plain_target;
+    spell = test_rewind_duel(&test, 0, &target);
+    CHECK(spell >= 0);
+    CHECK(test_rewind_duel(&plain, -1, &plain_target) == spell);
+    
+    test_arena_run(&test, 10);
+    test_arena_run(&plain, 10);
+    CHECK(arena_get_entity_cold(test.arena, target)->health == 100);
+    CHECK(memcmp(&test.arena->state, &plain.arena->state, sizeof(ArenaState)) == 0);
+    region_destroy(&test.region);
+    region_destroy(&plain.region);
+}
+
+/* Обновление арены до события type, не больше ticks тиков. Найденное событие
+ * копируется в found. Возвращает 1, если событие было */
+static int test_arena_run_until(TestArena *test, ArenaEventType type, int ticks, ArenaEvent *found) {
+    for (int t = 0; t < ticks; t++) {
+        test_arena_run(test, 1);
+        for (int e = 0; e < test->arena->event_count; e++) {
+            if (test->arena->events[e].type == type) {
+                *found = test->arena->events[e];
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* Взрыв (урон 6 в радиусе 2): при прямом попадании цель не получает урон повторно,
+ * при попадании в стену заклинатель в радиусе не задет, убийство взрывом
+ * засчитывается заклинателю */
+static void test_blast(void) {
+    /* Прямое попадание: B - цель, C рядом с ней погибает от взрыва, D вне радиуса */
+    TestArena test;
+    CHECK(test_arena_create(&test, 20, NULL, 0) == 0);
+    Arena *arena = test.arena;
+    int caster = arena_add_entity(arena, 'A', vec2_create(3, 10), 100, 100);
+    int direct = arena_add_entity(arena, 'B', vec2_create(8, 10), 100, 100);
+    int splash = arena_add_entity(arena, 'C', vec2_create(9, 11), 6, 100);
+    int outside = arena_add_entity(arena, 'D', vec2_create(8, 13), 100, 100);
+    CHECK(arena_cast_spell(arena, caster, DIR_RIGHT, SPELL_TYPE_BLAST) >= 0);
+    
+    ArenaEvent event;
+    CHECK(test_arena_run_until(&test, ARENA_EVENT_SPELL_EXPLODED, 20, &event));
+    CHECK(vec2_equals(event.position, vec2_create(8, 10)) && event.value == 2);
+    CHECK(arena_get_entity_cold(arena, direct)->health == 94);
+    CHECK(!arena_get_entity(arena, splash)->alive);
+    CHECK(arena_get_entity_cold(arena, outside)->health == 100);
+    CHECK(arena->death_count == 1);
+    const ArenaEvent *death = &arena->events[arena->death_events[0]];
+    CHECK(death->entity_id == splash && death->source_id == caster);
+    region_destroy(&test.region);
+    
+    /* Попадание в стену периметра: заклинатель в радиусе не задет */
+    CHECK(test_arena_create(&test, 20, NULL, 0) == 0);
+    arena = test.arena;
+    caster = arena_add_entity(arena, 'A', vec2_create(17, 10), 100, 100);
+    splash = arena_add_entity(arena, 'B', vec2_create(18, 11), 100, 100);
+    outside = arena_add_entity(arena, 'C', vec2_create(16, 12), 100, 100);
+    CHECK(arena_cast_spell(arena, caster, DIR_RIGHT, SPELL_TYPE_BLAST) >= 0);
+    CHECK(test_arena_run_until(&test, ARENA_EVENT_SPELL_EXPLODED, 20, &event));
+    CHECK(test_arena_has_event(&test, ARENA_EVENT_SPELL_HIT_WALL));
+    CHECK(vec2_equals(event.position, vec2_create(19, 10)));
+    CHECK(arena_get_entity_cold(arena, caster)->health == 100);
+    CHECK(arena_get_entity_cold(arena, splash)->health == 94);
+    CHECK(arena_get_entity_cold(arena, outside)->health == 100);
+    region_destroy(&test.region);
+}
+
+/* Ведро токенов: всплеск до burst, пополнение rate в секунду с дробными долями,
+ * запас не выше burst, время назад токенов не добавляет */
+static void test_token_bucket(void) {
+    TokenBucket bucket = token_bucket_create(4, 8, 1000);
+    int taken = 0;
+    while (taken < 100 && token_bucket_take(&bucket, 1000)) taken++;
+    CHECK(taken == 8);
+    
+    /* 4 токена в секунду: четверть секунды - один токен, половина её - ничего */
+    CHECK(!token_bucket_take(&bucket, 1125));
+    CHECK(token_bucket_take(&bucket, 1250));
+    CHECK(!token_bucket_take(&bucket, 1250));
+    CHECK(!token_bucket_take(&bucket, 1000));
+    
+    /* После долгого простоя запас ограничен burst */
+    taken = 0;
+    while (taken < 100 && token_bucket_take(&bucket, 600000)) taken++;
+    CHECK(taken == 8);
+}
+
+/* Библиотека из одной сгенерированной карты во временном файле. Возвращает 0 или -1 */
+static int write_test_library(char *path, size_t path_size, int map_size) {
+    snprintf(path, path_size, "/tmp/test_game_%d.aml", (int)getpid());
+    Region region;
+    if (region_init(&region, map_region_size(map_size)) < 0) return -1;
+    
+    Map map;
+    Vec2 first_spawn;
+    int result = -1;
+    if (mapgen_generate_random(&map, map_size, 5, &region, &first_spawn) == 0 &&
+        map_build_tables(&map, first_spawn) == 0) {
+        const Map *maps[1] = { &map };
+        const char *names[1] = { "test" };
+        result = map_library_write(path, maps, names, 1);
+    }
+    region_destroy(&region);
+    return result;
+}
+
+/* Арена, которую не удалось создать, не оставляет игру идущей без арены:
+ * без паузы матч заканчивается, с паузой игра ждёт следующей попытки */
+static void test_arena_failure(void) {
+    char path[64];
+    MapLibrary library;
+    int opened = write_test_library(path, sizeof(path), 30) == 0 && map_library_open(&library, path) == 0;
+    CHECK(opened);
+    if (!opened) return;
+    
+    /* Карта библиотеки больше размера игры не загружается */
+    for (int hold = 0; hold <= 1; hold++) {
+        Game *game = game_create(20, 3, 2);
+        CHECK(game != NULL);
+        if (!game) continue;
+        game_set_map_library(game, &library, 0);
+        game->hold_between_arenas = hold;
+        game_add_player(game, 'A');
+        game_add_player(game, 'B');
+        game_start(game);
+        CHECK(game->arena == NULL);
+        CHECK(game->state == (hold ? GAME_STATE_ARENA_OVER : GAME_STATE_FINISHED));
+        CHECK(game->arena_number == 0);
+        game_destroy(game);
+    }
+    
+    /* Карта по размеру игры загружается */
+    Game *game = game_create(30, 3, 2);
+    CHECK(game != NULL);
+    if (game) {
+        game_set_map_library(game, &library, 0);
+        game_add_player(game, 'A');
+        game_add_player(game, 'B');
+        game_start(game);
+        CHECK(game->arena != NULL);
+        CHECK(game->state == GAME_STATE_PLAYING);
+        game_destroy(game);
+    }
+    map_library_close(&library);
+    unlink(path);
+}
+
+/* Порча байт файла библиотеки: по смещению offset пишется size байт из value */
+static int patch_file(const char *path, long offset, const void *value, size_t size) {
+    FILE *file = fopen(path, "r+b");
+    if (!file) return -1;
+    int result = (fseek(file, offset, SEEK_SET) == 0 && fwrite(value, 1, size, file) == size) ? 0 : -1;
+    if (fclose(file) != 0) result = -1;
+    return result;
+}
+
+/* Повреждённая библиотека отвергается при открытии, а не при поиске или в игре */
+static void test_corrupted_library(void) {
+    char path[64];
+    for (int c = 0; c < 3; c++) {
+        MapLibrary library;
+        int opened = write_test_library(path, sizeof(path), 30) == 0 && map_library_open(&library, path) == 0;
+        CHECK(opened);
+        if (!opened) continue;
+        MapLibraryHeader header = *library.header;
+        MapLibraryEntry entry = library.entries[0];
+        map_library_close(&library);
+        
+        int patched = -1;
+        if (c == 0) {
+            /* Таблица имён без пустых слотов: поиск по ней не закончился бы */
+            for (uint32_t i = 0; i < header.slot_count; i++) {
+                uint32_t index = 1;
+                patched = patch_file(path, (long)(header.name_slots_offset + i * sizeof(uint32_t)), &index, sizeof(index));
+                if (patched < 0) break;
+            }
+        } else if (c == 1) {
+            /* Выход чанка не совпадает с террейном */
+            uint16_t edge = 1000;
+            long offset = (long)(entry.data_offset + 4 * sizeof(MapChunk) + ((size_t)DIR_RIGHT * MAP_CHUNK_SIZE + 1) * sizeof(uint16_t));
+            patched = patch_file(path, offset, &edge, sizeof(edge));
+        } else {
+            /* Точка спавна в стене периметра */
+            int16_t spawn[2] = { 0, 0 };
+            patched = patch_file(path, (long)(header.entries_offset + offsetof(MapLibraryEntry, spawns)), spawn, sizeof(spawn));
+        }
+        CHECK(patched == 0);
+        CHECK(map_library_open(&library, path) < 0);
+        unlink(path);
+    }
+}
+
+/* Подготовка арены в другом потоке */
+static void* prepare_thread(void *arg) {
+    game_prepare_arena((Game *)arg);
+    return NULL;
+}
+
+/* Арена, подготовленная заранее в другом потоке, совпадает с созданной сразу */
+static void test_prepared_arena(void) {
+    SimConfig config = sim_config_default();
+    config.seed = 42;
+    SimMatch *matches[2];
+    for (int i = 0; i < 2; i++) {
+        matches[i] = sim_match_create(&config);
+        CHECK(matches[i] != NULL);
+        if (!matches[i]) return;
+        matches[i]->game->hold_between_arenas = 1;
+        while (!sim_match_is_over(matches[i])) {
+            sim_match_step(matches[i], 1024);
+        }
+        CHECK(matches[i]->game->state == GAME_STATE_ARENA_OVER);
+    }
+    
+    pthread_t thread;
+    CHECK(pthread_create(&thread, NULL, prepare_thread, matches[0]->game) == 0);
+    pthread_join(thread, NULL);
+    CHECK(matches[0]->game->next_map != NULL);
+    
+    for (int i = 0; i < 2; i++) {
+        game_next_arena(matches[i]->game);
+        CHECK(matches[i]->game->state == GAME_STATE_PLAYING);
+    }
+    Arena *prepared = matches[0]->game->arena;
+    Arena *direct = matches[1]->game->arena;
+    CHECK(prepared && direct && prepared->map == direct->map);
+    if (prepared && direct) {
+        CHECK(memcmp(&prepared->state, &direct->state, sizeof(ArenaState)) == 0);
+    }
+    sim_match_destroy(matches[0]);
+    sim_match_destroy(matches[1]);
+}
+
+/* Места игроков равноправны: ни одно место не выигрывает заметно реже
+ * равной доли (для 2 и 4 ботов) */
+static void test_seat_fairness(void) {
+    const int players[] = { 2, 4 };
+    for (int p = 0; p < 2; p++) {
+        SimConfig config = sim_config_default();
+        config.player_count = players[p];
+        int wins[MAX_PLAYERS] = { 0 };
+        int finished = 0;
+        for (int i = 0; i < 400; i++) {
+            config.seed = 900000 + (uint64_t)i;
+            SimResult result = sim_run_match(&config);
+            if (!result.finished || result.winner_index < 0) continue;
+            wins[result.winner_index]++;
+            finished++;
+        }
+        CHECK(finished > 0);
+        for (int i = 0; finished > 0 && i < config.player_count; i++) {
+            /* Не меньше 3/4 равной доли */
+            CHECK(wins[i] * config.player_count * 4 >= finished * 3);
+        }
+    }
+}
+
+/* Время в миллисекундах */
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+/* Боты на карте 1024: перестроение поля проходит не больше окна BOT_FIELD_CELLS клеток,
+ * и ни один тик не выходит за кадр сервера (BFS по всей карте стоил ~190 мс) */
+static void test_bot_cost_large_map(void) {
+    SimConfig config = sim_config_default();
+    config.map_size = 1024;
+    config.player_count = 4;
+    SimMatch *match = sim_match_create(&config);
+    CHECK(match != NULL);
+    if (!match) return;
+    
+    double worst = 0.0;
+    for (int t = 0; t < 600 && !sim_match_is_over(match); t++) {
+        double start = now_ms();
+        sim_match_step(match, 1);
+        double elapsed = now_ms() - start;
+        if (elapsed > worst) worst = elapsed;
+    }
+    BotNav *nav = match->bot_nav;
+    CHECK(nav->rebuilds > 0);
+    CHECK(nav->cells_visited <= (uint64_t)nav->rebuilds * BOT_FIELD_CELLS);
+    CHECK(worst < 16.0);
+    sim_match_destroy(match);
+}
+
+int main(void) {
+    printf("test_game\n");
+    test_default_tick_limit();
+    test_deterministic_match();
+    test_match_has_winner();
+    test_scripted_input();
+    test_inputs_polled_before_apply();
+    test_wall_distance();
+    test_write_terrain_errors();
+    test_spell_into_adjacent_wall();
+    test_death_events();
+    test_arena_kernels();
+    test_lag_compensation();
+    test_blast();
+    test_token_bucket();
+    test_arena_failure();
+    test_corrupted_library();
+    test_prepared_arena();
+    test_seat_fairness();
+    test_bot_cost_large_map();
+    
+    printf("Проверок: %d, провалено: %d\n", checks_run, checks_failed);
+    return checks_failed == 0 ? 0 : 1;
+}
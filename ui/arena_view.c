@@ -6,6 +6,7 @@
 #include "widgets.h"
 #include "terminal.h"
 #include <ncurses.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <sys/time.h>
@@ -13,6 +14,9 @@
 /* Время анимации урона в миллисекундах */
 #define DAMAGE_ANIMATION_TIME 66
 
+/* Время анимации взрыва в миллисекундах */
+#define EXPLOSION_ANIMATION_TIME 250
+
 /* Получение текущего времени в миллисекундах */
 static int64_t get_time_ms(void) {
     struct timeval tv;
@@ -172,17 +176,41 @@ static void render_map(ArenaView *view, int x, int y, int width, int height) {
     int inner_x = x + 1;
     int inner_y = y + 1;
     
-    /* Сначала рисуем карту (пол) - это очистит все артефакты */
-    for (int map_y = 0; map_y < view->map_size; map_y++) {
-        for (int map_x = 0; map_x < view->map_size; map_x++) {
+    /* Рисуемые объекты сдвигаются на положение камеры */
+    inner_x -= view->camera_x * 2;
+    inner_y -= view->camera_y;
+    int has_terrain = view->terrain && view->terrain_size == view->map_size;
+    int min_x = view->camera_x;
+    int min_y = view->camera_y;
+    int max_x = view->camera_x + view->viewport_width;
+    int max_y = view->camera_y + view->viewport_height;
+    
+    /* Сначала рисуем карту (пол и стены) - это очистит все артефакты */
+    for (int map_y = min_y; map_y < max_y; map_y++) {
+        for (int map_x = min_x; map_x < max_x; map_x++) {
             int screen_x = inner_x + map_x * 2;
             int screen_y = inner_y + map_y;
             
-            /* Рисуем пол (точка и пробел) */
-            attron(COLOR_PAIR(COLOR_FLOOR));
-            mvaddch(screen_y, screen_x, '.');
-            mvaddch(screen_y, screen_x + 1, ' ');
-            attroff(COLOR_PAIR(COLOR_FLOOR));
+            int cell = has_terrain ? view->terrain[map_y * view->map_size + map_x] : ARENA_CELL_UNKNOWN;
+            if (cell == ARENA_CELL_UNKNOWN) {
+                /* Туман: чанк ещё не получен */
+                attron(COLOR_PAIR(COLOR_FLOOR) | A_DIM);
+                mvaddch(screen_y, screen_x, '~');
+                mvaddch(screen_y, screen_x + 1, ' ');
+                attroff(COLOR_PAIR(COLOR_FLOOR) | A_DIM);
+            } else if (cell == ARENA_CELL_WALL) {
+                /* Рисуем стену */
+                attron(COLOR_PAIR(COLOR_WALL) | A_BOLD);
+                mvaddch(screen_y, screen_x, '#');
+                mvaddch(screen_y, screen_x + 1, '#');
+                attroff(COLOR_PAIR(COLOR_WALL) | A_BOLD);
+            } else {
+                /* Рисуем пол (точка и пробел) */
+                attron(COLOR_PAIR(COLOR_FLOOR));
+                mvaddch(screen_y, screen_x, '.');
+                mvaddch(screen_y, screen_x + 1, ' ');
+                attroff(COLOR_PAIR(COLOR_FLOOR));
+            }
         }
     }
     
@@ -205,9 +233,9 @@ static void render_map(ArenaView *view, int x, int y, int width, int height) {
                         case 3: dir_x++; break;  /* Right (DIR_RIGHT) */
                     }
                     
-                    /* Проверяем границы */
-                    if (dir_x >= 0 && dir_x < view->map_size && 
-                        dir_y >= 0 && dir_y < view->map_size) {
+                    /* Проверяем границы видимой части */
+                    if (dir_x >= min_x && dir_x < max_x && 
+                        dir_y >= min_y && dir_y < max_y) {
                         int screen_x = inner_x + dir_x * 2;
                         int screen_y = inner_y + dir_y;
                         
@@ -249,9 +277,9 @@ static void render_map(ArenaView *view, int x, int y, int width, int height) {
             compute_spell_ray(s, interp_x, interp_y, ray_positions);
             
             /* Определяем цвет и символ в зависимости от типа */
-            int spell_color = (s->spell_type == 2) ? COLOR_SPELL_POWER : COLOR_SPELL;
-            char trail_char = (s->spell_type == 2) ? 'o' : '*';
-            char head_char = (s->spell_type == 2) ? 'O' : '*';
+            int spell_color = (s->spell_type >= 2) ? COLOR_SPELL_POWER : COLOR_SPELL;
+            char trail_char = (s->spell_type == 2) ? 'o' : (s->spell_type == 3) ? '.' : '*';
+            char head_char = (s->spell_type == 2) ? 'O' : (s->spell_type == 3) ? '@' : '*';
             
             /* Рисуем луч (от дальних позиций к ближним, от еле видимых к ярким) */
             for (int j = SPELL_TRAIL_LENGTH - 1; j >= 0; j--) {
@@ -261,9 +289,9 @@ static void render_map(ArenaView *view, int x, int y, int width, int height) {
                 int ray_x = inner_x + ray_positions[j][0] * 2;
                 int ray_y = inner_y + ray_positions[j][1];
                 
-                /* Проверяем границы */
-                if (ray_x >= inner_x && ray_x < inner_x + view->map_size * 2 &&
-                    ray_y >= inner_y && ray_y < inner_y + view->map_size) {
+                /* Проверяем границы видимой части */
+                if (ray_positions[j][0] >= min_x && ray_positions[j][0] < max_x &&
+                    ray_positions[j][1] >= min_y && ray_positions[j][1] < max_y) {
                     
                     /* Определяем уровень яркости */
                     int attr = 0;
@@ -288,9 +316,33 @@ static void render_map(ArenaView *view, int x, int y, int width, int height) {
         }
     }
     
+    /* Взрывы: круг радиуса взрыва по полу, угасает к концу анимации */
+    for (int i = 0; i < view->explosion_count; i++) {
+        ArenaExplosion *explosion = &view->explosions[i];
+        int64_t age = now - explosion->start_time;
+        if (age >= EXPLOSION_ANIMATION_TIME) continue;
+        int attr = (age < EXPLOSION_ANIMATION_TIME / 2) ? A_BOLD : A_DIM;
+        
+        for (int dy = -explosion->radius; dy <= explosion->radius; dy++) {
+            for (int dx = -explosion->radius; dx <= explosion->radius; dx++) {
+                if (dx * dx + dy * dy > explosion->radius * explosion->radius) continue;
+                int cell_x = explosion->pos_x + dx;
+                int cell_y = explosion->pos_y + dy;
+                if (cell_x < min_x || cell_x >= max_x || cell_y < min_y || cell_y >= max_y) continue;
+                if (has_terrain && view->terrain[cell_y * view->map_size + cell_x] == ARENA_CELL_WALL) continue;
+                
+                attron(COLOR_PAIR(COLOR_SPELL_POWER) | attr);
+                mvaddch(inner_y + cell_y, inner_x + cell_x * 2, (dx == 0 && dy == 0) ? '*' : '+');
+                mvaddch(inner_y + cell_y, inner_x + cell_x * 2 + 1, ' ');
+                attroff(COLOR_PAIR(COLOR_SPELL_POWER) | attr);
+            }
+        }
+    }
+    
     /* Сущности */
     for (int i = 0; i < view->entity_count; i++) {
         ArenaEntity *e = &view->entities[i];
+        if (e->pos_x < min_x || e->pos_x >= max_x || e->pos_y < min_y || e->pos_y >= max_y) continue;
         int screen_x = inner_x + e->pos_x * 2;
         int screen_y = inner_y + e->pos_y;
         
@@ -365,6 +417,8 @@ ArenaView arena_view_create(int map_size, int winner_points) {
     memset(&view, 0, sizeof(view));
     
     view.map_size = map_size;
+    view.viewport_width = map_size;
+    view.viewport_height = map_size;
     view.winner_points = winner_points;
     view.arena_number = 1;
     view.current_player_id = -1;
@@ -387,6 +441,15 @@ void arena_view_update(ArenaView *view) {
             view->entities[i].damage_time = 0;
         }
     }
+    
+    /* Удаляем отыгравшие взрывы */
+    int kept = 0;
+    for (int i = 0; i < view->explosion_count; i++) {
+        if (now - view->explosions[i].start_time < EXPLOSION_ANIMATION_TIME) {
+            view->explosions[kept++] = view->explosions[i];
+        }
+    }
+    view->explosion_count = kept;
 }
 
 /* Обновление интерполяции заклинаний */
@@ -406,11 +469,44 @@ void arena_view_update_interpolation(ArenaView *view, float delta_time) {
     }
 }
 
+/* Подгонка видимой части карты под экран и центрирование камеры на текущем игроке */
+static void update_camera(ArenaView *view, int screen_width, int screen_height) {
+    /* Место под панели игроков, рамку, заголовок и уведомления */
+    int fit_width = (screen_width - PLAYER_PANEL_WIDTH - 3) / 2;
+    int fit_height = screen_height - 6;
+    view->viewport_width = (view->map_size < fit_width) ? view->map_size : fit_width;
+    view->viewport_height = (view->map_size < fit_height) ? view->map_size : fit_height;
+    if (view->viewport_width < 1) view->viewport_width = 1;
+    if (view->viewport_height < 1) view->viewport_height = 1;
+    
+    /* Погибший игрок оставляет камеру на месте */
+    for (int i = 0; i < view->player_count; i++) {
+        if (!view->players[i].is_current_user) continue;
+        for (int j = 0; j < view->entity_count; j++) {
+            if (view->entities[j].id == view->players[i].entity_id) {
+                view->camera_x = view->entities[j].pos_x - view->viewport_width / 2;
+                view->camera_y = view->entities[j].pos_y - view->viewport_height / 2;
+                break;
+            }
+        }
+        break;
+    }
+    
+    int max_camera_x = view->map_size - view->viewport_width;
+    int max_camera_y = view->map_size - view->viewport_height;
+    if (view->camera_x > max_camera_x) view->camera_x = max_camera_x;
+    if (view->camera_y > max_camera_y) view->camera_y = max_camera_y;
+    if (view->camera_x < 0) view->camera_x = 0;
+    if (view->camera_y < 0) view->camera_y = 0;
+}
+
 /* Отрисовка арены */
 void arena_view_render(ArenaView *view, int screen_width, int screen_height) {
+    update_camera(view, screen_width, screen_height);
+    
     /* Вычисляем размеры */
-    int map_inner_width = view->map_size * 2;  /* Внутренняя ширина карты */
-    int map_inner_height = view->map_size;
+    int map_inner_width = view->viewport_width * 2;  /* Внутренняя ширина видимой части карты */
+    int map_inner_height = view->viewport_height;
     int map_total_width = map_inner_width + 2;   /* +2 для рамки */
     int map_total_height = map_inner_height + 2;  /* +2 для рамки */
     
@@ -550,6 +646,23 @@ void arena_view_set_arena_number(ArenaView *view, int number) {
     view->arena_number = number;
 }
 
+/* Сброс террейна новой арены */
+void arena_view_reset_terrain(ArenaView *view, int map_size) {
+    if (map_size <= 0 || map_size > MAX_ARENA_MAP_SIZE) return;
+    
+    /* Буфер переиспользуется, пока размер карты не меняется */
+    if (!view->terrain || view->terrain_size != map_size) {
+        free(view->terrain);
+        view->terrain = (uint8_t *)malloc((size_t)map_size * (size_t)map_size);
+        view->terrain_size = view->terrain ? map_size : 0;
+    }
+    view->map_size = map_size;
+    view->explosion_count = 0;  /* Взрывы прошлой арены к новой карте не относятся */
+    if (view->terrain) {
+        memset(view->terrain, ARENA_CELL_UNKNOWN, (size_t)map_size * (size_t)map_size);
+    }
+}
+
 /* Добавление/обновление игрока */
 void arena_view_set_player(ArenaView *view, int id, char symbol, int points, int entity_id, int is_current) {
     /* Ищем существующего игрока */
@@ -670,6 +783,19 @@ void arena_view_clear_spells(ArenaView *view) {
     view->spell_count = 0;
 }
 
+/* Добавление взрыва */
+void arena_view_add_explosion(ArenaView *view, int pos_x, int pos_y, int radius) {
+    if (view->explosion_count == MAX_ARENA_EXPLOSIONS) {
+        memmove(view->explosions, view->explosions + 1, (MAX_ARENA_EXPLOSIONS - 1) * sizeof(ArenaExplosion));
+        view->explosion_count--;
+    }
+    ArenaExplosion *explosion = &view->explosions[view->explosion_count++];
+    explosion->pos_x = pos_x;
+    explosion->pos_y = pos_y;
+    explosion->radius = radius;
+    explosion->start_time = get_time_ms();
+}
+
 /* Установка текущего игрока */
 void arena_view_set_current_player(ArenaView *view, int player_id, int direction) {
     view->current_player_id = player_id;
@@ -705,10 +831,17 @@ void arena_view_damage_entity(ArenaView *view, int entity_id) {
 
 /* Получение размеров арены для layout */
 void arena_view_get_dimension(ArenaView *view, int *width, int *height) {
-    int map_total_width = view->map_size * 2 + 2;  /* +2 для рамки */
-    int map_total_height = view->map_size + 2;      /* +2 для рамки */
+    int map_total_width = view->viewport_width * 2 + 2;  /* +2 для рамки */
+    int map_total_height = view->viewport_height + 2;     /* +2 для рамки */
     
     *width = PLAYER_PANEL_WIDTH + 1 + map_total_width;
     *height = 1 + 1 + map_total_height + 2;
 }
 
+/* Освобождение памяти view арены */
+void arena_view_destroy(ArenaView *view) {
+    free(view->terrain);
+    view->terrain = NULL;
+    view->terrain_size = 0;
+}
+
@@ -17,6 +17,17 @@
 /* Максимальное количество заклинаний */
 #define MAX_ARENA_SPELLS 64
 
+/* Максимальное количество одновременно показываемых взрывов */
+#define MAX_ARENA_EXPLOSIONS 16
+
+/* Максимальный размер карты */
+#define MAX_ARENA_MAP_SIZE 1024
+
+/* Значения клеток террейна view */
+#define ARENA_CELL_FLOOR 0
+#define ARENA_CELL_WALL 1
+#define ARENA_CELL_UNKNOWN 2     /* Чанк ещё не получен - туман */
+
 /* Длина луча заклинания (5 кадров) */
 #define SPELL_TRAIL_LENGTH 5
 
@@ -35,7 +46,7 @@ typedef struct {
     int energy;
     int max_energy;
     int direction;      /* 0=up, 1=right, 2=down, 3=left */
-    int spell_type;     /* 1=базовая, 2=усиленная */
+    int spell_type;     /* 1=базовая, 2=усиленная, 3=взрыв */
     int is_player;
     int64_t damage_time; /* Время получения урона (для анимации) */
 } ArenaEntity;
@@ -48,11 +59,19 @@ typedef struct {
     int prev_pos_x;     /* Предыдущая позиция X для интерполяции */
     int prev_pos_y;     /* Предыдущая позиция Y для интерполяции */
     int direction;      /* Направление движения (0=up, 1=down, 2=left, 3=right) */
-    int spell_type;     /* Тип заклинания (1=базовая, 2=усиленная) */
+    int spell_type;     /* Тип заклинания (1=базовая, 2=усиленная, 3=взрыв) */
     float interp_timer; /* Таймер интерполяции (0.0-1.0) */
     int active;
 } ArenaSpell;
 
+/* Взрыв (анимация после попадания взрывного заклинания) */
+typedef struct {
+    int pos_x;          /* Центр */
+    int pos_y;
+    int radius;         /* Радиус в клетках */
+    int64_t start_time; /* Время начала анимации */
+} ArenaExplosion;
+
 /* Данные игрока */
 typedef struct {
     int id;
@@ -68,6 +87,14 @@ typedef struct {
     int arena_number;
     int winner_points;
     int map_size;
+    uint8_t *terrain;       /* Террейн [map_size * map_size] (ARENA_CELL_*) или NULL */
+    int terrain_size;       /* Размер карты, под который выделен terrain */
+    
+    /* Видимая часть карты (камера следует за текущим игроком) */
+    int camera_x;
+    int camera_y;
+    int viewport_width;     /* В клетках карты */
+    int viewport_height;
     
     /* Игроки */
     ArenaPlayer players[MAX_ARENA_PLAYERS];
@@ -81,6 +108,10 @@ typedef struct {
     ArenaSpell spells[MAX_ARENA_SPELLS];
     int spell_count;
     
+    /* Взрывы (удаляются по окончании анимации) */
+    ArenaExplosion explosions[MAX_ARENA_EXPLOSIONS];
+    int explosion_count;
+    
     /* Текущий игрок */
     int current_player_id;
     int current_direction;
@@ -110,6 +141,9 @@ void arena_view_render(ArenaView *view, int screen_width, int screen_height);
 /* Установка номера арены */
 void arena_view_set_arena_number(ArenaView *view, int number);
 
+/* Сброс террейна новой арены: вся карта в тумане до прихода чанков */
+void arena_view_reset_terrain(ArenaView *view, int map_size);
+
 /* Добавление/обновление игрока */
 void arena_view_set_player(ArenaView *view, int id, char symbol, int points, int entity_id, int is_current);
 
@@ -130,6 +164,9 @@ void arena_view_set_spell(ArenaView *view, int id, int pos_x, int pos_y, int dir
 /* Очистка списка заклинаний */
 void arena_view_clear_spells(ArenaView *view);
 
+/* Добавление взрыва (при переполнении вытесняется самый старый) */
+void arena_view_add_explosion(ArenaView *view, int pos_x, int pos_y, int radius);
+
 /* Установка текущего игрока */
 void arena_view_set_current_player(ArenaView *view, int player_id, int direction);
 
@@ -148,5 +185,8 @@ void arena_view_damage_entity(ArenaView *view, int entity_id);
 /* Получение размеров арены для layout */
 void arena_view_get_dimension(ArenaView *view, int *width, int *height);
 
+/* Освобождение памяти view арены */
+void arena_view_destroy(ArenaView *view);
+
 #endif /* ARENA_VIEW_H */
 
@@ -59,3 +59,8 @@ int input_is_spell_2_key(int key) {
     return key == KEY_SPELL_2;
 }
 
+/* Проверка, является ли клавиша клавишей выбора заклинания 3 */
+int input_is_spell_3_key(int key) {
+    return key == KEY_SPELL_3;
+}
+
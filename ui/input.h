@@ -15,6 +15,7 @@
 #define KEY_ENTER_ALT '\n'
 #define KEY_SPELL_1 '1'
 #define KEY_SPELL_2 '2'
+#define KEY_SPELL_3 '3'
 
 /* Получение нажатой клавиши (неблокирующий) */
 int input_get_key(void);
@@ -40,5 +41,8 @@ int input_is_spell_1_key(int key);
 /* Проверка, является ли клавиша клавишей выбора заклинания 2 */
 int input_is_spell_2_key(int key);
 
+/* Проверка, является ли клавиша клавишей выбора заклинания 3 */
+int input_is_spell_3_key(int key);
+
 #endif /* INPUT_H */
 
@@ -21,7 +21,7 @@ static const char *MAIN_TITLE =
     "        \\/                            \\/";
 
 /* Версия клиента */
-static const char *CLIENT_VERSION = "1.0.0";
+static const char *CLIENT_VERSION = "2.0.0";
 
 /* Константы layout */
 #define TITLE_WIDTH 70
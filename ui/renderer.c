@@ -99,10 +99,10 @@ void renderer_draw_arena(Renderer *renderer, Arena *arena, int offset_x, int off
     (void)renderer;
     
     /* Отрисовка карты с двойной шириной */
-    for (int y = 0; y < arena->map.size; y++) {
-        for (int x = 0; x < arena->map.size; x++) {
+    for (int y = 0; y < arena->map->size; y++) {
+        for (int x = 0; x < arena->map->size; x++) {
             Vec2 pos = vec2_create(x, y);
-            Terrain terrain = map_get_terrain(&arena->map, pos);
+            Terrain terrain = map_get_terrain(arena->map, pos);
             int screen_x = offset_x + x * 2;  /* Двойная ширина */
             int screen_y = offset_y + y;
             
@@ -121,8 +121,8 @@ void renderer_draw_arena(Renderer *renderer, Arena *arena, int offset_x, int off
     }
     
     /* Отрисовка заклинаний (символ 'o', оранжевый/жёлтый цвет) */
-    for (int i = 0; i < arena->spell_count; i++) {
-        Spell *spell = &arena->spells[i];
+    for (int i = 0; i < arena->state.spell_count; i++) {
+        Spell *spell = arena_get_spell(arena, i);
         if (!spell->destroyed) {
             int screen_x = offset_x + spell->position.x * 2;
             int screen_y = offset_y + spell->position.y;
@@ -135,18 +135,18 @@ void renderer_draw_arena(Renderer *renderer, Arena *arena, int offset_x, int off
     }
     
     /* Отрисовка сущностей (все белые с BOLD, красные при уроне) */
-    for (int i = 0; i < arena->entity_count; i++) {
-        Entity *entity = &arena->entities[i];
+    for (int i = 0; i < arena->state.entity_count; i++) {
+        Entity *entity = &arena->state.entities[i];
         if (entity->alive) {
             int screen_x = offset_x + entity->position.x * 2;
             int screen_y = offset_y + entity->position.y;
             
             /* Цвет: красный при уроне, иначе белый */
-            int is_damaged = entity->damage_timer > 0;
+            int is_damaged = entity_is_damaged(entity, arena->state.tick);
             int color = terminal_get_player_color(is_damaged);
             
             attron(COLOR_PAIR(color) | A_BOLD);
-            mvaddch(screen_y, screen_x, entity->symbol);
+            mvaddch(screen_y, screen_x, arena->state.entity_cold[i].symbol);
             mvaddch(screen_y, screen_x + 1, ' ');
             attroff(COLOR_PAIR(color) | A_BOLD);
         }
@@ -217,11 +217,12 @@ void renderer_draw_status(Renderer *renderer, Game *game, int offset_x, int offs
         
         if (game->arena && player->entity_id >= 0) {
             Entity *entity = arena_get_entity(game->arena, player->entity_id);
+            EntityCold *cold = arena_get_entity_cold(game->arena, player->entity_id);
             if (entity) {
-                health = entity->health;
-                max_health = entity->max_health;
-                energy = entity->energy;
-                max_energy = entity->max_energy;
+                health = cold->health;
+                max_health = cold->max_health;
+                energy = cold->energy;
+                max_energy = cold->max_energy;
                 is_alive = entity->alive;
             }
         }